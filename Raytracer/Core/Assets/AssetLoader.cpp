@@ -0,0 +1,49 @@
+#include "AssetLoader.h"
+
+#include "../Objects/Models/Model.h"
+#include "ObjLoader.h"
+
+AssetLoader::AssetLoader(uint32_t threadCount) : loadPool(threadCount)
+{
+}
+
+AssetLoader::~AssetLoader()
+{
+	waitForAll();
+	for (std::shared_future<Model*> & model : pendingModels)
+	{
+		delete model.get();
+	}
+}
+
+std::shared_future<Model*> AssetLoader::loadModel(const std::string & path)
+{
+	std::lock_guard<std::mutex> lock(modelsMutex);
+
+	auto existing = loadedModels.find(path);
+	if (existing != loadedModels.end())
+	{
+		return existing->second;
+	}
+
+	//Every model gets its own task, the Assimp importer is created inside the Model constructor so no importer is shared between threads
+	std::shared_future<Model*> model = loadPool.submit([path]() { return new Model(path); }).share();
+	loadedModels[path] = model;
+	pendingModels.push_back(model);
+	return model;
+}
+
+bool AssetLoader::loadProxyBounds(const std::string & path, glm::vec3 & minPoint, glm::vec3 & maxPoint)
+{
+	//OBJ models have every mesh at the origin of the model, so the bounds of the positions in the file bound the loaded model
+	return ObjLoader::isObjFile(path) && ObjLoader::loadBounds(path, minPoint, maxPoint);
+}
+
+void AssetLoader::waitForAll()
+{
+	std::lock_guard<std::mutex> lock(modelsMutex);
+	for (std::shared_future<Model*> & model : pendingModels)
+	{
+		model.wait();
+	}
+}
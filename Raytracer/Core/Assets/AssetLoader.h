@@ -0,0 +1,38 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <future>
+#include <mutex>
+
+#include <glm/vec3.hpp>
+
+#include "../Threading/ThreadPool.h"
+
+class Model;
+
+//Loads models on a pool of worker threads so the import, mesh conversion and octree construction of every model run at the same time
+//The loader owns the models it loads and deletes them when it is destroyed
+class AssetLoader
+{
+public:
+	//A thread count of 0 uses one thread per hardware thread
+	AssetLoader(uint32_t threadCount = 0);
+	~AssetLoader();
+
+	//Queues the model at the path to be loaded and returns a future for it, loading the same path again returns the same future
+	std::shared_future<Model*> loadModel(const std::string & path);
+	//Blocks until every queued model has finished loading
+	void waitForAll();
+	//Reads the bounds of the model at the path without loading it, so something can stand in for the model while it loads
+	//Only OBJ files can be read this quickly, returns false for every other format
+	bool loadProxyBounds(const std::string & path, glm::vec3 & minPoint, glm::vec3 & maxPoint);
+
+private:
+	ThreadPool loadPool;
+	std::unordered_map<std::string, std::shared_future<Model*>> loadedModels;
+	//Futures in the order they were queued so they are waited on in the same order
+	std::vector<std::shared_future<Model*>> pendingModels;
+	std::mutex modelsMutex;
+};
\ No newline at end of file
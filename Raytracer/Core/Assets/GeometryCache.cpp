@@ -0,0 +1,200 @@
+#include "GeometryCache.h"
+
+#include <iostream>
+#include <chrono>
+#include <algorithm>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+size_t GeometryCluster::getMemoryUsage() const
+{
+	return sizeof(GeometryCluster) + this->vertices.size() * sizeof(glm::vec3) + this->normals.size() * sizeof(glm::vec3) + this->textureCoords.size() * sizeof(glm::vec2) + this->faces.size() * sizeof(CompactFace);
+}
+
+GeometryCache::GeometryCache(const char * directory, size_t budgetBytes) : filePath(std::string(directory) + "/geometry.rtgc"), fileSize(0), memoryBudget(budgetBytes), residentBytes(0), hits(0), misses(0), evictions(0), bytesRead(0), stallMilliseconds(0.0)
+{
+	//Creates the cache directory if it does not exist yet
+#ifdef _WIN32
+	_mkdir(directory);
+#else
+	mkdir(directory, 0755);
+#endif
+
+	//The file only lives as long as the cache, the clusters hold material pointers that are only valid in this run
+	this->file = fopen(this->filePath.c_str(), "wb+");
+	if (this->file == nullptr)
+	{
+		std::cout << "WARNING: Could not create geometry cache file: " << this->filePath << std::endl;
+	}
+	MemoryTracker::addReclaimer(this);
+}
+
+GeometryCache::~GeometryCache()
+{
+	MemoryTracker::removeReclaimer(this);
+	if (this->file)
+	{
+		fclose(this->file);
+		std::remove(this->filePath.c_str());
+	}
+}
+
+int32_t GeometryCache::addCluster(const GeometryCluster & cluster)
+{
+	std::lock_guard<std::mutex> lock(cacheMutex);
+	std::lock_guard<std::mutex> fileLock(fileMutex);
+	if (this->file == nullptr || !seek(this->fileSize))
+	{
+		return -1;
+	}
+
+	StoredCluster stored;
+	stored.fileOffset = this->fileSize;
+	stored.vertexCount = cluster.vertices.size();
+	stored.normalCount = cluster.normals.size();
+	stored.textureCoordCount = cluster.textureCoords.size();
+	stored.faceCount = cluster.faces.size();
+	fwrite(cluster.vertices.data(), sizeof(glm::vec3), stored.vertexCount, this->file);
+	fwrite(cluster.normals.data(), sizeof(glm::vec3), stored.normalCount, this->file);
+	fwrite(cluster.textureCoords.data(), sizeof(glm::vec2), stored.textureCoordCount, this->file);
+	fwrite(cluster.faces.data(), sizeof(CompactFace), stored.faceCount, this->file);
+	if (ferror(this->file))
+	{
+		std::cout << "WARNING: Could not write geometry cache file: " << this->filePath << std::endl;
+		clearerr(this->file);
+		return -1;
+	}
+
+	this->fileSize += (stored.vertexCount + stored.normalCount) * sizeof(glm::vec3) + stored.textureCoordCount * sizeof(glm::vec2) + stored.faceCount * sizeof(CompactFace);
+	this->storedClusters.push_back(stored);
+	return this->storedClusters.size() - 1;
+}
+
+std::shared_ptr<const GeometryCluster> GeometryCache::getCluster(int32_t clusterID)
+{
+	std::unique_lock<std::mutex> lock(cacheMutex);
+	auto entry = clusterTable.find(clusterID);
+	if (entry != clusterTable.end())
+	{
+		hits++;
+		//Moves the cluster to the front of the list as the most recently used
+		residentClusters.splice(residentClusters.begin(), residentClusters, entry->second);
+		return entry->second->cluster;
+	}
+
+	auto readStart = std::chrono::high_resolution_clock::now();
+	auto loading = loadingClusters.find(clusterID);
+	if (loading != loadingClusters.end())
+	{
+		//Another thread is already reading the cluster, wait for it without holding the lock
+		hits++;
+		std::shared_future<std::shared_ptr<const GeometryCluster>> pending = loading->second;
+		lock.unlock();
+		std::shared_ptr<const GeometryCluster> cluster = pending.get();
+		lock.lock();
+		stallMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - readStart).count();
+		return cluster;
+	}
+	misses++;
+
+	//The cluster is marked as loading so other threads wait for this read, then the lock is let go while the file is read
+	std::promise<std::shared_ptr<const GeometryCluster>> loaded;
+	loadingClusters[clusterID] = loaded.get_future().share();
+	StoredCluster stored = this->storedClusters[clusterID];
+	lock.unlock();
+	std::shared_ptr<const GeometryCluster> cluster = readCluster(clusterID, stored);
+	size_t clusterBytes = cluster->getMemoryUsage();
+	lock.lock();
+
+	bytesRead += clusterBytes;
+	//Evicts the least recently used clusters until the new cluster fits in the budget, always keeping room for at least the new cluster
+	while (!residentClusters.empty() && (residentBytes + clusterBytes > memoryBudget || MemoryTracker::getAvailableBytes() < clusterBytes))
+	{
+		ResidentCluster & leastRecent = residentClusters.back();
+		residentBytes -= leastRecent.cluster->getMemoryUsage();
+		clusterTable.erase(leastRecent.clusterID);
+		residentClusters.pop_back();
+		evictions++;
+	}
+
+	residentClusters.push_front({ clusterID, cluster });
+	clusterTable[clusterID] = residentClusters.begin();
+	residentBytes += clusterBytes;
+	loadingClusters.erase(clusterID);
+	stallMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - readStart).count();
+	lock.unlock();
+	loaded.set_value(cluster);
+	return cluster;
+}
+
+std::shared_ptr<const GeometryCluster> GeometryCache::readCluster(int32_t clusterID, const StoredCluster & stored)
+{
+	std::shared_ptr<GeometryCluster> cluster = std::make_shared<GeometryCluster>();
+	cluster->vertices.resize(stored.vertexCount);
+	cluster->normals.resize(stored.normalCount);
+	cluster->textureCoords.resize(stored.textureCoordCount);
+	cluster->faces.resize(stored.faceCount);
+
+	bool valid;
+	{
+		std::lock_guard<std::mutex> fileLock(fileMutex);
+		valid = seek(stored.fileOffset);
+		valid = valid && fread(cluster->vertices.data(), sizeof(glm::vec3), stored.vertexCount, this->file) == stored.vertexCount;
+		valid = valid && fread(cluster->normals.data(), sizeof(glm::vec3), stored.normalCount, this->file) == stored.normalCount;
+		valid = valid && fread(cluster->textureCoords.data(), sizeof(glm::vec2), stored.textureCoordCount, this->file) == stored.textureCoordCount;
+		valid = valid && fread(cluster->faces.data(), sizeof(CompactFace), stored.faceCount, this->file) == stored.faceCount;
+	}
+	if (!valid)
+	{
+		//A cluster that can not be read is kept as degenerate faces at the origin so rays pass through it
+		std::cout << "WARNING: Could not read cluster " << clusterID << " of the geometry cache" << std::endl;
+		std::fill(cluster->vertices.begin(), cluster->vertices.end(), glm::vec3(0.0f));
+		std::fill(cluster->faces.begin(), cluster->faces.end(), CompactFace());
+	}
+	return cluster;
+}
+
+size_t GeometryCache::getResidentBytes() const
+{
+	std::lock_guard<std::mutex> lock(cacheMutex);
+	return residentBytes;
+}
+
+void GeometryCache::printStatistics() const
+{
+	std::lock_guard<std::mutex> lock(cacheMutex);
+	uint64_t lookups = hits + misses;
+	printf("Geometry cache: %zu of %zu clusters resident, %.1f KB of %.1f KB budget, %.1f KB on disk\n", residentClusters.size(), storedClusters.size(), residentBytes / 1024.0, memoryBudget / 1024.0, fileSize / 1024.0);
+	printf("  %llu lookups, %llu page-ins (%.2f%%), %.1f KB read, %llu evictions, %.1f ms stalled on reads\n", (unsigned long long)lookups, (unsigned long long)misses, lookups ? misses * 100.0 / lookups : 0.0, bytesRead / 1024.0, (unsigned long long)evictions, stallMilliseconds);
+}
+
+size_t GeometryCache::reclaimMemory(size_t bytes)
+{
+	std::lock_guard<std::mutex> lock(cacheMutex);
+	size_t freed = 0;
+	while (!residentClusters.empty() && freed < bytes)
+	{
+		ResidentCluster & leastRecent = residentClusters.back();
+		size_t clusterBytes = leastRecent.cluster->getMemoryUsage();
+		freed += clusterBytes;
+		residentBytes -= clusterBytes;
+		clusterTable.erase(leastRecent.clusterID);
+		residentClusters.pop_back();
+		evictions++;
+	}
+	return freed;
+}
+
+bool GeometryCache::seek(uint64_t offset)
+{
+	//Offsets are 64 bit since the geometry of a scene that needs streaming can be larger than a long can address
+#ifdef _WIN32
+	return _fseeki64(this->file, (__int64)offset, SEEK_SET) == 0;
+#else
+	return fseeko(this->file, (off_t)offset, SEEK_SET) == 0;
+#endif
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <future>
+#include <cstdio>
+#include <cstdint>
+
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+
+#include "../Objects/Models/Mesh.h"
+
+//Spatially coherent run of faces of a streamed mesh together with the vertices they use, the unit the geometry cache reads from disk and evicts
+//Face indices are local to the cluster and materials are indices into the material palette of the mesh
+struct GeometryCluster
+{
+	HugePageVector<glm::vec3, MemoryCategory::Caches> vertices;
+	HugePageVector<glm::vec3, MemoryCategory::Caches> normals;
+	HugePageVector<glm::vec2, MemoryCategory::Caches> textureCoords;
+	HugePageVector<CompactFace, MemoryCategory::Caches> faces;
+
+	size_t getMemoryUsage() const;
+};
+
+//Out of core storage for mesh geometry so scenes with more triangles than memory can still be rendered
+//Clusters are appended to a scratch file on disk when meshes are streamed and read back when a ray first reaches one of their faces
+//The least recently used clusters are evicted to stay under the memory budget, clusters still in use by a thread stay alive until it lets go of them
+//Clusters are also evicted to stay under the budget of the MemoryTracker, and when it asks for memory back
+class GeometryCache : public MemoryReclaimer
+{
+public:
+	GeometryCache(const char * directory, size_t budgetBytes);
+	~GeometryCache();
+
+	//Writes the cluster to the cache file and returns its cluster id, or -1 if it could not be written
+	int32_t addCluster(const GeometryCluster & cluster);
+	//Returns the cluster, reading it from disk if it is not resident
+	std::shared_ptr<const GeometryCluster> getCluster(int32_t clusterID);
+
+	size_t getResidentBytes() const;
+	void printStatistics() const;
+
+	size_t reclaimMemory(size_t bytes) override;
+
+private:
+	struct StoredCluster
+	{
+		uint64_t fileOffset;
+		uint32_t vertexCount;
+		uint32_t normalCount;
+		uint32_t textureCoordCount;
+		uint32_t faceCount;
+	};
+
+	struct ResidentCluster
+	{
+		int32_t clusterID;
+		std::shared_ptr<const GeometryCluster> cluster;
+	};
+
+	std::string filePath;
+	FILE * file;
+	uint64_t fileSize;
+	std::vector<StoredCluster> storedClusters;
+
+	//Resident clusters ordered from most to least recently used, with a table to find the cluster of an id
+	std::list<ResidentCluster> residentClusters;
+	std::unordered_map<int32_t, std::list<ResidentCluster>::iterator> clusterTable;
+	//Clusters being read from disk, a thread that needs a cluster another thread is reading waits for that read instead of starting its own
+	std::unordered_map<int32_t, std::shared_future<std::shared_ptr<const GeometryCluster>>> loadingClusters;
+	size_t memoryBudget;
+	size_t residentBytes;
+
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t evictions;
+	uint64_t bytesRead;
+	//Time threads spent waiting for clusters to be read from disk
+	double stallMilliseconds;
+
+	//Guards the cluster tables and the statistics, it is never held while the file is read so lookups of resident clusters do not wait on the disk
+	mutable std::mutex cacheMutex;
+	//Guards the position of the file, taken after the cache mutex when both are needed
+	std::mutex fileMutex;
+
+	bool seek(uint64_t offset);
+	//Reads the cluster from the file, filling it with degenerate faces if it can not be read
+	std::shared_ptr<const GeometryCluster> readCluster(int32_t clusterID, const StoredCluster & stored);
+};
\ No newline at end of file
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+//Read only view of a whole file mapped into memory, so file contents can be used in place without reading them through a buffer
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+
+	bool open(const char * path);
+	void close();
+
+	bool isOpen() const;
+	const unsigned char * getData() const;
+	size_t getSize() const;
+
+	//FNV-1a hash of the bytes, used to tell whether a source file changed since a cache was made from it
+	static uint64_t hashBytes(const void * bytes, size_t byteCount);
+	//Hashes the contents of the file at the path, returns false if the file could not be opened
+	static bool hashFile(const char * path, uint64_t & fileSize, uint64_t & hash);
+
+private:
+	const unsigned char * data;
+	size_t size;
+#ifdef _WIN32
+	void * fileHandle;
+	void * mappingHandle;
+#else
+	int fileDescriptor;
+#endif
+
+	//Mapped files can not be copied since the mapping would be released twice
+	MappedFile(const MappedFile &) = delete;
+	MappedFile & operator=(const MappedFile &) = delete;
+};
\ No newline at end of file
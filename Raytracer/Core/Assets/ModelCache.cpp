@@ -0,0 +1,354 @@
+#include "ModelCache.h"
+
+#include "MappedFile.h"
+#include "../Objects/Models/Mesh.h"
+#include "../DataStructures/Octree.h"
+#include "../Geometry/AABB.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+constexpr char CACHE_FILE_MAGIC[4] = { 'R', 'T', 'M', 'C' };
+constexpr uint32_t CACHE_FILE_VERSION = 3;
+
+std::string ModelCache::cacheDirectory = "Resources/ModelCache";
+
+//Reads arrays out of the mapped cache file, every read is checked against the end of the file so a truncated file is rejected
+class CacheReader
+{
+public:
+	CacheReader(const unsigned char * d, size_t s) : data(d), size(s), offset(0) {}
+
+	template <typename T>
+	const T * read(size_t count)
+	{
+		size_t bytes = count * sizeof(T);
+		if (bytes > size - offset)
+		{
+			return nullptr;
+		}
+		const T * result = (const T *)(data + offset);
+		offset += bytes;
+		return result;
+	}
+
+	template <typename T, typename Allocator>
+	bool readInto(std::vector<T, Allocator> & destination, size_t count)
+	{
+		const T * source = read<T>(count);
+		if (source == nullptr && count > 0)
+		{
+			return false;
+		}
+		destination.resize(count);
+		if (count > 0)
+		{
+			std::memcpy(destination.data(), source, count * sizeof(T));
+		}
+		return true;
+	}
+
+private:
+	const unsigned char * data;
+	size_t size;
+	size_t offset;
+};
+
+void ModelCache::setCacheDirectory(const std::string & directory)
+{
+	cacheDirectory = directory;
+}
+
+bool ModelCache::load(const std::string & sourcePath, std::vector<Mesh*> & meshList, std::vector<MeshInstance> & instanceList)
+{
+	if (cacheDirectory.empty())
+	{
+		return false;
+	}
+
+	uint64_t sourceSize, sourceHash;
+	MappedFile file;
+	if (!MappedFile::hashFile(sourcePath.c_str(), sourceSize, sourceHash) || !file.open(getCacheFilePath(sourcePath).c_str()))
+	{
+		return false;
+	}
+
+	//The cache file is only used if it was written by this version from the same source file
+	CacheReader reader(file.getData(), file.getSize());
+	const FileHeader * header = reader.read<FileHeader>(1);
+	if (header == nullptr || std::memcmp(header->magic, CACHE_FILE_MAGIC, 4) != 0 || header->version != CACHE_FILE_VERSION || header->sourceSize != sourceSize || header->sourceHash != sourceHash)
+	{
+		return false;
+	}
+
+	std::vector<Mesh*> meshes;
+	bool valid = true;
+	for (uint32_t i = 0; valid && i < header->meshCount; i++)
+	{
+		const MeshHeader * meshHeader = reader.read<MeshHeader>(1);
+		if (meshHeader == nullptr || meshHeader->nodeCount == 0)
+		{
+			valid = false;
+			break;
+		}
+
+		Mesh * mesh = new Mesh();
+		meshes.push_back(mesh);
+		std::vector<uint32_t> faceIndices;
+		valid = reader.readInto(mesh->vertices, meshHeader->vertexCount) && reader.readInto(mesh->normals, meshHeader->normalCount) && reader.readInto(mesh->textureCoords, meshHeader->textureCoordCount) && reader.readInto(faceIndices, meshHeader->faceCount * 3);
+		const FlatNode * nodes = reader.read<FlatNode>(meshHeader->nodeCount);
+		const uint32_t * leafContents = reader.read<uint32_t>(meshHeader->leafContentCount);
+		if (!valid || nodes == nullptr || (leafContents == nullptr && meshHeader->leafContentCount > 0))
+		{
+			valid = false;
+			break;
+		}
+
+		//Normals and texture coordinates are read with the vertex indices of the faces, so a mesh has either none of them or one for every vertex
+		valid = (meshHeader->normalCount == 0 || meshHeader->normalCount == meshHeader->vertexCount) && (meshHeader->textureCoordCount == 0 || meshHeader->textureCoordCount == meshHeader->vertexCount);
+
+		mesh->faces.resize(meshHeader->faceCount);
+		for (uint32_t f = 0; f < meshHeader->faceCount; f++)
+		{
+			for (uint32_t j = 0; j < 3; j++)
+			{
+				mesh->faces[f].indices[j] = faceIndices[f * 3 + j];
+				valid = valid && faceIndices[f * 3 + j] < meshHeader->vertexCount;
+			}
+			mesh->faces[f].material = nullptr;
+		}
+
+		mesh->boundingOctree = new Octree<uint32_t>(Mesh::OCTREE_MIN_OBJECTS, Mesh::OCTREE_MAX_DEPTH);
+		mesh->boundingOctree->root = buildNode(*mesh->boundingOctree, nodes, meshHeader->nodeCount, leafContents, meshHeader->leafContentCount, meshHeader->faceCount, 0, nullptr);
+		valid = valid && mesh->boundingOctree->root != nullptr;
+	}
+
+	std::vector<MeshInstance> instances(valid ? header->instanceCount : 0);
+	const FlatInstance * flatInstances = valid ? reader.read<FlatInstance>(header->instanceCount) : nullptr;
+	valid = valid && (flatInstances != nullptr || header->instanceCount == 0);
+	for (uint32_t i = 0; valid && i < header->instanceCount; i++)
+	{
+		instances[i].meshIndex = flatInstances[i].meshIndex;
+		instances[i].meshToModelMatrix = glm::make_mat4(flatInstances[i].matrix);
+		instances[i].modelToMeshMatrix = glm::inverse(instances[i].meshToModelMatrix);
+		instances[i].identity = instances[i].meshToModelMatrix == glm::mat4(1.0f);
+		valid = flatInstances[i].meshIndex < header->meshCount;
+	}
+
+	if (!valid)
+	{
+		std::cout << "WARNING: Model cache file for " << sourcePath << " is damaged, importing the model again" << std::endl;
+		for (Mesh * mesh : meshes)
+		{
+			delete mesh;
+		}
+		return false;
+	}
+
+	//The mesh indices of the instances are moved past any meshes already in the list
+	for (MeshInstance & instance : instances)
+	{
+		instance.meshIndex += meshList.size();
+	}
+	meshList.insert(meshList.end(), meshes.begin(), meshes.end());
+	instanceList.insert(instanceList.end(), instances.begin(), instances.end());
+	return true;
+}
+
+bool ModelCache::save(const std::string & sourcePath, const std::vector<Mesh*> & meshList, const std::vector<MeshInstance> & instanceList)
+{
+	if (cacheDirectory.empty())
+	{
+		return false;
+	}
+
+	FileHeader header = {};
+	std::memcpy(header.magic, CACHE_FILE_MAGIC, 4);
+	header.version = CACHE_FILE_VERSION;
+	header.meshCount = meshList.size();
+	header.instanceCount = instanceList.size();
+	if (!MappedFile::hashFile(sourcePath.c_str(), header.sourceSize, header.sourceHash))
+	{
+		return false;
+	}
+
+	//Creates the cache directory if it does not exist yet
+#ifdef _WIN32
+	_mkdir(cacheDirectory.c_str());
+#else
+	mkdir(cacheDirectory.c_str(), 0755);
+#endif
+
+	//The file is written under a temporary name and renamed when complete, so another run mapping the cache file never sees it truncated and a run that stops part way through never leaves a file that looks valid
+	std::string cachePath = getCacheFilePath(sourcePath);
+	std::string temporaryPath = cachePath + ".tmp";
+	FILE * file = fopen(temporaryPath.c_str(), "wb");
+	if (file == nullptr)
+	{
+		std::cout << "WARNING: Could not write model cache file: " << cachePath << std::endl;
+		return false;
+	}
+
+	fwrite(&header, sizeof(header), 1, file);
+	for (Mesh * mesh : meshList)
+	{
+		std::vector<FlatNode> nodes;
+		std::vector<uint32_t> leafContents;
+		flattenOctree(mesh->boundingOctree->root, nodes, leafContents);
+
+		//The faces are written without their materials since those are pointers set up by the scene
+		std::vector<uint32_t> faceIndices;
+		faceIndices.reserve(mesh->faces.size() * 3);
+		for (const Face & face : mesh->faces)
+		{
+			faceIndices.insert(faceIndices.end(), face.indices, face.indices + 3);
+		}
+
+		MeshHeader meshHeader;
+		meshHeader.vertexCount = mesh->vertices.size();
+		meshHeader.normalCount = mesh->normals.size();
+		meshHeader.textureCoordCount = mesh->textureCoords.size();
+		meshHeader.faceCount = mesh->faces.size();
+		meshHeader.nodeCount = nodes.size();
+		meshHeader.leafContentCount = leafContents.size();
+
+		fwrite(&meshHeader, sizeof(meshHeader), 1, file);
+		fwrite(mesh->vertices.data(), sizeof(glm::vec3), mesh->vertices.size(), file);
+		fwrite(mesh->normals.data(), sizeof(glm::vec3), mesh->normals.size(), file);
+		fwrite(mesh->textureCoords.data(), sizeof(glm::vec2), mesh->textureCoords.size(), file);
+		fwrite(faceIndices.data(), sizeof(uint32_t), faceIndices.size(), file);
+		fwrite(nodes.data(), sizeof(FlatNode), nodes.size(), file);
+		fwrite(leafContents.data(), sizeof(uint32_t), leafContents.size(), file);
+	}
+
+	for (const MeshInstance & instance : instanceList)
+	{
+		FlatInstance flatInstance;
+		flatInstance.meshIndex = instance.meshIndex;
+		std::memcpy(flatInstance.matrix, glm::value_ptr(instance.meshToModelMatrix), sizeof(flatInstance.matrix));
+		fwrite(&flatInstance, sizeof(flatInstance), 1, file);
+	}
+
+	bool written = !ferror(file);
+	written = fclose(file) == 0 && written;
+	//Renaming does not replace an existing file on every platform, so the out of date cache file is removed first
+	std::remove(cachePath.c_str());
+	if (!written || std::rename(temporaryPath.c_str(), cachePath.c_str()) != 0)
+	{
+		std::cout << "WARNING: Could not write model cache file: " << cachePath << std::endl;
+		std::remove(temporaryPath.c_str());
+		return false;
+	}
+	return true;
+}
+
+std::string ModelCache::getCacheFilePath(const std::string & sourcePath)
+{
+	//Names the cache file after a hash of the source path so every source model gets its own file
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx.rtmc", (unsigned long long)MappedFile::hashBytes(sourcePath.data(), sourcePath.size()));
+	return cacheDirectory + "/" + name;
+}
+
+void ModelCache::flattenOctree(OctreeNode * root, std::vector<FlatNode> & nodes, std::vector<uint32_t> & leafContents)
+{
+	//Walks the octree breadth first, the children of each branch are queued together so they end up next to each other
+	std::vector<OctreeNode *> queue;
+	queue.push_back(root);
+	for (size_t i = 0; i < queue.size(); i++)
+	{
+		OctreeNode * node = queue[i];
+		FlatNode flatNode;
+		glm::vec3 center = node->boundingBox->getCenter();
+		glm::vec3 halfDistances = node->boundingBox->getHalfDistances();
+		for (int axis = 0; axis < 3; axis++)
+		{
+			flatNode.center[axis] = center[axis];
+			flatNode.halfDistances[axis] = halfDistances[axis];
+		}
+		flatNode.isLeaf = node->isLeafNode;
+		flatNode.childMask = 0;
+
+		if (node->isLeafNode)
+		{
+			LeafNode<uint32_t> * leafNode = (LeafNode<uint32_t> *)node;
+			flatNode.first = leafContents.size();
+			flatNode.count = leafNode->contents.size();
+			leafContents.insert(leafContents.end(), leafNode->contents.begin(), leafNode->contents.end());
+		}
+		else
+		{
+			BranchNode * branchNode = (BranchNode *)node;
+			flatNode.first = queue.size();
+			flatNode.count = 0;
+			for (uint32_t c = 0; c < 8; c++)
+			{
+				if (branchNode->children[c])
+				{
+					queue.push_back(branchNode->children[c]);
+					flatNode.childMask |= 1 << c;
+					flatNode.count++;
+				}
+			}
+		}
+		nodes.push_back(flatNode);
+	}
+}
+
+OctreeNode * ModelCache::buildNode(Octree<uint32_t> & octree, const FlatNode * nodes, uint32_t nodeCount, const uint32_t * leafContents, uint32_t leafContentCount, uint32_t faceCount, uint32_t index, OctreeNode * parent)
+{
+	//Nodes built before a damaged node is found are freed along with the octree
+	const FlatNode & flatNode = nodes[index];
+	glm::vec3 center(flatNode.center[0], flatNode.center[1], flatNode.center[2]);
+	glm::vec3 halfDistances(flatNode.halfDistances[0], flatNode.halfDistances[1], flatNode.halfDistances[2]);
+
+	if (flatNode.isLeaf)
+	{
+		if (flatNode.count > leafContentCount - std::min(flatNode.first, leafContentCount))
+		{
+			return nullptr;
+		}
+		//Leaves hold face indices, an index past the faces of the mesh would be read out of bounds when a ray reaches the leaf
+		for (uint32_t i = 0; i < flatNode.count; i++)
+		{
+			if (leafContents[flatNode.first + i] >= faceCount)
+			{
+				return nullptr;
+			}
+		}
+		LeafNode<uint32_t> * leafNode = octree.createLeaf(center, halfDistances, leafContents + flatNode.first, flatNode.count);
+		leafNode->parent = parent;
+		return leafNode;
+	}
+
+	BranchNode * branchNode = octree.createBranch(center, halfDistances);
+	branchNode->parent = parent;
+	uint32_t child = flatNode.first;
+	for (uint32_t c = 0; c < 8; c++)
+	{
+		if (!(flatNode.childMask & (1 << c)))
+		{
+			continue;
+		}
+
+		//Children always come after their parent in breadth first order, anything else means the file is damaged
+		OctreeNode * childNode = child > index && child < nodeCount ? buildNode(octree, nodes, nodeCount, leafContents, leafContentCount, faceCount, child, branchNode) : nullptr;
+		if (childNode == nullptr)
+		{
+			return nullptr;
+		}
+		branchNode->children[c] = childNode;
+		child++;
+	}
+	return branchNode;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+class Mesh;
+struct MeshInstance;
+class OctreeNode;
+
+template<typename T>
+class Octree;
+
+//Binary cache of imported models so later runs skip the import, the mesh conversion and the octree construction
+//A cache file holds the vertices, normals, texture coordinates and faces of every mesh along with its octree flattened into an array, followed by the instances placing the meshes in the model
+//The file is tagged with the hash of the source file and is read straight out of a memory mapping with no parsing
+class ModelCache
+{
+public:
+	//Directory the cache files are kept in, an empty directory turns the cache off
+	static void setCacheDirectory(const std::string & directory);
+
+	//Fills the mesh and instance lists from the cache file of the source if the cache file is up to date, returns false if the model has to be imported
+	static bool load(const std::string & sourcePath, std::vector<Mesh*> & meshList, std::vector<MeshInstance> & instanceList);
+	//Writes the meshes and instances of an imported model to the cache file of the source
+	static bool save(const std::string & sourcePath, const std::vector<Mesh*> & meshList, const std::vector<MeshInstance> & instanceList);
+
+private:
+	struct FileHeader
+	{
+		char magic[4];
+		uint32_t version;
+		uint64_t sourceSize;
+		uint64_t sourceHash;
+		uint32_t meshCount;
+		uint32_t instanceCount;
+	};
+
+	struct MeshHeader
+	{
+		uint32_t vertexCount;
+		uint32_t normalCount;
+		uint32_t textureCoordCount;
+		uint32_t faceCount;
+		uint32_t nodeCount;
+		uint32_t leafContentCount;
+	};
+
+	//Octree node in the flattened octree, the nodes are stored breadth first so the children of a branch are next to each other
+	struct FlatNode
+	{
+		float center[3];
+		float halfDistances[3];
+		uint32_t isLeaf;
+		//Bit i is set if the branch has child i
+		uint32_t childMask;
+		//Index of the first child for a branch, or of the first face index in the leaf contents for a leaf
+		uint32_t first;
+		uint32_t count;
+	};
+
+	struct FlatInstance
+	{
+		uint32_t meshIndex;
+		//Column major mesh to model matrix
+		float matrix[16];
+	};
+
+	static std::string cacheDirectory;
+
+	static std::string getCacheFilePath(const std::string & sourcePath);
+	static void flattenOctree(OctreeNode * root, std::vector<FlatNode> & nodes, std::vector<uint32_t> & leafContents);
+	static OctreeNode * buildNode(Octree<uint32_t> & octree, const FlatNode * nodes, uint32_t nodeCount, const uint32_t * leafContents, uint32_t leafContentCount, uint32_t faceCount, uint32_t index, OctreeNode * parent);
+};
\ No newline at end of file
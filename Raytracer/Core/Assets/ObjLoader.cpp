@@ -0,0 +1,462 @@
+#include "ObjLoader.h"
+
+#include "MappedFile.h"
+#include "../Objects/Models/Mesh.h"
+#include "../Threading/ThreadPool.h"
+
+#include <iostream>
+#include <algorithm>
+#include <future>
+#include <cmath>
+
+#include <glm/common.hpp>
+
+//Marks a face corner that has no texture coordinate or normal
+constexpr int32_t MISSING_INDEX = INT32_MIN;
+//Chunks are at least this many bytes so small files are parsed on one thread
+constexpr size_t MIN_CHUNK_BYTES = 256 * 1024;
+
+//Parsing gets its own pool since models are loaded on the asset loader's threads, which would deadlock waiting on tasks queued behind them
+static ThreadPool & getParsePool()
+{
+	static ThreadPool parsePool;
+	return parsePool;
+}
+
+static bool isSpace(char c)
+{
+	return c == ' ' || c == '\t' || c == '\r';
+}
+
+static void skipSpaces(const char *& cursor, const char * end)
+{
+	while (cursor < end && isSpace(*cursor))
+	{
+		cursor++;
+	}
+}
+
+static bool parseInteger(const char *& cursor, const char * end, int32_t & value)
+{
+	bool negative = cursor < end && *cursor == '-';
+	if (negative || (cursor < end && *cursor == '+'))
+	{
+		cursor++;
+	}
+
+	const char * start = cursor;
+	int64_t result = 0;
+	while (cursor < end && *cursor >= '0' && *cursor <= '9' && result <= INT32_MAX)
+	{
+		result = result * 10 + (*cursor - '0');
+		cursor++;
+	}
+	value = (int32_t)(negative ? -result : result);
+	return cursor != start && result <= INT32_MAX;
+}
+
+//Locale independent float parser for the plain decimal and exponent forms OBJ exporters write
+static bool parseFloat(const char *& cursor, const char * end, float & value)
+{
+	skipSpaces(cursor, end);
+	bool negative = cursor < end && *cursor == '-';
+	if (negative || (cursor < end && *cursor == '+'))
+	{
+		cursor++;
+	}
+
+	//The digits are gathered into an integer and scaled once at the end so the result rounds the same as strtof for typical inputs
+	const char * start = cursor;
+	uint64_t mantissa = 0;
+	int32_t exponent = 0;
+	while (cursor < end && *cursor >= '0' && *cursor <= '9')
+	{
+		if (mantissa < 100000000000000000ull)
+		{
+			mantissa = mantissa * 10 + (*cursor - '0');
+		}
+		else
+		{
+			exponent++;
+		}
+		cursor++;
+	}
+	if (cursor < end && *cursor == '.')
+	{
+		cursor++;
+		while (cursor < end && *cursor >= '0' && *cursor <= '9')
+		{
+			if (mantissa < 100000000000000000ull)
+			{
+				mantissa = mantissa * 10 + (*cursor - '0');
+				exponent--;
+			}
+			cursor++;
+		}
+	}
+	if (cursor == start || (cursor == start + 1 && *start == '.'))
+	{
+		return false;
+	}
+	if (cursor < end && (*cursor == 'e' || *cursor == 'E'))
+	{
+		cursor++;
+		int32_t writtenExponent;
+		if (!parseInteger(cursor, end, writtenExponent))
+		{
+			return false;
+		}
+		exponent += writtenExponent;
+	}
+
+	double result = exponent < 0 ? mantissa / pow(10.0, -exponent) : mantissa * pow(10.0, exponent);
+	value = (float)(negative ? -result : result);
+	return true;
+}
+
+static bool isKeyword(const char * cursor, const char * end, const char * keyword, size_t length)
+{
+	return (size_t)(end - cursor) > length && std::equal(keyword, keyword + length, cursor) && isSpace(cursor[length]);
+}
+
+bool ObjLoader::isObjFile(const std::string & path)
+{
+	if (path.size() < 4)
+	{
+		return false;
+	}
+	std::string extension = path.substr(path.size() - 4);
+	std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+	return extension == ".obj";
+}
+
+bool ObjLoader::load(const std::string & path, std::vector<Mesh*> & meshList)
+{
+	MappedFile file;
+	if (!file.open(path.c_str()))
+	{
+		return false;
+	}
+	const char * data = (const char *)file.getData();
+	const char * dataEnd = data + file.getSize();
+
+	//Splits the file into chunks that end on line breaks so every line is parsed by exactly one chunk
+	ThreadPool & parsePool = getParsePool();
+	size_t chunkCount = std::max<size_t>(1, std::min<size_t>(parsePool.getThreadCount() * 4, file.getSize() / MIN_CHUNK_BYTES));
+	std::vector<Chunk> chunks(chunkCount);
+	const char * chunkBegin = data;
+	for (size_t i = 0; i < chunkCount; i++)
+	{
+		const char * chunkEnd = i + 1 == chunkCount ? dataEnd : std::max(chunkBegin, data + file.getSize() * (i + 1) / chunkCount);
+		while (chunkEnd < dataEnd && chunkEnd[-1] != '\n')
+		{
+			chunkEnd++;
+		}
+		chunks[i].begin = chunkBegin;
+		chunks[i].end = chunkEnd;
+		chunkBegin = chunkEnd;
+	}
+
+	std::vector<std::future<void>> tasks;
+	for (Chunk & chunk : chunks)
+	{
+		tasks.push_back(parsePool.submit([&chunk]() { parseChunk(chunk); }));
+	}
+	for (std::future<void> & task : tasks)
+	{
+		task.wait();
+	}
+
+	//Joins the attributes of all the chunks and works out where each chunk's attributes and triangles start
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec2> textureCoords;
+	std::vector<glm::vec3> normals;
+	std::vector<uint32_t> meshStarts;
+	uint32_t triangleCount = 0;
+	for (Chunk & chunk : chunks)
+	{
+		if (!chunk.valid)
+		{
+			std::cout << "WARNING: Could not parse OBJ file: " << path << std::endl;
+			return false;
+		}
+		chunk.positionOffset = positions.size();
+		chunk.textureCoordOffset = textureCoords.size();
+		chunk.normalOffset = normals.size();
+		chunk.triangleOffset = triangleCount;
+		positions.insert(positions.end(), chunk.positions.begin(), chunk.positions.end());
+		textureCoords.insert(textureCoords.end(), chunk.textureCoords.begin(), chunk.textureCoords.end());
+		normals.insert(normals.end(), chunk.normals.begin(), chunk.normals.end());
+		for (uint32_t start : chunk.meshStarts)
+		{
+			meshStarts.push_back(chunk.triangleOffset + start);
+		}
+		triangleCount += chunk.corners.size() / 3;
+	}
+	meshStarts.push_back(triangleCount);
+
+	//Creates a mesh for every object or material with faces, sized up front so the chunks can fill them in parallel
+	std::vector<MeshRange> meshRanges;
+	uint32_t firstTriangle = 0;
+	for (uint32_t start : meshStarts)
+	{
+		if (start > firstTriangle)
+		{
+			MeshRange range;
+			range.mesh = new Mesh();
+			range.firstTriangle = firstTriangle;
+			range.triangleCount = start - firstTriangle;
+			meshRanges.push_back(range);
+		}
+		firstTriangle = std::max(firstTriangle, start);
+	}
+
+	//A mesh gets texture coordinates or normals if any of its corners has them, as Assimp does
+	size_t rangeIndex = 0;
+	std::vector<bool> hasTextureCoords(meshRanges.size(), false);
+	std::vector<bool> hasNormals(meshRanges.size(), false);
+	for (const Chunk & chunk : chunks)
+	{
+		for (size_t c = 0; c < chunk.corners.size(); c++)
+		{
+			uint32_t triangle = chunk.triangleOffset + (uint32_t)(c / 3);
+			while (triangle >= meshRanges[rangeIndex].firstTriangle + meshRanges[rangeIndex].triangleCount)
+			{
+				rangeIndex++;
+			}
+			hasTextureCoords[rangeIndex] = hasTextureCoords[rangeIndex] || chunk.corners[c].textureCoord != MISSING_INDEX;
+			hasNormals[rangeIndex] = hasNormals[rangeIndex] || chunk.corners[c].normal != MISSING_INDEX;
+		}
+	}
+	for (size_t i = 0; i < meshRanges.size(); i++)
+	{
+		Mesh * mesh = meshRanges[i].mesh;
+		uint32_t vertexCount = meshRanges[i].triangleCount * 3;
+		mesh->vertices.resize(vertexCount);
+		mesh->faces.resize(meshRanges[i].triangleCount);
+		if (hasTextureCoords[i])
+		{
+			mesh->textureCoords.resize(vertexCount, glm::vec2(0.0f));
+		}
+		if (hasNormals[i])
+		{
+			mesh->normals.resize(vertexCount, glm::vec3(0.0f));
+		}
+	}
+
+	std::vector<std::future<bool>> fillTasks;
+	for (const Chunk & chunk : chunks)
+	{
+		fillTasks.push_back(parsePool.submit([&]() { return fillMeshes(chunk, meshRanges, positions, textureCoords, normals); }));
+	}
+	bool valid = true;
+	for (std::future<bool> & task : fillTasks)
+	{
+		valid = task.get() && valid;
+	}
+
+	if (!valid)
+	{
+		std::cout << "WARNING: OBJ file has face indices out of range: " << path << std::endl;
+		for (MeshRange & range : meshRanges)
+		{
+			delete range.mesh;
+		}
+		return false;
+	}
+
+	for (MeshRange & range : meshRanges)
+	{
+		meshList.push_back(range.mesh);
+	}
+	return true;
+}
+
+bool ObjLoader::loadBounds(const std::string & path, glm::vec3 & minPoint, glm::vec3 & maxPoint)
+{
+	MappedFile file;
+	if (!file.open(path.c_str()))
+	{
+		return false;
+	}
+	const char * cursor = (const char *)file.getData();
+	const char * end = cursor + file.getSize();
+
+	//Positions are parsed the same way as by load so the bounds match the loaded vertices exactly
+	bool found = false;
+	while (cursor < end)
+	{
+		const char * lineEnd = std::find(cursor, end, '\n');
+		skipSpaces(cursor, lineEnd);
+		if (isKeyword(cursor, lineEnd, "v", 1))
+		{
+			cursor += 1;
+			glm::vec3 position;
+			if (!parseFloat(cursor, lineEnd, position.x) || !parseFloat(cursor, lineEnd, position.y) || !parseFloat(cursor, lineEnd, position.z))
+			{
+				return false;
+			}
+			minPoint = found ? glm::min(minPoint, position) : position;
+			maxPoint = found ? glm::max(maxPoint, position) : position;
+			found = true;
+		}
+		cursor = lineEnd + 1;
+	}
+	return found;
+}
+
+void ObjLoader::parseChunk(Chunk & chunk)
+{
+	chunk.valid = true;
+	const char * cursor = chunk.begin;
+	const char * end = chunk.end;
+	std::vector<Corner> faceCorners;
+	while (cursor < end && chunk.valid)
+	{
+		const char * lineEnd = std::find(cursor, end, '\n');
+		skipSpaces(cursor, lineEnd);
+
+		if (isKeyword(cursor, lineEnd, "v", 1))
+		{
+			cursor += 1;
+			glm::vec3 position;
+			chunk.valid = parseFloat(cursor, lineEnd, position.x) && parseFloat(cursor, lineEnd, position.y) && parseFloat(cursor, lineEnd, position.z);
+			chunk.positions.push_back(position);
+		}
+		else if (isKeyword(cursor, lineEnd, "vt", 2))
+		{
+			cursor += 2;
+			glm::vec2 textureCoord;
+			chunk.valid = parseFloat(cursor, lineEnd, textureCoord.x) && parseFloat(cursor, lineEnd, textureCoord.y);
+			//Flips the v coordinate the same way aiProcess_FlipUVs does
+			textureCoord.y = 1.0f - textureCoord.y;
+			chunk.textureCoords.push_back(textureCoord);
+		}
+		else if (isKeyword(cursor, lineEnd, "vn", 2))
+		{
+			cursor += 2;
+			glm::vec3 normal;
+			chunk.valid = parseFloat(cursor, lineEnd, normal.x) && parseFloat(cursor, lineEnd, normal.y) && parseFloat(cursor, lineEnd, normal.z);
+			chunk.normals.push_back(normal);
+		}
+		else if (isKeyword(cursor, lineEnd, "f", 1))
+		{
+			cursor += 1;
+			faceCorners.clear();
+			skipSpaces(cursor, lineEnd);
+			while (cursor < lineEnd)
+			{
+				Corner corner;
+				if (!parseCorner(cursor, lineEnd, chunk, corner))
+				{
+					chunk.valid = false;
+					break;
+				}
+				faceCorners.push_back(corner);
+				skipSpaces(cursor, lineEnd);
+			}
+			chunk.valid = chunk.valid && faceCorners.size() >= 3;
+			//Triangulates the polygon as a fan around its first corner
+			for (size_t i = 1; i + 1 < faceCorners.size(); i++)
+			{
+				chunk.corners.push_back(faceCorners[0]);
+				chunk.corners.push_back(faceCorners[i]);
+				chunk.corners.push_back(faceCorners[i + 1]);
+			}
+		}
+		else if (isKeyword(cursor, lineEnd, "o", 1) || isKeyword(cursor, lineEnd, "usemtl", 6))
+		{
+			chunk.meshStarts.push_back(chunk.corners.size() / 3);
+		}
+
+		cursor = lineEnd + 1;
+	}
+}
+
+bool ObjLoader::parseCorner(const char *& cursor, const char * end, const Chunk & chunk, Corner & corner)
+{
+	//Positive indices count from the start of the file, negative ones back from the last attribute read so they are stored relative to this chunk
+	int32_t * indices[3] = { &corner.position, &corner.textureCoord, &corner.normal };
+	size_t counts[3] = { chunk.positions.size(), chunk.textureCoords.size(), chunk.normals.size() };
+	for (int i = 0; i < 3; i++)
+	{
+		int32_t index;
+		*indices[i] = MISSING_INDEX;
+		if (i > 0 && (cursor >= end || *cursor != '/'))
+		{
+			continue;
+		}
+		if (i > 0)
+		{
+			cursor++;
+			//An empty slot such as 1//3 has no texture coordinate
+			if (cursor < end && *cursor == '/')
+			{
+				continue;
+			}
+		}
+		if (!parseInteger(cursor, end, index) || index == 0 || (index < 0 && (size_t)-index > counts[i]))
+		{
+			return false;
+		}
+		*indices[i] = index > 0 ? index - 1 : -((int32_t)counts[i] + index) - 1;
+	}
+	return true;
+}
+
+bool ObjLoader::fillMeshes(const Chunk & chunk, const std::vector<MeshRange> & meshRanges, const std::vector<glm::vec3> & positions, const std::vector<glm::vec2> & textureCoords, const std::vector<glm::vec3> & normals)
+{
+	//Finds the mesh holding the first triangle of the chunk, the meshes are in triangle order
+	size_t rangeIndex = 0;
+	while (rangeIndex < meshRanges.size() && chunk.triangleOffset >= meshRanges[rangeIndex].firstTriangle + meshRanges[rangeIndex].triangleCount)
+	{
+		rangeIndex++;
+	}
+
+	for (size_t c = 0; c < chunk.corners.size(); c += 3)
+	{
+		uint32_t triangle = chunk.triangleOffset + (uint32_t)(c / 3);
+		while (triangle >= meshRanges[rangeIndex].firstTriangle + meshRanges[rangeIndex].triangleCount)
+		{
+			rangeIndex++;
+		}
+		Mesh * mesh = meshRanges[rangeIndex].mesh;
+		uint32_t face = triangle - meshRanges[rangeIndex].firstTriangle;
+
+		for (uint32_t j = 0; j < 3; j++)
+		{
+			const Corner & corner = chunk.corners[c + j];
+			uint32_t vertex = face * 3 + j;
+			//Relative indices are made absolute now that the offsets of the chunk are known
+			uint32_t position = corner.position >= 0 ? corner.position : chunk.positionOffset - corner.position - 1;
+			if (position >= positions.size())
+			{
+				return false;
+			}
+			mesh->vertices[vertex] = positions[position];
+
+			if (corner.textureCoord != MISSING_INDEX)
+			{
+				uint32_t textureCoord = corner.textureCoord >= 0 ? corner.textureCoord : chunk.textureCoordOffset - corner.textureCoord - 1;
+				if (textureCoord >= textureCoords.size())
+				{
+					return false;
+				}
+				mesh->textureCoords[vertex] = textureCoords[textureCoord];
+			}
+
+			if (corner.normal != MISSING_INDEX)
+			{
+				uint32_t normal = corner.normal >= 0 ? corner.normal : chunk.normalOffset - corner.normal - 1;
+				if (normal >= normals.size())
+				{
+					return false;
+				}
+				mesh->normals[vertex] = normals[normal];
+			}
+			mesh->faces[face].indices[j] = vertex;
+		}
+		mesh->faces[face].material = nullptr;
+	}
+	return true;
+}
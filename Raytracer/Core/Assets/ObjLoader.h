@@ -0,0 +1,64 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+
+class Mesh;
+
+//Reader for Wavefront OBJ files that skips Assimp for the common case
+//The file is memory mapped and split into chunks of whole lines that are parsed on a pool of threads, the parsed faces are then written straight into the mesh vectors
+//The output matches what Assimp gives with aiProcess_Triangulate and aiProcess_FlipUVs, every face corner becomes its own vertex and a new mesh starts at every object or material
+//Material libraries are not read since models get their materials from the entities that use them
+class ObjLoader
+{
+public:
+	static bool isObjFile(const std::string & path);
+
+	//Appends the meshes in the OBJ file to the mesh list without building their octrees, returns false if the file could not be read or is malformed
+	static bool load(const std::string & path, std::vector<Mesh*> & meshList);
+	//Finds the bounds of every vertex position in the OBJ file without reading anything else, returns false if the file could not be read or has no positions
+	static bool loadBounds(const std::string & path, glm::vec3 & minPoint, glm::vec3 & maxPoint);
+
+private:
+	//Index of a vertex attribute in a face corner, relative indices are kept relative to the chunk until the chunk offsets are known
+	struct Corner
+	{
+		int32_t position;
+		int32_t textureCoord;
+		int32_t normal;
+	};
+
+	struct Chunk
+	{
+		const char * begin;
+		const char * end;
+		std::vector<glm::vec3> positions;
+		std::vector<glm::vec2> textureCoords;
+		std::vector<glm::vec3> normals;
+		//Three corners for every triangle in the chunk
+		std::vector<Corner> corners;
+		//Triangle indices in the chunk where a new object or material starts
+		std::vector<uint32_t> meshStarts;
+		bool valid;
+		//Number of attributes and triangles in the chunks before this one
+		uint32_t positionOffset;
+		uint32_t textureCoordOffset;
+		uint32_t normalOffset;
+		uint32_t triangleOffset;
+	};
+
+	struct MeshRange
+	{
+		Mesh * mesh;
+		uint32_t firstTriangle;
+		uint32_t triangleCount;
+	};
+
+	static void parseChunk(Chunk & chunk);
+	static bool parseCorner(const char *& cursor, const char * end, const Chunk & chunk, Corner & corner);
+	static bool fillMeshes(const Chunk & chunk, const std::vector<MeshRange> & meshRanges, const std::vector<glm::vec3> & positions, const std::vector<glm::vec2> & textureCoords, const std::vector<glm::vec3> & normals);
+};
\ No newline at end of file
@@ -0,0 +1,85 @@
+#include "LazyOctreeBenchmark.h"
+
+#include "../Objects/Entity.h"
+#include "../Objects/Models/Model.h"
+#include "../Renderer/Materials/Material.h"
+#include "../Renderer/Ray.h"
+#include "../Math/MathFunctions.h"
+
+#include <glm/geometric.hpp>
+#include <glm/trigonometric.hpp>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+LazyOctreeBenchmark::LazyOctreeBenchmark(uint32_t width, uint32_t height) : imageWidth(width), imageHeight(height)
+{
+}
+
+void LazyOctreeBenchmark::run(const std::string & visiblePath, const std::string & largePath)
+{
+	//The large model is a ceiling over the visible model or is moved behind the camera
+	runScene("large model off screen", visiblePath, largePath, glm::vec3(0.0f, 5.0f, 40.0f));
+	runScene("large model in view", visiblePath, largePath, glm::vec3(0.0f, 5.0f, -8.0f));
+	Model::setLazyOctrees(false);
+}
+
+void LazyOctreeBenchmark::runScene(const char * name, const std::string & visiblePath, const std::string & largePath, const glm::vec3 & largePosition)
+{
+	printf("%s (%s, %s)\n", name, visiblePath.c_str(), largePath.c_str());
+	runMode(false, visiblePath, largePath, largePosition);
+	runMode(true, visiblePath, largePath, largePosition);
+}
+
+void LazyOctreeBenchmark::runMode(bool lazy, const std::string & visiblePath, const std::string & largePath, const glm::vec3 & largePosition)
+{
+	Model::setLazyOctrees(lazy);
+	auto loadStart = std::chrono::high_resolution_clock::now();
+	Model visibleModel(visiblePath);
+	Model largeModel(largePath);
+	auto loadEnd = std::chrono::high_resolution_clock::now();
+	if (visibleModel.getMeshList().empty() || largeModel.getMeshList().empty())
+	{
+		return;
+	}
+	size_t startupOctreeBytes = visibleModel.getOctreeMemoryUsage() + largeModel.getOctreeMemoryUsage();
+
+	Material material;
+	Entity visibleEntity(glm::vec3(0.0f, 1.0f, -8.0f), 1.0f, &visibleModel, &material);
+	Entity largeEntity(largePosition, 1.0f, &largeModel, &material);
+
+	//Primary rays of the camera of the main scene, the nearest of the two entities is kept like the renderer does
+	const glm::vec3 origin(0.0f, 2.5f, 2.0f);
+	float tangent = std::tan(glm::radians(45.0f) * 0.5f);
+	float aspectRatio = (float)imageWidth / (float)imageHeight;
+	uint32_t hits = 0;
+	auto rayStart = std::chrono::high_resolution_clock::now();
+	for (uint32_t y = 0; y < imageHeight; y++)
+	{
+		for (uint32_t x = 0; x < imageWidth; x++)
+		{
+			float pixelX = (2.0f * (x + 0.5f) / imageWidth - 1.0f) * tangent * aspectRatio;
+			float pixelY = (1.0f - 2.0f * (y + 0.5f) / imageHeight) * tangent;
+			Ray ray(origin, glm::normalize(glm::vec3(pixelX, pixelY, -1.0f)));
+
+			float nearest = MathFunctions::T_INFINITY;
+			IntersectionData intersectionData;
+			for (Entity * entity : { &visibleEntity, &largeEntity })
+			{
+				float parameter = MathFunctions::T_INFINITY;
+				if (entity->intersect(ray, parameter, intersectionData) && parameter < nearest)
+				{
+					nearest = parameter;
+				}
+			}
+			hits += nearest != MathFunctions::T_INFINITY;
+		}
+	}
+	auto rayEnd = std::chrono::high_resolution_clock::now();
+
+	double startupTime = std::chrono::duration<double, std::milli>(loadEnd - loadStart).count();
+	double rayTime = std::chrono::duration<double, std::milli>(rayEnd - rayStart).count();
+	size_t octreeBytes = visibleModel.getOctreeMemoryUsage() + largeModel.getOctreeMemoryUsage();
+	printf("  %-6s startup %8.1f ms  rays %8.1f ms  total %8.1f ms  octrees %8.1f KB at startup, %8.1f KB after rays  %u hits\n", lazy ? "lazy" : "eager", startupTime, rayTime, startupTime + rayTime, startupOctreeBytes / 1024.0, octreeBytes / 1024.0, hits);
+}
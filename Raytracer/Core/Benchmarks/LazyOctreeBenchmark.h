@@ -0,0 +1,24 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+
+#include <glm/vec3.hpp>
+
+//Benchmark comparing eagerly and lazily built octrees on a scene with a small model in view and a large model that is either off screen or in view
+//Startup is the time to import both models and the rays are the primary rays of a camera, so the total shows what lazy building saves or costs
+//Models are imported from their source files, the model cache has to be turned off for the octrees to be built at all
+class LazyOctreeBenchmark
+{
+public:
+	LazyOctreeBenchmark(uint32_t width, uint32_t height);
+
+	void run(const std::string & visiblePath, const std::string & largePath);
+
+private:
+	uint32_t imageWidth;
+	uint32_t imageHeight;
+
+	void runScene(const char * name, const std::string & visiblePath, const std::string & largePath, const glm::vec3 & largePosition);
+	void runMode(bool lazy, const std::string & visiblePath, const std::string & largePath, const glm::vec3 & largePosition);
+};
\ No newline at end of file
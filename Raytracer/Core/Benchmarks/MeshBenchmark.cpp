@@ -0,0 +1,103 @@
+#include "MeshBenchmark.h"
+
+#include "../Objects/Entity.h"
+#include "../Objects/Models/Model.h"
+#include "../Objects/Models/Mesh.h"
+#include "../Renderer/Materials/Material.h"
+#include "../Renderer/Ray.h"
+#include "../Geometry/AABB.h"
+#include "../Math/MathFunctions.h"
+
+#include <glm/geometric.hpp>
+
+#include <chrono>
+#include <random>
+#include <cstdio>
+
+MeshBenchmark::MeshBenchmark(uint32_t rays) : rayCount(rays)
+{
+}
+
+void MeshBenchmark::run(const std::string & path)
+{
+	Model model(path);
+	if (model.getMeshList().empty())
+	{
+		return;
+	}
+	Material material;
+	Entity entity(glm::vec3(0.0f), 1.0f, &model, &material);
+
+	AABB * boundingBox = model.getModelBoundingBox() ? model.getModelBoundingBox() : model.getMeshList()[0]->getBoundingBox();
+	glm::vec3 center = boundingBox->getCenter();
+	glm::vec3 halfDistances = boundingBox->getHalfDistances();
+	float radius = glm::length(halfDistances) * 2.0f;
+
+	//Rays start on a sphere around the model and aim at random points in its bounding box so most of them hit
+	std::mt19937 generator(1234);
+	std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+	std::vector<Ray> rays;
+	rays.reserve(rayCount);
+	for (uint32_t i = 0; i < rayCount; i++)
+	{
+		glm::vec3 direction;
+		do
+		{
+			direction = glm::vec3(distribution(generator), distribution(generator), distribution(generator));
+		} while (glm::dot(direction, direction) < 0.01f || glm::dot(direction, direction) > 1.0f);
+		glm::vec3 origin = center + glm::normalize(direction) * radius;
+		glm::vec3 target = center + halfDistances * glm::vec3(distribution(generator), distribution(generator), distribution(generator));
+		rays.push_back(Ray(origin, glm::normalize(target - origin)));
+	}
+
+	//Each stage keeps the changes of the ones before it, so the last stage is the fully compressed model
+	printf("%s\n", path.c_str());
+	std::vector<glm::vec3> fullNormals;
+	double fullTime = timeRays(entity, rays, fullNormals);
+	printStage("full", model, fullTime, fullTime, 0.0f);
+
+	std::vector<glm::vec3> normals;
+	model.quantizeOctrees();
+	double time = timeRays(entity, rays, normals);
+	printStage("quantized octree", model, fullTime, time, getMaxNormalError(fullNormals, normals));
+
+	model.compactMeshes();
+	time = timeRays(entity, rays, normals);
+	printStage("+ compact mesh", model, fullTime, time, getMaxNormalError(fullNormals, normals));
+}
+
+void MeshBenchmark::printStage(const char * name, Model & model, double fullTime, double time, float maxNormalError)
+{
+	printf("  %-18s mesh %9.1f KB  octree %9.1f KB  %7.3f Mrays/s  %5.2fx speed  max normal change %.5f\n", name, model.getMemoryUsage() / 1024.0, model.getOctreeMemoryUsage() / 1024.0, rayCount / time / 1e6, fullTime / time, maxNormalError);
+}
+
+float MeshBenchmark::getMaxNormalError(const std::vector<glm::vec3> & fullNormals, const std::vector<glm::vec3> & normals)
+{
+	//The largest change in a shaded normal shows how much precision a stage gives up, or where it hits a different face
+	float maxNormalError = 0.0f;
+	for (uint32_t i = 0; i < fullNormals.size(); i++)
+	{
+		maxNormalError = std::max(maxNormalError, glm::length(fullNormals[i] - normals[i]));
+	}
+	return maxNormalError;
+}
+
+double MeshBenchmark::timeRays(Entity & entity, const std::vector<Ray> & rays, std::vector<glm::vec3> & normals)
+{
+	normals.assign(rays.size(), glm::vec3(0.0f));
+	auto startTime = std::chrono::high_resolution_clock::now();
+	for (uint32_t i = 0; i < rays.size(); i++)
+	{
+		float parameter = MathFunctions::T_INFINITY;
+		IntersectionData intersectionData;
+		if (entity.intersect(rays[i], parameter, intersectionData))
+		{
+			glm::vec3 point = rays[i].getOrigin() + rays[i].getDirectionVector() * parameter;
+			glm::vec2 textureCoords;
+			Material * material;
+			entity.getSurfaceData(point, intersectionData, normals[i], textureCoords, material);
+		}
+	}
+	auto endTime = std::chrono::high_resolution_clock::now();
+	return std::chrono::duration<double>(endTime - startTime).count();
+}
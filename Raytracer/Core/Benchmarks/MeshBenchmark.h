@@ -0,0 +1,29 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include <glm/vec3.hpp>
+
+class Ray;
+class Entity;
+class Model;
+
+//Benchmark comparing a model in its full format against the same model with quantized octrees and compact meshes
+//The same set of rays is traced against the model and every hit is shaded in each format, so the cost of decoding the compressed data is included
+class MeshBenchmark
+{
+public:
+	MeshBenchmark(uint32_t rays);
+
+	//Loads the model and prints its memory use and traced rays per second as it is quantized and compacted
+	void run(const std::string & path);
+
+private:
+	uint32_t rayCount;
+
+	double timeRays(Entity & entity, const std::vector<Ray> & rays, std::vector<glm::vec3> & normals);
+	void printStage(const char * name, Model & model, double fullTime, double time, float maxNormalError);
+	float getMaxNormalError(const std::vector<glm::vec3> & fullNormals, const std::vector<glm::vec3> & normals);
+};
\ No newline at end of file
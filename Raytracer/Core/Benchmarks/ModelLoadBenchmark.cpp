@@ -0,0 +1,103 @@
+#include "ModelLoadBenchmark.h"
+
+#include "../Assets/ObjLoader.h"
+#include "../Assets/MappedFile.h"
+#include "../Objects/Models/Mesh.h"
+
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <cstdio>
+
+ModelLoadBenchmark::ModelLoadBenchmark(uint32_t repetitions) : repetitionCount(repetitions)
+{
+}
+
+void ModelLoadBenchmark::run(const std::string & path)
+{
+	uint64_t fileSize, fileHash;
+	if (!MappedFile::hashFile(path.c_str(), fileSize, fileHash))
+	{
+		std::cout << "WARNING: Could not open model for benchmarking: " << path << std::endl;
+		return;
+	}
+
+	//Reads the file once first so both loaders start with it in the file cache
+	timeNative(path);
+
+	double megabytes = fileSize / (1024.0 * 1024.0);
+	double assimpTime = timeAssimp(path);
+	double nativeTime = timeNative(path);
+	printf("%-40s %8.2f MB  Assimp %8.1f MB/s  native %8.1f MB/s  %6.2fx\n", path.c_str(), megabytes, megabytes / assimpTime, megabytes / nativeTime, assimpTime / nativeTime);
+}
+
+double ModelLoadBenchmark::timeAssimp(const std::string & path)
+{
+	auto startTime = std::chrono::high_resolution_clock::now();
+	for (uint32_t i = 0; i < repetitionCount; i++)
+	{
+		Assimp::Importer importer;
+		importer.ReadFile(path, aiProcess_FlipUVs | aiProcess_Triangulate);
+	}
+	auto endTime = std::chrono::high_resolution_clock::now();
+	return std::chrono::duration<double>(endTime - startTime).count() / repetitionCount;
+}
+
+double ModelLoadBenchmark::timeNative(const std::string & path)
+{
+	auto startTime = std::chrono::high_resolution_clock::now();
+	for (uint32_t i = 0; i < repetitionCount; i++)
+	{
+		std::vector<Mesh*> meshList;
+		ObjLoader::load(path, meshList);
+		for (Mesh * mesh : meshList)
+		{
+			delete mesh;
+		}
+	}
+	auto endTime = std::chrono::high_resolution_clock::now();
+	return std::chrono::duration<double>(endTime - startTime).count() / repetitionCount;
+}
+
+bool ModelLoadBenchmark::writeSyntheticObj(const std::string & path, uint32_t resolution, float size)
+{
+	FILE * file = fopen(path.c_str(), "w");
+	if (file == nullptr)
+	{
+		std::cout << "WARNING: Could not write synthetic model: " << path << std::endl;
+		return false;
+	}
+
+	//A gently curved grid of (resolution + 1)^2 vertices made of resolution^2 quads
+	fprintf(file, "o Synthetic_Grid\n");
+	for (uint32_t y = 0; y <= resolution; y++)
+	{
+		for (uint32_t x = 0; x <= resolution; x++)
+		{
+			float u = x / (float)resolution;
+			float v = y / (float)resolution;
+			fprintf(file, "v %f %f %f\n", (u * 2.0f - 1.0f) * size, 0.1f * size * (u * u + v * v), (v * 2.0f - 1.0f) * size);
+			fprintf(file, "vt %f %f\n", u, v);
+			fprintf(file, "vn %f %f %f\n", 0.0f, 1.0f, 0.0f);
+		}
+	}
+	for (uint32_t y = 0; y < resolution; y++)
+	{
+		for (uint32_t x = 0; x < resolution; x++)
+		{
+			uint32_t i0 = y * (resolution + 1) + x + 1;
+			uint32_t i1 = i0 + 1;
+			uint32_t i2 = i1 + resolution + 1;
+			uint32_t i3 = i0 + resolution + 1;
+			fprintf(file, "f %u/%u/%u %u/%u/%u %u/%u/%u %u/%u/%u\n", i0, i0, i0, i1, i1, i1, i2, i2, i2, i3, i3, i3);
+		}
+	}
+
+	bool failed = ferror(file) != 0;
+	fclose(file);
+	return !failed;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+
+//Benchmark comparing how fast OBJ files are read by Assimp and by the native ObjLoader
+class ModelLoadBenchmark
+{
+public:
+	ModelLoadBenchmark(uint32_t repetitions);
+
+	//Reads the file both ways and prints the throughput of each in MB/s
+	//The Assimp time covers reading the file into an aiScene but not converting it into meshes, so the comparison favours Assimp
+	void run(const std::string & path);
+
+	//Writes a grid mesh with positions, texture coordinates and normals as an OBJ file, for timing files much larger than the bundled models
+	//The grid spans the size in both directions from its center, fine grids need a larger size for their triangles to be hit within MathFunctions::EPSILON
+	static bool writeSyntheticObj(const std::string & path, uint32_t resolution, float size = 1.0f);
+
+private:
+	uint32_t repetitionCount;
+
+	double timeAssimp(const std::string & path);
+	double timeNative(const std::string & path);
+};
\ No newline at end of file
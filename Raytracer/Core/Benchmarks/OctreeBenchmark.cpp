@@ -0,0 +1,117 @@
+#include "OctreeBenchmark.h"
+
+#include "../Objects/Models/Model.h"
+#include "../Objects/Models/Mesh.h"
+#include "../DataStructures/Octree.h"
+
+#include <chrono>
+#include <cstdio>
+#include <algorithm>
+
+constexpr uintptr_t PAGE_SHIFT = 12;
+
+OctreeBenchmark::OctreeBenchmark(uint32_t repetitions) : repetitionCount(repetitions)
+{
+}
+
+void OctreeBenchmark::run(const std::string & path)
+{
+	Model model(path);
+	double heapBuild = 0.0, heapTeardown = 0.0, arenaBuild = 0.0, arenaTeardown = 0.0;
+	size_t heapPages = 0, heapBytes = 0, arenaPages = 0, arenaBytes = 0;
+	for (Mesh * mesh : model.getMeshList())
+	{
+		double buildTime, teardownTime;
+		size_t pageCount, bytes;
+		timeOctree(mesh, false, buildTime, teardownTime, pageCount, bytes);
+		heapBuild += buildTime;
+		heapTeardown += teardownTime;
+		heapPages += pageCount;
+		heapBytes += bytes;
+
+		timeOctree(mesh, true, buildTime, teardownTime, pageCount, bytes);
+		arenaBuild += buildTime;
+		arenaTeardown += teardownTime;
+		arenaPages += pageCount;
+		arenaBytes += bytes;
+	}
+
+	//The ideal page count is the number of pages the used bytes would take if they were packed together
+	printf("%s\n", path.c_str());
+	printf("  heap   build %8.2f ms  teardown %7.3f ms  %6zu pages for %8.1f KB (%.2fx ideal)\n", heapBuild, heapTeardown, heapPages, heapBytes / 1024.0, heapPages / std::max(1.0, heapBytes / 4096.0));
+	printf("  arena  build %8.2f ms  teardown %7.3f ms  %6zu pages for %8.1f KB (%.2fx ideal)\n", arenaBuild, arenaTeardown, arenaPages, arenaBytes / 1024.0, arenaPages / std::max(1.0, arenaBytes / 4096.0));
+}
+
+void OctreeBenchmark::timeOctree(const Mesh * source, bool useArena, double & buildTime, double & teardownTime, size_t & pageCount, size_t & bytes)
+{
+	//Octrees are built on a copy so the model keeps its own octree
+	Mesh mesh;
+	mesh.vertices = source->vertices;
+	mesh.faces = source->faces;
+
+	buildTime = 0.0;
+	teardownTime = 0.0;
+	for (uint32_t i = 0; i < this->repetitionCount; i++)
+	{
+		auto buildStart = std::chrono::high_resolution_clock::now();
+		mesh.constructOctree(useArena);
+		auto buildEnd = std::chrono::high_resolution_clock::now();
+
+		if (i == 0)
+		{
+			std::unordered_set<uintptr_t> pages;
+			bytes = 0;
+			collectPages(mesh.boundingOctree->root, pages, bytes);
+			pageCount = pages.size();
+		}
+
+		auto teardownStart = std::chrono::high_resolution_clock::now();
+		delete mesh.boundingOctree;
+		mesh.boundingOctree = nullptr;
+		auto teardownEnd = std::chrono::high_resolution_clock::now();
+
+		buildTime += std::chrono::duration<double, std::milli>(buildEnd - buildStart).count();
+		teardownTime += std::chrono::duration<double, std::milli>(teardownEnd - teardownStart).count();
+	}
+	buildTime /= this->repetitionCount;
+	teardownTime /= this->repetitionCount;
+}
+
+void OctreeBenchmark::collectPages(OctreeNode * node, std::unordered_set<uintptr_t> & pages, size_t & bytes)
+{
+	addPages(node->boundingBox, sizeof(AABB), pages);
+	bytes += sizeof(AABB);
+	if (node->isLeafNode)
+	{
+		LeafNode<uint32_t> * leafNode = (LeafNode<uint32_t> *)node;
+		addPages(leafNode, sizeof(LeafNode<uint32_t>), pages);
+		addPages(leafNode->contents.data(), leafNode->contents.size() * sizeof(uint32_t), pages);
+		bytes += sizeof(LeafNode<uint32_t>) + leafNode->contents.size() * sizeof(uint32_t);
+		return;
+	}
+
+	BranchNode * branchNode = (BranchNode *)node;
+	addPages(branchNode, sizeof(BranchNode), pages);
+	bytes += sizeof(BranchNode);
+	for (int i = 0; i < 8; i++)
+	{
+		if (branchNode->children[i])
+		{
+			collectPages(branchNode->children[i], pages, bytes);
+		}
+	}
+}
+
+void OctreeBenchmark::addPages(const void * address, size_t size, std::unordered_set<uintptr_t> & pages)
+{
+	if (size == 0)
+	{
+		return;
+	}
+	uintptr_t first = (uintptr_t)address >> PAGE_SHIFT;
+	uintptr_t last = ((uintptr_t)address + size - 1) >> PAGE_SHIFT;
+	for (uintptr_t page = first; page <= last; page++)
+	{
+		pages.insert(page);
+	}
+}
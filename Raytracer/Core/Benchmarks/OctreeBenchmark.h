@@ -0,0 +1,26 @@
+#pragma once
+
+#include <string>
+#include <unordered_set>
+#include <cstdint>
+
+class Mesh;
+class OctreeNode;
+
+//Benchmark comparing octrees with their nodes allocated one at a time from the heap against octrees allocated from an arena
+//Fragmentation is measured as the number of 4 KB pages the nodes, bounding boxes and leaf contents are spread over
+class OctreeBenchmark
+{
+public:
+	OctreeBenchmark(uint32_t repetitions);
+
+	//Builds and deletes the octree of every mesh in the model both ways and prints the times and the pages used
+	void run(const std::string & path);
+
+private:
+	uint32_t repetitionCount;
+
+	void timeOctree(const Mesh * source, bool useArena, double & buildTime, double & teardownTime, size_t & pageCount, size_t & bytes);
+	void collectPages(OctreeNode * node, std::unordered_set<uintptr_t> & pages, size_t & bytes);
+	void addPages(const void * address, size_t size, std::unordered_set<uintptr_t> & pages);
+};
\ No newline at end of file
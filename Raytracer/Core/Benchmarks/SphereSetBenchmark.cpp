@@ -0,0 +1,116 @@
+#include "SphereSetBenchmark.h"
+
+#include "../Geometry/Sphere.h"
+#include "../Geometry/SphereSet.h"
+#include "../Renderer/Camera.h"
+#include "../Renderer/Renderer.h"
+#include "../Renderer/Lights/DirectionalLight.h"
+#include "../Renderer/Materials/PhongMaterial.h"
+
+#include <glm/geometric.hpp>
+
+#include <chrono>
+#include <random>
+#include <cmath>
+#include <cstdio>
+
+SphereSetBenchmark::SphereSetBenchmark(uint32_t width, uint32_t height) : imageWidth(width), imageHeight(height)
+{
+}
+
+void SphereSetBenchmark::run(const std::vector<uint32_t> & sphereCounts, uint32_t maxObjectCount)
+{
+	printf("Sphere set benchmark: %ux%u image\n", imageWidth, imageHeight);
+	printf("%10s %12s %14s %12s %14s %16s %14s %13s\n", "spheres", "set build", "set memory", "set render", "objects build", "objects memory", "objects render", "pixels differ");
+
+	PhongMaterial material(glm::vec3(1.0f, 0.5f, 0.0f), 1.0f, 0.5f, 20.0f);
+	for (uint32_t count : sphereCounts)
+	{
+		std::vector<glm::vec3> centers;
+		float radius;
+		generateSpheres(count, centers, radius);
+
+		auto buildStart = std::chrono::high_resolution_clock::now();
+		SphereSet * sphereSet = new SphereSet(&material);
+		sphereSet->reserve(count);
+		for (const glm::vec3 & center : centers)
+		{
+			sphereSet->addSphere(center, radius);
+		}
+		sphereSet->build();
+		double setBuildTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - buildStart).count();
+		size_t setBytes = sphereSet->getMemoryUsage();
+
+		std::vector<Object*> objectList = { sphereSet };
+		std::vector<glm::vec3> setImage;
+		double setRenderTime = renderScene(objectList, setImage);
+		delete sphereSet;
+
+		if (count > maxObjectCount)
+		{
+			printf("%10u %9.1f ms %11.1f KB %9.2f s %14s %16s %14s %13s\n", count, setBuildTime, setBytes / 1024.0, setRenderTime / 1000.0, "-", "-", "-", "-");
+			continue;
+		}
+
+		//The scene BVH over the separate spheres is built by the renderer, so its build is part of the render time
+		buildStart = std::chrono::high_resolution_clock::now();
+		objectList.clear();
+		objectList.reserve(count);
+		for (const glm::vec3 & center : centers)
+		{
+			objectList.push_back(new Sphere(center, radius, &material));
+		}
+		double objectBuildTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - buildStart).count();
+		//Only the spheres and the object list are counted, not the nodes of the scene BVH over them
+		size_t objectBytes = count * (sizeof(Sphere) + sizeof(Object*));
+
+		std::vector<glm::vec3> objectImage;
+		double objectRenderTime = renderScene(objectList, objectImage);
+		for (Object * object : objectList)
+		{
+			delete object;
+		}
+
+		//The two sphere tests differ in how they reject hits at the origin of shadow rays, so a few pixels on the edges of shadows can differ
+		uint32_t differentPixels = 0;
+		for (size_t i = 0; i < setImage.size(); i++)
+		{
+			glm::vec3 difference = glm::abs(setImage[i] - objectImage[i]);
+			differentPixels += std::fmax(difference.x, std::fmax(difference.y, difference.z)) > 1.0f / 255.0f;
+		}
+		printf("%10u %9.1f ms %11.1f KB %9.2f s %11.1f ms %13.1f KB %12.2f s %12.3f%%\n", count, setBuildTime, setBytes / 1024.0, setRenderTime / 1000.0, objectBuildTime, objectBytes / 1024.0, objectRenderTime / 1000.0, 100.0 * differentPixels / setImage.size());
+	}
+}
+
+void SphereSetBenchmark::generateSpheres(uint32_t count, std::vector<glm::vec3> & centers, float & radius)
+{
+	//Spheres are scattered through a box in front of the camera of the main scene, their radius shrinks with the spacing so the cloud covers a similar part of the image at every count
+	const glm::vec3 boxMin(-4.0f, 0.0f, -12.0f);
+	const glm::vec3 boxMax(4.0f, 5.0f, -4.0f);
+	glm::vec3 boxSize = boxMax - boxMin;
+	float spacing = std::cbrt(boxSize.x * boxSize.y * boxSize.z / count);
+	radius = 0.3f * spacing;
+
+	std::mt19937 generator(1234);
+	std::uniform_real_distribution<float> distribution(0.0f, 1.0f);
+	centers.resize(count);
+	for (uint32_t i = 0; i < count; i++)
+	{
+		centers[i] = boxMin + boxSize * glm::vec3(distribution(generator), distribution(generator), distribution(generator));
+	}
+}
+
+double SphereSetBenchmark::renderScene(std::vector<Object*> & objectList, std::vector<glm::vec3> & image)
+{
+	Camera camera(glm::vec3(0.0f, 2.5f, 2.0f), 0, 0, 45, (float)imageWidth / (float)imageHeight);
+	DirectionalLight light(glm::vec3(1, -1, -1), glm::vec3(1, 1, 1), 2.0f);
+	std::vector<Light*> lightList = { &light };
+
+	//A renderer of its own for every scene, since the renderer builds its scene BVH from the first object list it is given
+	Renderer renderer(imageWidth, imageHeight);
+	auto renderStart = std::chrono::high_resolution_clock::now();
+	renderer.render(camera, objectList, lightList);
+	double renderTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - renderStart).count();
+	image = renderer.getFramebuffer();
+	return renderTime;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include <glm/vec3.hpp>
+
+class Object;
+
+//Benchmark rendering a cloud of spheres as one SphereSet and as separate Sphere objects in the scene BVH
+//Both are rendered by the renderer from the camera of the main scene, so the times include shading and shadow rays
+//Separate spheres are only rendered up to a count since each of them is an object of its own in the BVH
+class SphereSetBenchmark
+{
+public:
+	SphereSetBenchmark(uint32_t width, uint32_t height);
+
+	//Renders a cloud of each of the sphere counts and prints the build time, memory and render time of each
+	void run(const std::vector<uint32_t> & sphereCounts, uint32_t maxObjectCount);
+
+private:
+	uint32_t imageWidth;
+	uint32_t imageHeight;
+
+	void generateSpheres(uint32_t count, std::vector<glm::vec3> & centers, float & radius);
+	double renderScene(std::vector<Object*> & objectList, std::vector<glm::vec3> & image);
+};
\ No newline at end of file
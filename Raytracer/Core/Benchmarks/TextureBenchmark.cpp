@@ -0,0 +1,177 @@
+#include "TextureBenchmark.h"
+
+#include "../Renderer/Images/ImageLoader.h"
+
+#include <iostream>
+#include <chrono>
+#include <random>
+#include <cmath>
+
+constexpr float CONVERSION_FACTOR_255 = 0.00392157f;
+
+TextureBenchmark::TextureBenchmark(ImageLoader & loader, uint32_t samples) : imageLoader(loader), sampleCount(samples)
+{
+}
+
+void TextureBenchmark::run(int32_t textureID)
+{
+	const Texture2D & texture = imageLoader.getTexture(textureID);
+	if (texture.format != TextureFormat::RGBA8 || texture.cacheID >= 0)
+	{
+		std::cout << "WARNING: Texture benchmark needs an uncompressed texture held in memory, skipping " << imageLoader.getTexturePath(textureID) << std::endl;
+		return;
+	}
+	const TextureLevel & level = texture.levels[0];
+
+	ImageLoader compressedLoader;
+	compressedLoader.setCompressTextures(true);
+	int32_t compressedID = compressedLoader.loadTexture(imageLoader.getTexturePath(textureID).c_str());
+	//Textures are decoded when first sampled, so the compressed texture is decoded here to keep the decode out of the memory report and the timings
+	compressedLoader.getTexture(compressedID);
+
+	//Build a row major copy of the full resolution level to compare against
+	rowMajorTextures.clear();
+	rowMajorTextures.resize(1);
+	RowMajorTexture & rowMajor = rowMajorTextures[0];
+	rowMajor.width = level.width;
+	rowMajor.height = level.height;
+	rowMajor.path = "Resources/Textures/benchmark_texture.png";
+	rowMajorImage.resize(level.width * level.height * 4);
+	rowMajor.image = rowMajorImage.data();
+	for (int y = 0; y < level.height; y++)
+	{
+		for (int x = 0; x < level.width; x++)
+		{
+			const unsigned char * texel = level.getTexel(x, y);
+			std::copy(texel, texel + 4, &rowMajor.image[(x + level.width * y) * 4]);
+		}
+	}
+
+	printf("Texture benchmark: %dx%d texture, %u bilinear samples per walk\n", level.width, level.height, sampleCount);
+	printf("Memory: tiled RGBA8 %.1f KB, BC1 %.1f KB\n", imageLoader.getTextureMemoryUsage(textureID) / 1024.0, compressedLoader.getTextureMemoryUsage(compressedID) / 1024.0);
+	printf("%-12s %18s %18s %18s %18s %10s\n", "walk", "copy+row major", "row major", "tiled", "tiled BC1", "speedup");
+
+	Walk walks[] = { Walk::HORIZONTAL, Walk::VERTICAL, Walk::DIAGONAL, Walk::RANDOM };
+	for (Walk walk : walks)
+	{
+		std::vector<float> coordinates;
+		generateWalk(walk, level.width, level.height, coordinates);
+
+		//The checksum is printed so the lookups can not be optimized away
+		glm::vec3 checksum(0.0f);
+		double copyTime = timeRowMajor(coordinates, true, checksum);
+		double rowMajorTime = timeRowMajor(coordinates, false, checksum);
+		double tiledTime = timeTiled(imageLoader, textureID, coordinates, checksum);
+		double compressedTime = timeTiled(compressedLoader, compressedID, coordinates, checksum);
+
+		printf("%-12s %15.2f ns %15.2f ns %15.2f ns %15.2f ns %9.2fx (checksum %.0f)\n", getWalkName(walk), copyTime, rowMajorTime, tiledTime, compressedTime, copyTime / tiledTime, checksum.x + checksum.y + checksum.z);
+	}
+}
+
+void TextureBenchmark::generateWalk(Walk walk, int width, int height, std::vector<float> & coordinates)
+{
+	coordinates.resize(sampleCount * 2);
+	std::mt19937 generator(1234);
+	std::uniform_real_distribution<float> distribution(0.0f, 1.0f);
+
+	//Each walk moves about one texel per sample in its direction and wraps around the texture
+	for (uint32_t i = 0; i < sampleCount; i++)
+	{
+		float u, v;
+		switch (walk)
+		{
+			case Walk::HORIZONTAL:
+				u = (i % width + 0.5f) / width;
+				v = ((i / width) % height + 0.5f) / height;
+				break;
+			case Walk::VERTICAL:
+				u = ((i / height) % width + 0.5f) / width;
+				v = (i % height + 0.5f) / height;
+				break;
+			case Walk::DIAGONAL:
+				u = (i % width + 0.5f) / width;
+				v = ((i + i / width * 7) % height + 0.5f) / height;
+				break;
+			default:
+				u = distribution(generator);
+				v = distribution(generator);
+				break;
+		}
+		coordinates[i * 2] = u;
+		coordinates[i * 2 + 1] = v;
+	}
+}
+
+double TextureBenchmark::timeTiled(ImageLoader & loader, int32_t textureID, const std::vector<float> & coordinates, glm::vec3 & checksum)
+{
+	auto startTime = std::chrono::high_resolution_clock::now();
+	for (uint32_t i = 0; i < sampleCount; i++)
+	{
+		checksum += loader.getColorAtTextureUV(textureID, coordinates[i * 2], coordinates[i * 2 + 1]);
+	}
+	auto endTime = std::chrono::high_resolution_clock::now();
+	return std::chrono::duration<double, std::nano>(endTime - startTime).count() / sampleCount;
+}
+
+double TextureBenchmark::timeRowMajor(const std::vector<float> & coordinates, bool copyTexture, glm::vec3 & checksum)
+{
+	auto startTime = std::chrono::high_resolution_clock::now();
+	for (uint32_t i = 0; i < sampleCount; i++)
+	{
+		if (copyTexture)
+		{
+			//Copy the texture out of the table the way every lookup used to
+			RowMajorTexture texture = rowMajorTextures[0];
+			checksum += sampleRowMajor(texture, coordinates[i * 2], coordinates[i * 2 + 1]);
+		}
+		else
+		{
+			checksum += sampleRowMajor(rowMajorTextures[0], coordinates[i * 2], coordinates[i * 2 + 1]);
+		}
+	}
+	auto endTime = std::chrono::high_resolution_clock::now();
+	return std::chrono::duration<double, std::nano>(endTime - startTime).count() / sampleCount;
+}
+
+glm::vec3 TextureBenchmark::sampleRowMajor(const RowMajorTexture & texture, float u, float v)
+{
+	//Same filtering as ImageLoader so only the memory layout differs
+	float x = u * texture.width - 0.5f;
+	float y = v * texture.height - 0.5f;
+	float floorX = floorf(x);
+	float floorY = floorf(y);
+	float fractionX = x - floorX;
+	float fractionY = y - floorY;
+
+	int x0 = (int)floorX % texture.width;
+	int y0 = (int)floorY % texture.height;
+	x0 = x0 < 0 ? x0 + texture.width : x0;
+	y0 = y0 < 0 ? y0 + texture.height : y0;
+	int x1 = x0 + 1 == texture.width ? 0 : x0 + 1;
+	int y1 = y0 + 1 == texture.height ? 0 : y0 + 1;
+
+	const unsigned char * texel00 = &texture.image[(x0 + texture.width * y0) * 4];
+	const unsigned char * texel10 = &texture.image[(x1 + texture.width * y0) * 4];
+	const unsigned char * texel01 = &texture.image[(x0 + texture.width * y1) * 4];
+	const unsigned char * texel11 = &texture.image[(x1 + texture.width * y1) * 4];
+
+	glm::vec3 color00 = glm::vec3(texel00[0], texel00[1], texel00[2]);
+	glm::vec3 color10 = glm::vec3(texel10[0], texel10[1], texel10[2]);
+	glm::vec3 color01 = glm::vec3(texel01[0], texel01[1], texel01[2]);
+	glm::vec3 color11 = glm::vec3(texel11[0], texel11[1], texel11[2]);
+
+	glm::vec3 top = color00 + (color10 - color00) * fractionX;
+	glm::vec3 bottom = color01 + (color11 - color01) * fractionX;
+	return (top + (bottom - top) * fractionY) * CONVERSION_FACTOR_255;
+}
+
+const char * TextureBenchmark::getWalkName(Walk walk)
+{
+	switch (walk)
+	{
+		case Walk::HORIZONTAL: return "horizontal";
+		case Walk::VERTICAL: return "vertical";
+		case Walk::DIAGONAL: return "diagonal";
+		default: return "random";
+	}
+}
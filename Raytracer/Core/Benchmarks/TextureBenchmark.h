@@ -0,0 +1,44 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <glm/vec3.hpp>
+
+class ImageLoader;
+struct TextureLevel;
+
+//Microbenchmark comparing texture lookups in the tiled texture layout against the row major layout textures used to be stored in
+//and against the same tiled texture block compressed
+class TextureBenchmark
+{
+public:
+	enum class Walk { HORIZONTAL, VERTICAL, DIAGONAL, RANDOM };
+
+	TextureBenchmark(ImageLoader & loader, uint32_t samples);
+
+	//Times every walk pattern over the full resolution level of the texture and prints the time per sample for each layout
+	//The texture must be loaded uncompressed and outside the texture cache, a block compressed copy is loaded from the same path to compare against
+	void run(int32_t textureID);
+
+private:
+	//Copy of a texture in the row major layout, including the path that was copied along with it on every lookup
+	struct RowMajorTexture
+	{
+		unsigned char * image;
+		int width;
+		int height;
+		std::string path;
+	};
+
+	ImageLoader & imageLoader;
+	uint32_t sampleCount;
+	std::vector<RowMajorTexture> rowMajorTextures;
+	std::vector<unsigned char> rowMajorImage;
+
+	void generateWalk(Walk walk, int width, int height, std::vector<float> & coordinates);
+	double timeTiled(ImageLoader & loader, int32_t textureID, const std::vector<float> & coordinates, glm::vec3 & checksum);
+	double timeRowMajor(const std::vector<float> & coordinates, bool copyTexture, glm::vec3 & checksum);
+	glm::vec3 sampleRowMajor(const RowMajorTexture & texture, float u, float v);
+	const char * getWalkName(Walk walk);
+};
\ No newline at end of file
@@ -2,15 +2,19 @@
 
 #include <vector>
 #include <list>
+#include <atomic>
+#include <mutex>
+#include <algorithm>
 
 #include "../Geometry/AABB.h"
 #include "../Renderer/Ray.h"
 #include "../Math/MathFunctions.h"
+#include "../Memory/Arena.h"
 
 class OctreeNode
 {
 public:
-	OctreeNode(bool leaf, AABB * aaBB) : isLeafNode(leaf), boundingBox(aaBB) {}
+	OctreeNode(bool leaf, AABB * aaBB) : isLeafNode(leaf), parent(nullptr), boundingBox(aaBB) {}
 	~OctreeNode()
 	{
 		if (boundingBox)
@@ -27,16 +31,24 @@ public:
 class BranchNode : public OctreeNode
 {
 public:
-	BranchNode(AABB * aaBB) : OctreeNode(false, aaBB) {}
+	//Children that are never created stay nullptr so they are skipped when traversing and deleting the tree
+	BranchNode(AABB * aaBB) : OctreeNode(false, aaBB), children(), childrenPending(false), depth(0), pendingContents(nullptr), pendingCount(0) {}
 	OctreeNode * children[8];
+
+	//Set on branches of a lazily built octree until their children are built, along with the depth and contents to build them from
+	std::atomic<bool> childrenPending;
+	uint32_t depth;
+	const void * pendingContents;
+	uint32_t pendingCount;
 };
 
 template <typename T>
 class LeafNode: public OctreeNode
 {
 public:
-	LeafNode(AABB * aaBB) : OctreeNode(true, aaBB) {}
-	std::vector<T> contents;
+	//The contents are allocated from the arena of the octree the leaf belongs to, or from the heap if the octree has no arena
+	LeafNode(AABB * aaBB, Arena * arena = nullptr) : OctreeNode(true, aaBB), contents(ArenaAllocator<T>(arena)) {}
+	std::vector<T, ArenaAllocator<T>> contents;
 };
 
 struct NodeDistancePair
@@ -51,12 +63,20 @@ struct NodeDistancePair
 };
 
 
+//Octrees allocate their nodes, bounding boxes and leaf contents from an arena of their own unless told to use the heap
+//The nodes of an octree are then packed together in memory and deleting the octree frees a few blocks instead of every node
 template <typename T>
 class Octree
 {
 private:
 	uint32_t minObjects;
 	uint32_t maxDepth;
+	Arena * arena;
+	//Guards the arena while branches are built lazily from several threads
+	std::mutex buildMutex;
+	//Contents of pending branches are held on the heap and freed once the children are built, they are charged to the asset the octree was made for
+	uint32_t asset;
+	size_t pendingBytes;
 
 	void deleteChildren(OctreeNode * node)
 	{
@@ -67,6 +87,7 @@ private:
 		}
 
 		BranchNode * branchNode = (BranchNode *)node;
+		releasePendingContents(branchNode);
 		for (int i = 0; i < 8; i++)
 		{
 			if (branchNode->children[i])
@@ -77,17 +98,157 @@ private:
 		delete node;
 	}
 
+	size_t getNodeMemoryUsage(OctreeNode * node)
+	{
+		if (node->isLeafNode)
+		{
+			return sizeof(LeafNode<T>) + sizeof(AABB) + ((LeafNode<T> *)node)->contents.capacity() * sizeof(T);
+		}
+
+		size_t bytes = sizeof(BranchNode) + sizeof(AABB);
+		BranchNode * branchNode = (BranchNode *)node;
+		for (int i = 0; i < 8; i++)
+		{
+			if (branchNode->children[i])
+			{
+				bytes += getNodeMemoryUsage(branchNode->children[i]);
+			}
+		}
+		return bytes;
+	}
+
+	void releasePendingContents(BranchNode * branchNode)
+	{
+		if (branchNode->pendingContents)
+		{
+			delete[] (const T *)branchNode->pendingContents;
+			this->pendingBytes -= branchNode->pendingCount * sizeof(T);
+			MemoryTracker::released(MemoryCategory::Octrees, this->asset, branchNode->pendingCount * sizeof(T));
+			branchNode->pendingContents = nullptr;
+			branchNode->pendingCount = 0;
+		}
+	}
+
+	//Frees the contents of the branches that were never built, only needed when the nodes themselves are freed with the arena
+	void releaseAllPendingContents(OctreeNode * node)
+	{
+		if (node->isLeafNode)
+		{
+			return;
+		}
+		BranchNode * branchNode = (BranchNode *)node;
+		releasePendingContents(branchNode);
+		for (int i = 0; i < 8; i++)
+		{
+			if (branchNode->children[i])
+			{
+				releaseAllPendingContents(branchNode->children[i]);
+			}
+		}
+	}
+
 public:
-	Octree(uint32_t mObjects, uint32_t mDepth) : minObjects(mObjects), maxDepth(mDepth) {}
+	Octree(uint32_t mObjects, uint32_t mDepth, bool useArena = true) : minObjects(mObjects), maxDepth(mDepth), arena(useArena ? new Arena(MemoryCategory::Octrees) : nullptr), asset(MemoryTracker::getCurrentAsset()), pendingBytes(0), root(nullptr) {}
 
 	~Octree()
 	{
-		if (root)
+		//Nodes in the arena own nothing outside of it so they are freed along with it without visiting them
+		if (arena)
+		{
+			if (root && pendingBytes > 0)
+			{
+				releaseAllPendingContents(root);
+			}
+			delete arena;
+		}
+		else if (root)
 		{
 			deleteChildren(root);
 		}
 	}
 
+	BranchNode * createBranch(const glm::vec3 & center, const glm::vec3 & halfDistances)
+	{
+		if (arena)
+		{
+			return arena->create<BranchNode>(arena->create<AABB>(center, halfDistances));
+		}
+		return new BranchNode(new AABB(center, halfDistances));
+	}
+
+	LeafNode<T> * createLeaf(const glm::vec3 & center, const glm::vec3 & halfDistances, const T * contents, size_t contentCount)
+	{
+		LeafNode<T> * leafNode;
+		if (arena)
+		{
+			leafNode = arena->create<LeafNode<T>>(arena->create<AABB>(center, halfDistances), arena);
+		}
+		else
+		{
+			leafNode = new LeafNode<T>(new AABB(center, halfDistances));
+		}
+		leafNode->contents.assign(contents, contents + contentCount);
+		return leafNode;
+	}
+
+	//Branch whose children are only built when buildPendingChildren is called on it, the contents are copied to the heap until then
+	BranchNode * createPendingBranch(const glm::vec3 & center, const glm::vec3 & halfDistances, uint32_t depth, const T * contents, size_t contentCount)
+	{
+		BranchNode * branchNode = createBranch(center, halfDistances);
+		T * pendingContents = new T[contentCount];
+		std::copy(contents, contents + contentCount, pendingContents);
+		this->pendingBytes += contentCount * sizeof(T);
+		MemoryTracker::allocated(MemoryCategory::Octrees, this->asset, contentCount * sizeof(T));
+		branchNode->depth = depth;
+		branchNode->pendingContents = pendingContents;
+		branchNode->pendingCount = contentCount;
+		branchNode->childrenPending.store(true, std::memory_order_release);
+		return branchNode;
+	}
+
+	//Builds the children of a pending branch once no matter how many threads reach it at the same time
+	//The build function is called with the branch, its contents and the depth of its children while the octree is locked
+	template <typename BuildFunction>
+	void buildPendingChildren(BranchNode * branchNode, BuildFunction buildChildren)
+	{
+		//Branches that are already built only cost an atomic load
+		if (!branchNode->childrenPending.load(std::memory_order_acquire))
+		{
+			return;
+		}
+		std::lock_guard<std::mutex> lock(buildMutex);
+		if (branchNode->childrenPending.load(std::memory_order_relaxed))
+		{
+			buildChildren(branchNode, (const T *)branchNode->pendingContents, branchNode->pendingCount, branchNode->depth);
+			branchNode->childrenPending.store(false, std::memory_order_release);
+			releasePendingContents(branchNode);
+		}
+	}
+
+	//Builds every pending branch so the whole tree exists
+	template <typename BuildFunction>
+	void buildAllPendingChildren(OctreeNode * node, BuildFunction buildChildren)
+	{
+		if (node->isLeafNode)
+		{
+			return;
+		}
+		BranchNode * branchNode = (BranchNode *)node;
+		buildPendingChildren(branchNode, buildChildren);
+		for (int i = 0; i < 8; i++)
+		{
+			if (branchNode->children[i])
+			{
+				buildAllPendingChildren(branchNode->children[i], buildChildren);
+			}
+		}
+	}
+
+	bool usesArena()
+	{
+		return arena != nullptr;
+	}
+
 	OctreeNode * root;
 
 	uint32_t getMinObjects()
@@ -100,13 +261,26 @@ public:
 		return maxDepth;
 	}
 
-	void expandWithRayIntersection(const Ray & ray, std::list<OctreeNode*> & intersectionsList)
+	//Bytes used by the nodes, their bounding boxes, the leaf contents and the contents of pending branches, for an arena this is all of the memory it holds
+	size_t getMemoryUsage()
+	{
+		if (arena)
+		{
+			return arena->getReservedBytes() + this->pendingBytes;
+		}
+		return (root ? getNodeMemoryUsage(root) : 0) + this->pendingBytes;
+	}
+
+	//Pending branches the ray reaches have their children built with the build function first, see buildPendingChildren
+	template <typename BuildFunction>
+	void expandWithRayIntersection(const Ray & ray, std::list<OctreeNode*> & intersectionsList, BuildFunction buildChildren)
 	{
 		//Continues to work through the list until the front node is a leaf node
 		while (!intersectionsList.front()->isLeafNode)
 		{
 			BranchNode * branchNode = (BranchNode *)intersectionsList.front();
 			intersectionsList.pop_front();
+			buildPendingChildren(branchNode, buildChildren);
 
 			std::list<NodeDistancePair> newNodes;
 			for (uint32_t i = 0; i < 8; i++)
@@ -118,6 +292,11 @@ public:
 					float rayParameter = MathFunctions::T_INFINITY;
 					if (node->boundingBox->intersect(ray, rayParameter))
 					{
+						//A box the ray starts in gives the parameter the ray leaves it at, it is entered at the start of the ray
+						if (AABB::containsPoint(node->boundingBox->getMinAsPoint(), node->boundingBox->getMaxAsPoint(), ray.getOrigin()))
+						{
+							rayParameter = 0.0f;
+						}
 						NodeDistancePair pair;
 						pair.n = node;
 						pair.rayParameter = rayParameter;
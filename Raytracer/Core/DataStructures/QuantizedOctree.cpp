@@ -0,0 +1,126 @@
+#include "QuantizedOctree.h"
+
+#include "Octree.h"
+
+#include <cmath>
+
+QuantizedOctree::QuantizedOctree(OctreeNode * root) : valid(true), rootIsLeaf(root->isLeafNode), rootMin(root->boundingBox->getMinAsPoint()), rootMax(root->boundingBox->getMaxAsPoint()), boundingBox(*root->boundingBox)
+{
+	if (this->rootIsLeaf)
+	{
+		addLeaf(root);
+		return;
+	}
+
+	this->nodes.resize(1);
+	buildNode((BranchNode *)root, 0, 1);
+	if (!this->valid)
+	{
+		HugePageVector<QuantizedNode, MemoryCategory::Octrees>().swap(this->nodes);
+		HugePageVector<Leaf, MemoryCategory::Octrees>().swap(this->leaves);
+		HugePageVector<uint32_t, MemoryCategory::Octrees>().swap(this->leafContents);
+	}
+}
+
+bool QuantizedOctree::isValid() const
+{
+	return this->valid;
+}
+
+AABB * QuantizedOctree::getBoundingBox()
+{
+	return &this->boundingBox;
+}
+
+size_t QuantizedOctree::getMemoryUsage() const
+{
+	return sizeof(QuantizedOctree) + this->nodes.capacity() * sizeof(QuantizedNode) + this->leaves.capacity() * sizeof(Leaf) + this->leafContents.capacity() * sizeof(uint32_t);
+}
+
+void QuantizedOctree::buildNode(BranchNode * branch, uint32_t nodeIndex, uint32_t depth)
+{
+	if (depth > QUANTIZED_OCTREE_MAX_DEPTH)
+	{
+		this->valid = false;
+		return;
+	}
+
+	glm::vec3 branchMin = branch->boundingBox->getMinAsPoint();
+	glm::vec3 branchMax = branch->boundingBox->getMaxAsPoint();
+
+	QuantizedNode node = {};
+	for (int axis = 0; axis < 3; axis++)
+	{
+		node.origin[axis] = branchMin[axis];
+		//The cell size is rounded up so the last grid line is never inside the branch
+		node.cellSize[axis] = std::nextafter((branchMax[axis] - branchMin[axis]) / 255.0f, MathFunctions::T_INFINITY);
+	}
+
+	//Slots for the children are reserved before recursing so the children of this branch end up next to each other
+	std::vector<std::pair<BranchNode *, uint32_t>> branchChildren;
+	node.firstBranch = this->nodes.size();
+	for (int child = 0; child < 8; child++)
+	{
+		OctreeNode * childNode = branch->children[child];
+		if (childNode && !childNode->isLeafNode)
+		{
+			branchChildren.push_back(std::make_pair((BranchNode *)childNode, (uint32_t)this->nodes.size()));
+			this->nodes.push_back(QuantizedNode());
+		}
+	}
+	node.firstLeaf = this->leaves.size();
+
+	for (int child = 0; child < 8; child++)
+	{
+		OctreeNode * childNode = branch->children[child];
+		if (!childNode)
+		{
+			continue;
+		}
+
+		node.childMask |= 1 << child;
+		if (childNode->isLeafNode)
+		{
+			node.leafMask |= 1 << child;
+			addLeaf(childNode);
+		}
+
+		//The child bounds are rounded outwards, then widened a step at a time in case float rounding left the decoded bound inside the real one
+		glm::vec3 childMin = childNode->boundingBox->getMinAsPoint();
+		glm::vec3 childMax = childNode->boundingBox->getMaxAsPoint();
+		for (int axis = 0; axis < 3; axis++)
+		{
+			float origin = node.origin[axis];
+			float cellSize = node.cellSize[axis];
+			int lower = std::max(0, std::min(255, (int)std::floor((childMin[axis] - origin) / cellSize)));
+			int upper = std::max(0, std::min(255, (int)std::ceil((childMax[axis] - origin) / cellSize)));
+			while (lower > 0 && origin + lower * cellSize > childMin[axis])
+			{
+				lower--;
+			}
+			while (upper < 255 && origin + upper * cellSize < childMax[axis])
+			{
+				upper++;
+			}
+			node.lower[axis][child] = lower;
+			node.upper[axis][child] = upper;
+		}
+	}
+	this->nodes[nodeIndex] = node;
+
+	for (const std::pair<BranchNode *, uint32_t> & branchChild : branchChildren)
+	{
+		buildNode(branchChild.first, branchChild.second, depth + 1);
+	}
+}
+
+uint32_t QuantizedOctree::addLeaf(OctreeNode * node)
+{
+	const std::vector<uint32_t, ArenaAllocator<uint32_t>> & contents = ((LeafNode<uint32_t> *)node)->contents;
+	Leaf leaf;
+	leaf.first = this->leafContents.size();
+	leaf.count = contents.size();
+	this->leafContents.insert(this->leafContents.end(), contents.begin(), contents.end());
+	this->leaves.push_back(leaf);
+	return this->leaves.size() - 1;
+}
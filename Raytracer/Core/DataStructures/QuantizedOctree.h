@@ -0,0 +1,160 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+#include <glm/vec3.hpp>
+
+#include "../Geometry/AABB.h"
+#include "../Renderer/Ray.h"
+#include "../Math/MathFunctions.h"
+#include "../Memory/HugePages.h"
+
+class OctreeNode;
+class BranchNode;
+
+//Deepest octree that can be quantized, this bounds the traversal stack so it can live on the stack of the caller
+constexpr uint32_t QUANTIZED_OCTREE_MAX_DEPTH = 8;
+constexpr uint32_t QUANTIZED_OCTREE_STACK_SIZE = QUANTIZED_OCTREE_MAX_DEPTH * 7 + 8;
+
+//Compressed copy of an octree of face indices, stored in flat arrays instead of heap allocated nodes
+//Each branch stores the bounds of all 8 of its children as 8 bit offsets on a 255 step grid spanning the branch, rounded outwards so the decoded bounds always contain the real ones
+//Child bounds are decoded on the fly during traversal, which visits the leaves in the same near to far order as Octree::expandWithRayIntersection
+class QuantizedOctree
+{
+public:
+	//Builds the quantized copy of the octree under the root, check isValid before using it since trees deeper than QUANTIZED_OCTREE_MAX_DEPTH are rejected
+	QuantizedOctree(OctreeNode * root);
+
+	bool isValid() const;
+	AABB * getBoundingBox();
+	size_t getMemoryUsage() const;
+
+	//Calls the leaf function with the face indices of the leaves the ray passes through, nearest leaf first
+	//The leaf function lowers the parameter when it finds a nearer hit, leaves that start past the parameter are skipped
+	//Unlike Octree::expandWithRayIntersection this does not stop at the first leaf with a hit, since a face in that leaf can be hit outside of it
+	template <typename LeafFunction>
+	bool traverse(const Ray & ray, float & parameter, LeafFunction visitLeaf) const
+	{
+		if (!this->valid)
+		{
+			return false;
+		}
+
+		float rootParameter = MathFunctions::T_INFINITY;
+		if (!AABB::intersectBounds(this->rootMin, this->rootMax, ray, rootParameter))
+		{
+			return false;
+		}
+
+		//Entries are node indices with the top bit set for leaves along with the distance the ray enters the node, the next node to visit is at the back
+		uint32_t stack[QUANTIZED_OCTREE_STACK_SIZE];
+		float stackParameters[QUANTIZED_OCTREE_STACK_SIZE];
+		uint32_t stackSize = 0;
+		stack[stackSize] = this->rootIsLeaf ? LEAF_BIT : 0;
+		stackParameters[stackSize++] = getEntryParameter(this->rootMin, this->rootMax, ray, rootParameter);
+
+		bool hit = false;
+		while (stackSize > 0)
+		{
+			stackSize--;
+			uint32_t entry = stack[stackSize];
+			if (stackParameters[stackSize] > parameter)
+			{
+				continue;
+			}
+
+			if (entry & LEAF_BIT)
+			{
+				const Leaf & leaf = this->leaves[entry & ~LEAF_BIT];
+				hit = visitLeaf(this->leafContents.data() + leaf.first, leaf.count) || hit;
+				continue;
+			}
+
+			const QuantizedNode & node = this->nodes[entry];
+			uint32_t hitEntries[8];
+			float hitParameters[8];
+			uint32_t hitCount = 0;
+			uint32_t branchIndex = node.firstBranch;
+			uint32_t leafIndex = node.firstLeaf;
+			for (uint32_t child = 0; child < 8; child++)
+			{
+				if (!(node.childMask & (1 << child)))
+				{
+					continue;
+				}
+				bool isLeaf = (node.leafMask & (1 << child)) != 0;
+				uint32_t childEntry = isLeaf ? (leafIndex++ | LEAF_BIT) : branchIndex++;
+
+				glm::vec3 min(node.origin[0] + node.lower[0][child] * node.cellSize[0], node.origin[1] + node.lower[1][child] * node.cellSize[1], node.origin[2] + node.lower[2][child] * node.cellSize[2]);
+				glm::vec3 max(node.origin[0] + node.upper[0][child] * node.cellSize[0], node.origin[1] + node.upper[1][child] * node.cellSize[1], node.origin[2] + node.upper[2][child] * node.cellSize[2]);
+				float rayParameter = MathFunctions::T_INFINITY;
+				if (AABB::intersectBounds(min, max, ray, rayParameter))
+				{
+					rayParameter = getEntryParameter(min, max, ray, rayParameter);
+					//Insertion sort keeps children with equal parameters in child order, like the stable sort of the pointer octree
+					uint32_t position = hitCount++;
+					while (position > 0 && hitParameters[position - 1] > rayParameter)
+					{
+						hitParameters[position] = hitParameters[position - 1];
+						hitEntries[position] = hitEntries[position - 1];
+						position--;
+					}
+					hitParameters[position] = rayParameter;
+					hitEntries[position] = childEntry;
+				}
+			}
+
+			//The farthest child is pushed first so the nearest one is visited next
+			while (hitCount > 0)
+			{
+				hitCount--;
+				stack[stackSize] = hitEntries[hitCount];
+				stackParameters[stackSize++] = hitParameters[hitCount];
+			}
+		}
+		return hit;
+	}
+
+private:
+	static const uint32_t LEAF_BIT = 0x80000000u;
+
+	struct QuantizedNode
+	{
+		//The grid the child bounds are stored on starts at the minimum corner of the branch and has 255 cells along each axis
+		float origin[3];
+		float cellSize[3];
+		//Branch children and leaf children are each stored next to each other, in child order
+		uint32_t firstBranch;
+		uint32_t firstLeaf;
+		uint8_t childMask;
+		uint8_t leafMask;
+		uint8_t lower[3][8];
+		uint8_t upper[3][8];
+	};
+
+	struct Leaf
+	{
+		uint32_t first;
+		uint32_t count;
+	};
+
+	bool valid;
+	bool rootIsLeaf;
+	glm::vec3 rootMin;
+	glm::vec3 rootMax;
+	AABB boundingBox;
+	HugePageVector<QuantizedNode, MemoryCategory::Octrees> nodes;
+	HugePageVector<Leaf, MemoryCategory::Octrees> leaves;
+	HugePageVector<uint32_t, MemoryCategory::Octrees> leafContents;
+
+	//AABB::intersectBounds gives the exit distance for rays that start inside the box, those enter it at 0
+	static float getEntryParameter(const glm::vec3 & min, const glm::vec3 & max, const Ray & ray, float rayParameter)
+	{
+		return AABB::containsPoint(min, max, ray.getOrigin()) ? 0.0f : rayParameter;
+	}
+
+	void buildNode(BranchNode * branch, uint32_t nodeIndex, uint32_t depth);
+	uint32_t addLeaf(OctreeNode * node);
+};
\ No newline at end of file
@@ -0,0 +1,228 @@
+#include "SceneBVH.h"
+
+#include "../Objects/Object.h"
+
+#include <algorithm>
+
+#include <glm/common.hpp>
+
+const uint32_t SceneBVH::MAX_LEAF_OBJECTS = 2;
+const float SceneBVH::REBUILD_COST_RATIO = 1.5f;
+
+static bool getObjectBounds(Object * object, glm::vec3 & minPoint, glm::vec3 & maxPoint)
+{
+	return object->getBounds(minPoint, maxPoint);
+}
+
+SceneBVH::SceneBVH() : builtCost(0.0f), refitCount(0), buildCount(0)
+{
+}
+
+void SceneBVH::build(const std::vector<Object*> & objectList)
+{
+	build(objectList, getObjectBounds);
+}
+
+void SceneBVH::build(const std::vector<Object*> & objectList, const BoundsFunction & getBounds)
+{
+	this->nodes.clear();
+	this->objects.clear();
+	this->unboundedObjects.clear();
+	this->sourceObjects = objectList;
+	this->buildCount++;
+
+	std::vector<BuildEntry> entries;
+	entries.reserve(objectList.size());
+	for (Object * object : objectList)
+	{
+		BuildEntry entry;
+		entry.object = object;
+		if (getBounds(object, entry.minPoint, entry.maxPoint))
+		{
+			entry.centroid = (entry.minPoint + entry.maxPoint) * 0.5f;
+			entries.push_back(entry);
+		}
+		else
+		{
+			this->unboundedObjects.push_back(object);
+		}
+	}
+
+	if (!entries.empty())
+	{
+		this->nodes.reserve(entries.size() * 2);
+		this->objects.reserve(entries.size());
+		buildNode(entries, 0, entries.size(), 0);
+	}
+	this->builtCost = getCost();
+}
+
+uint32_t SceneBVH::buildNode(std::vector<BuildEntry> & entries, uint32_t begin, uint32_t end, uint32_t depth)
+{
+	uint32_t nodeIndex = this->nodes.size();
+	this->nodes.emplace_back();
+	Node node;
+	node.minPoint = entries[begin].minPoint;
+	node.maxPoint = entries[begin].maxPoint;
+	for (uint32_t i = begin + 1; i < end; i++)
+	{
+		node.minPoint = glm::min(node.minPoint, entries[i].minPoint);
+		node.maxPoint = glm::max(node.maxPoint, entries[i].maxPoint);
+	}
+
+	//Find the split with the lowest surface area cost by sweeping the objects sorted by their centroids along each axis
+	uint32_t count = end - begin;
+	float bestCost = (float)count;
+	int32_t bestAxis = -1;
+	uint32_t bestSplit = 0;
+	if (count > MAX_LEAF_OBJECTS && depth < SCENE_BVH_MAX_DEPTH)
+	{
+		float nodeArea = std::max(getSurfaceArea(node.minPoint, node.maxPoint), MathFunctions::EPSILON);
+		std::vector<float> rightAreas(count);
+		for (int32_t axis = 0; axis < 3; axis++)
+		{
+			std::sort(entries.begin() + begin, entries.begin() + end, [axis](const BuildEntry & a, const BuildEntry & b) { return a.centroid[axis] < b.centroid[axis]; });
+
+			//Areas of the boxes around every suffix of the sorted objects, then a forward pass over the prefixes
+			glm::vec3 rightMin = entries[end - 1].minPoint;
+			glm::vec3 rightMax = entries[end - 1].maxPoint;
+			for (uint32_t i = count - 1; i > 0; i--)
+			{
+				rightMin = glm::min(rightMin, entries[begin + i].minPoint);
+				rightMax = glm::max(rightMax, entries[begin + i].maxPoint);
+				rightAreas[i] = getSurfaceArea(rightMin, rightMax);
+			}
+			glm::vec3 leftMin = entries[begin].minPoint;
+			glm::vec3 leftMax = entries[begin].maxPoint;
+			for (uint32_t i = 1; i < count; i++)
+			{
+				//Testing the two children costs one box each, plus the objects in each child weighted by how likely a ray through the node is to reach it
+				float cost = 1.0f + (getSurfaceArea(leftMin, leftMax) * i + rightAreas[i] * (count - i)) / nodeArea;
+				if (cost < bestCost)
+				{
+					bestCost = cost;
+					bestAxis = axis;
+					bestSplit = i;
+				}
+				leftMin = glm::min(leftMin, entries[begin + i].minPoint);
+				leftMax = glm::max(leftMax, entries[begin + i].maxPoint);
+			}
+		}
+	}
+
+	if (bestAxis < 0)
+	{
+		node.first = this->objects.size();
+		node.count = count;
+		for (uint32_t i = begin; i < end; i++)
+		{
+			this->objects.push_back(entries[i].object);
+		}
+		this->nodes[nodeIndex] = node;
+		return nodeIndex;
+	}
+
+	std::sort(entries.begin() + begin, entries.begin() + end, [bestAxis](const BuildEntry & a, const BuildEntry & b) { return a.centroid[bestAxis] < b.centroid[bestAxis]; });
+	buildNode(entries, begin, begin + bestSplit, depth + 1);
+	node.first = buildNode(entries, begin + bestSplit, end, depth + 1);
+	node.count = 0;
+	this->nodes[nodeIndex] = node;
+	return nodeIndex;
+}
+
+bool SceneBVH::update(const std::vector<Object*> & objectList)
+{
+	return update(objectList, getObjectBounds);
+}
+
+bool SceneBVH::update(const std::vector<Object*> & objectList, const BoundsFunction & getBounds)
+{
+	if (!isBuiltFrom(objectList) || !refit(getBounds) || getCost() > this->builtCost * REBUILD_COST_RATIO)
+	{
+		build(objectList, getBounds);
+		return true;
+	}
+	return false;
+}
+
+bool SceneBVH::isBuiltFrom(const std::vector<Object*> & objectList) const
+{
+	return this->buildCount > 0 && this->sourceObjects == objectList;
+}
+
+bool SceneBVH::refit(const BoundsFunction & getBounds)
+{
+	this->refitCount++;
+	//Children are always stored after their parent, so going through the nodes backwards refits every child before its parent
+	for (uint32_t i = this->nodes.size(); i-- > 0;)
+	{
+		Node & node = this->nodes[i];
+		if (node.count > 0)
+		{
+			if (!getBounds(this->objects[node.first], node.minPoint, node.maxPoint))
+			{
+				return false;
+			}
+			for (uint32_t j = node.first + 1; j < node.first + node.count; j++)
+			{
+				glm::vec3 minPoint;
+				glm::vec3 maxPoint;
+				if (!getBounds(this->objects[j], minPoint, maxPoint))
+				{
+					return false;
+				}
+				node.minPoint = glm::min(node.minPoint, minPoint);
+				node.maxPoint = glm::max(node.maxPoint, maxPoint);
+			}
+		}
+		else
+		{
+			const Node & left = this->nodes[i + 1];
+			const Node & right = this->nodes[node.first];
+			node.minPoint = glm::min(left.minPoint, right.minPoint);
+			node.maxPoint = glm::max(left.maxPoint, right.maxPoint);
+		}
+	}
+	//Objects without bounds stay without them, one that gained bounds is only put in the tree by building it again
+	for (Object * object : this->unboundedObjects)
+	{
+		glm::vec3 minPoint;
+		glm::vec3 maxPoint;
+		if (getBounds(object, minPoint, maxPoint))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+float SceneBVH::getCost() const
+{
+	if (this->nodes.empty())
+	{
+		return 0.0f;
+	}
+	float rootArea = std::max(getSurfaceArea(this->nodes[0].minPoint, this->nodes[0].maxPoint), MathFunctions::EPSILON);
+	float cost = 0.0f;
+	for (const Node & node : this->nodes)
+	{
+		cost += getSurfaceArea(node.minPoint, node.maxPoint) / rootArea * (node.count > 0 ? node.count : 1.0f);
+	}
+	return cost;
+}
+
+uint32_t SceneBVH::getRefitCount() const
+{
+	return this->refitCount;
+}
+
+uint32_t SceneBVH::getBuildCount() const
+{
+	return this->buildCount;
+}
+
+float SceneBVH::getSurfaceArea(const glm::vec3 & minPoint, const glm::vec3 & maxPoint)
+{
+	glm::vec3 size = maxPoint - minPoint;
+	return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+}
@@ -0,0 +1,172 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <functional>
+
+#include <glm/vec3.hpp>
+
+#include "../Geometry/AABB.h"
+#include "../Renderer/Ray.h"
+#include "../Math/MathFunctions.h"
+
+class Object;
+
+//Deepest tree that is built, this bounds the traversal stack so it can live on the stack of the caller
+constexpr uint32_t SCENE_BVH_MAX_DEPTH = 48;
+constexpr uint32_t SCENE_BVH_STACK_SIZE = SCENE_BVH_MAX_DEPTH + 2;
+
+//Bounding volume hierarchy over the objects of the scene, the top level structure rays are traced through before they reach the octrees of the objects
+//It is built with the surface area heuristic from the world space bounds of each object, objects without bounds are kept aside and tested by every ray
+//When objects move the boxes are refit in place, and the tree is only built again once refitting has made it too loose, see update
+class SceneBVH
+{
+public:
+	//Leaves are never split below this many objects
+	static const uint32_t MAX_LEAF_OBJECTS;
+	//The tree is built again once the surface area cost of the refit tree is this many times the cost it had when it was built
+	static const float REBUILD_COST_RATIO;
+
+	//Gives the world space bounds of an object, returns false if it has none
+	typedef std::function<bool(Object*, glm::vec3&, glm::vec3&)> BoundsFunction;
+
+	SceneBVH();
+
+	void build(const std::vector<Object*> & objectList);
+	//Refits the tree to the current bounds of its objects, building it again if the objects are not the ones it was built from or the tree has become too loose
+	//Returns true if the tree was built again
+	bool update(const std::vector<Object*> & objectList);
+	//Builds or updates the tree with bounds that are not the current ones of the objects, such as the bounds they will have in the next frame
+	void build(const std::vector<Object*> & objectList, const BoundsFunction & getBounds);
+	bool update(const std::vector<Object*> & objectList, const BoundsFunction & getBounds);
+	bool isBuiltFrom(const std::vector<Object*> & objectList) const;
+
+	//Expected number of boxes and objects a ray through the root tests, relative to the surface area of the root
+	float getCost() const;
+	uint32_t getRefitCount() const;
+	uint32_t getBuildCount() const;
+
+	//Calls the object function for the objects whose boxes the ray passes through, roughly nearest first, stopping if it returns true
+	//The object function lowers the upper bound when it finds a nearer hit, boxes that start past the upper bound are skipped
+	template <typename ObjectFunction>
+	void traverse(const Ray & ray, float & upperBound, ObjectFunction visitObject) const
+	{
+		for (Object * object : this->unboundedObjects)
+		{
+			if (visitObject(object))
+			{
+				return;
+			}
+		}
+		if (this->nodes.empty())
+		{
+			return;
+		}
+
+		//The next node to visit is at the back of the stack along with the distance the ray enters it
+		uint32_t stack[SCENE_BVH_STACK_SIZE];
+		float stackParameters[SCENE_BVH_STACK_SIZE];
+		uint32_t stackSize = 0;
+		float rootParameter = MathFunctions::T_INFINITY;
+		if (!intersectNode(this->nodes[0], ray, rootParameter))
+		{
+			return;
+		}
+		stack[stackSize] = 0;
+		stackParameters[stackSize++] = rootParameter;
+
+		while (stackSize > 0)
+		{
+			stackSize--;
+			const Node & node = this->nodes[stack[stackSize]];
+			if (stackParameters[stackSize] > upperBound)
+			{
+				continue;
+			}
+
+			if (node.count > 0)
+			{
+				for (uint32_t i = node.first; i < node.first + node.count; i++)
+				{
+					if (visitObject(this->objects[i]))
+					{
+						return;
+					}
+				}
+				continue;
+			}
+
+			//The left child follows its parent, the right child is stored at the first index of the parent
+			uint32_t nearChild = stack[stackSize] + 1;
+			uint32_t farChild = node.first;
+			float nearParameter = MathFunctions::T_INFINITY;
+			float farParameter = MathFunctions::T_INFINITY;
+			bool nearHit = intersectNode(this->nodes[nearChild], ray, nearParameter);
+			bool farHit = intersectNode(this->nodes[farChild], ray, farParameter);
+			if (nearHit && farHit && farParameter < nearParameter)
+			{
+				std::swap(nearChild, farChild);
+				std::swap(nearParameter, farParameter);
+			}
+			//The far child is pushed first so the near one is visited next
+			if (farHit)
+			{
+				stack[stackSize] = farChild;
+				stackParameters[stackSize++] = farParameter;
+			}
+			if (nearHit)
+			{
+				stack[stackSize] = nearChild;
+				stackParameters[stackSize++] = nearParameter;
+			}
+		}
+	}
+
+private:
+	//A leaf holds count objects from first on, an inner node has a count of zero and the index of its right child in first
+	struct Node
+	{
+		glm::vec3 minPoint;
+		glm::vec3 maxPoint;
+		uint32_t first;
+		uint32_t count;
+	};
+
+	struct BuildEntry
+	{
+		Object * object;
+		glm::vec3 minPoint;
+		glm::vec3 maxPoint;
+		glm::vec3 centroid;
+	};
+
+	std::vector<Node> nodes;
+	//Objects in the order the leaves reference them
+	std::vector<Object*> objects;
+	std::vector<Object*> unboundedObjects;
+	//The object list the tree was built from, in its original order
+	std::vector<Object*> sourceObjects;
+	float builtCost;
+	uint32_t refitCount;
+	uint32_t buildCount;
+
+	uint32_t buildNode(std::vector<BuildEntry> & entries, uint32_t begin, uint32_t end, uint32_t depth);
+	//Returns false if an object has lost its bounds, which needs the tree to be built again
+	bool refit(const BoundsFunction & getBounds);
+
+	static float getSurfaceArea(const glm::vec3 & minPoint, const glm::vec3 & maxPoint);
+
+	//Gives the parameter the ray enters the node at, which is zero if the ray starts inside it
+	static bool intersectNode(const Node & node, const Ray & ray, float & parameter)
+	{
+		if (!AABB::intersectBounds(node.minPoint, node.maxPoint, ray, parameter))
+		{
+			return false;
+		}
+		if (AABB::containsPoint(node.minPoint, node.maxPoint, ray.getOrigin()))
+		{
+			parameter = 0.0f;
+		}
+		return true;
+	}
+};
\ No newline at end of file
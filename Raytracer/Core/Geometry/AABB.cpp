@@ -15,9 +15,16 @@ AABB::AABB(glm::vec3 c, glm::vec3 hDist) : center(c), halfDistances(hDist)
 
 bool AABB::intersect(const Ray & ray, float & t)
 {
-	glm::vec3 min = getMinAsPoint();
-	glm::vec3 max = getMaxAsPoint();
+	return intersectBounds(getMinAsPoint(), getMaxAsPoint(), ray, t);
+}
+
+bool AABB::containsPoint(const glm::vec3 & min, const glm::vec3 & max, const glm::vec3 & point)
+{
+	return point.x >= min.x && point.y >= min.y && point.z >= min.z && point.x <= max.x && point.y <= max.y && point.z <= max.z;
+}
 
+bool AABB::intersectBounds(const glm::vec3 & min, const glm::vec3 & max, const Ray & ray, float & t)
+{
 	float tmin = (min.x - ray.getOrigin().x) / ray.getDirectionVector().x;
 	float tmax = (max.x - ray.getOrigin().x) / ray.getDirectionVector().x;
 
@@ -184,13 +191,18 @@ glm::vec3 AABB::getHalfDistances() const
 }
 
 AABB * AABB::calculateBoundingBox(const std::vector<glm::vec3> & pointList)
+{
+	return calculateBoundingBox(pointList.data(), pointList.size());
+}
+
+AABB * AABB::calculateBoundingBox(const glm::vec3 * pointList, size_t pointCount)
 {
 	glm::vec3 firstVert = pointList[0];
 	float minX = firstVert.x, maxX = firstVert.x;
 	float minY = firstVert.y, maxY = firstVert.y;
 	float minZ = firstVert.z, maxZ = firstVert.z;
 
-	for (uint32_t i = 1; i < pointList.size(); i++)
+	for (uint32_t i = 1; i < pointCount; i++)
 	{
 		glm::vec3 vert = pointList[i];
 		minX = std::min(minX, vert.x);
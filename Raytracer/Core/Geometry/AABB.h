@@ -22,6 +22,11 @@ public:
 	glm::vec3 getHalfDistances() const;
 
 	static AABB * calculateBoundingBox(const std::vector<glm::vec3> & pointsList);
+	static AABB * calculateBoundingBox(const glm::vec3 * points, size_t pointCount);
+	//Ray test against a box given by its corners, for boxes that are decoded on the fly instead of being stored as an AABB
+	static bool intersectBounds(const glm::vec3 & min, const glm::vec3 & max, const Ray & ray, float & t);
+	//Rays that start inside a box get the parameter they leave it at from intersectBounds, this tells them apart
+	static bool containsPoint(const glm::vec3 & min, const glm::vec3 & max, const glm::vec3 & point);
 
 private:
 	glm::vec3 center;
@@ -3,6 +3,7 @@
 #include <glm/geometric.hpp>
 
 #include "../Renderer/Materials/Material.h"
+#include "../Math/MathFunctions.h"
 
 #define _USE_MATH_DEFINES
 #include <math.h>
@@ -16,12 +17,18 @@ void Sphere::getSurfaceData(const glm::vec3 & intersectionPoint, const Intersect
 	//Calculate the normal by subtracting the intersection point from the center of the sphere
 	normal = glm::normalize(intersectionPoint - this->position);
 
-	textureCoords.x = (1 + atan2(normal.z, normal.x) / (float)M_PI) * 0.5f;
-	textureCoords.y = acosf(normal.y) / (float)M_PI;
+	textureCoords = getTextureCoordinates(intersectionPoint, intersectionData);
 
 	material = this->getMaterial();
 }
 
+glm::vec2 Sphere::getTextureCoordinates(const glm::vec3 & point, const IntersectionData & intersectionData)
+{
+	//Spherical mapping of the direction from the center of the sphere to the point
+	glm::vec3 direction = glm::normalize(point - this->position);
+	return glm::vec2((1 + atan2(direction.z, direction.x) / (float)M_PI) * 0.5f, acosf(MathFunctions::clamp(-1.0f, 1.0f, direction.y)) / (float)M_PI);
+}
+
 bool Sphere::possibleIntersection(const Ray & ray, float & parameter)
 {
 	return intersectSphere(ray, parameter);
@@ -32,6 +39,13 @@ bool Sphere::intersect(const Ray & ray, float & parameter, IntersectionData & in
 	return intersectSphere(ray, parameter);
 }
 
+bool Sphere::getBounds(glm::vec3 & minPoint, glm::vec3 & maxPoint)
+{
+	minPoint = this->position - glm::vec3(this->radius);
+	maxPoint = this->position + glm::vec3(this->radius);
+	return true;
+}
+
 bool Sphere::intersectSphere(const Ray & ray, float & parameter)
 {
 	//Find the distance squared between the ray origin and center
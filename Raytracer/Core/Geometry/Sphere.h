@@ -9,11 +9,13 @@ public:
 	Sphere(glm::vec3 pos, float rad, Material * material);
 
 	void getSurfaceData(const glm::vec3 & intersectionPoint, const IntersectionData & intersectionData, glm::vec3 & normal, glm::vec2 & textureCoords, Material *& material);
+	glm::vec2 getTextureCoordinates(const glm::vec3 & point, const IntersectionData & intersectionData);
 
 	//This intersection test is meant to be a rough but fast intersection test to cull impossible intersections
 	bool possibleIntersection(const Ray & ray, float & parameter);
 	//This intersection test is a definitive intersection test to see if a ray intersects an object
 	bool intersect(const Ray & ray, float & parameter, IntersectionData & intersectionData);
+	bool getBounds(glm::vec3 & minPoint, glm::vec3 & maxPoint);
 
 private:
 	float radius;
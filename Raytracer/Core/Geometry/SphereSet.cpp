@@ -0,0 +1,401 @@
+#include "SphereSet.h"
+
+#include "../Math/MathFunctions.h"
+#include "../Renderer/Materials/Material.h"
+
+#include <glm/geometric.hpp>
+
+#include <algorithm>
+
+#define _USE_MATH_DEFINES
+#include <math.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SPHERE_SET_USE_SSE
+#include <emmintrin.h>
+#endif
+
+//Average amount of grid cells created per sphere, keeps the grid memory small compared to the sphere data
+constexpr float CELLS_PER_SPHERE = 1.0f;
+//Maximum amount of cells along a single axis of the grid
+constexpr int32_t MAX_GRID_RESOLUTION = 1024;
+
+SphereSet::SphereSet(Material * material) : Object(glm::vec3(0.0f), material), boundsMin(0.0f), boundsMax(0.0f), cellSize(1.0f), inverseCellSize(1.0f)
+{
+	gridResolution[0] = gridResolution[1] = gridResolution[2] = 1;
+}
+
+void SphereSet::reserve(uint32_t count)
+{
+	centersX.reserve(count);
+	centersY.reserve(count);
+	centersZ.reserve(count);
+	radii.reserve(count);
+}
+
+void SphereSet::addSphere(glm::vec3 center, float radius)
+{
+	centersX.push_back(center.x);
+	centersY.push_back(center.y);
+	centersZ.push_back(center.z);
+	radii.push_back(radius);
+}
+
+void SphereSet::build()
+{
+	uint32_t sphereCount = getSphereCount();
+	if (sphereCount == 0)
+	{
+		return;
+	}
+
+	//Calculate the bounds of all the spheres
+	boundsMin = glm::vec3(MathFunctions::T_INFINITY);
+	boundsMax = glm::vec3(-MathFunctions::T_INFINITY);
+	for (uint32_t i = 0; i < sphereCount; i++)
+	{
+		glm::vec3 center(centersX[i], centersY[i], centersZ[i]);
+		boundsMin = glm::min(boundsMin, center - glm::vec3(radii[i]));
+		boundsMax = glm::max(boundsMax, center + glm::vec3(radii[i]));
+	}
+	this->position = (boundsMin + boundsMax) * 0.5f;
+
+	calculateGridResolution();
+	uint32_t cellCount = gridResolution[0] * gridResolution[1] * gridResolution[2];
+
+	//Sort the spheres by the cell their center lies in so spheres in the same cell are next to each other in memory
+	std::vector<uint32_t> centerCells(sphereCount);
+	std::vector<uint32_t> cellStarts(cellCount + 1, 0);
+	for (uint32_t i = 0; i < sphereCount; i++)
+	{
+		glm::vec3 cell = (glm::vec3(centersX[i], centersY[i], centersZ[i]) - boundsMin) * inverseCellSize;
+		centerCells[i] = getCellIndex((int32_t)cell.x, (int32_t)cell.y, (int32_t)cell.z);
+		cellStarts[centerCells[i] + 1]++;
+	}
+	for (uint32_t i = 0; i < cellCount; i++)
+	{
+		cellStarts[i + 1] += cellStarts[i];
+	}
+	std::vector<float> sortedData(sphereCount);
+	std::vector<uint32_t> sortedOrder(sphereCount);
+	for (uint32_t i = 0; i < sphereCount; i++)
+	{
+		sortedOrder[cellStarts[centerCells[i]]++] = i;
+	}
+	std::vector<float> * arrays[4] = { &centersX, &centersY, &centersZ, &radii };
+	for (std::vector<float> * array : arrays)
+	{
+		for (uint32_t i = 0; i < sphereCount; i++)
+		{
+			sortedData[i] = (*array)[sortedOrder[i]];
+		}
+		array->swap(sortedData);
+	}
+	std::vector<uint32_t>().swap(centerCells);
+	std::vector<uint32_t>().swap(sortedOrder);
+	std::vector<float>().swap(sortedData);
+
+	//Count the amount of spheres overlapping each cell
+	cellOffsets.assign(cellCount + 1, 0);
+	for (uint32_t i = 0; i < sphereCount; i++)
+	{
+		int32_t cellMin[3], cellMax[3];
+		getCellRange(i, cellMin, cellMax);
+		for (int32_t z = cellMin[2]; z <= cellMax[2]; z++)
+		{
+			for (int32_t y = cellMin[1]; y <= cellMax[1]; y++)
+			{
+				for (int32_t x = cellMin[0]; x <= cellMax[0]; x++)
+				{
+					cellOffsets[getCellIndex(x, y, z) + 1]++;
+				}
+			}
+		}
+	}
+	for (uint32_t i = 0; i < cellCount; i++)
+	{
+		cellOffsets[i + 1] += cellOffsets[i];
+	}
+
+	//Fill the sphere index list for each cell using the counted offsets
+	sphereIndices.resize(cellOffsets[cellCount]);
+	std::vector<uint32_t> fillPositions(cellOffsets.begin(), cellOffsets.end() - 1);
+	for (uint32_t i = 0; i < sphereCount; i++)
+	{
+		int32_t cellMin[3], cellMax[3];
+		getCellRange(i, cellMin, cellMax);
+		for (int32_t z = cellMin[2]; z <= cellMax[2]; z++)
+		{
+			for (int32_t y = cellMin[1]; y <= cellMax[1]; y++)
+			{
+				for (int32_t x = cellMin[0]; x <= cellMax[0]; x++)
+				{
+					sphereIndices[fillPositions[getCellIndex(x, y, z)]++] = i;
+				}
+			}
+		}
+	}
+}
+
+uint32_t SphereSet::getSphereCount() const
+{
+	return (uint32_t)radii.size();
+}
+
+size_t SphereSet::getMemoryUsage() const
+{
+	return (centersX.capacity() + centersY.capacity() + centersZ.capacity() + radii.capacity()) * sizeof(float) + (cellOffsets.capacity() + sphereIndices.capacity()) * sizeof(uint32_t);
+}
+
+void SphereSet::getSurfaceData(const glm::vec3 & intersectionPoint, const IntersectionData & intersectionData, glm::vec3 & normal, glm::vec2 & textureCoords, Material *& material)
+{
+	uint32_t i = intersectionData.primitiveIndex;
+	//Calculate the normal by subtracting the intersection point from the center of the sphere that was hit
+	normal = glm::normalize(intersectionPoint - glm::vec3(centersX[i], centersY[i], centersZ[i]));
+
+	textureCoords = getTextureCoordinates(intersectionPoint, intersectionData);
+
+	material = this->getMaterial();
+}
+
+glm::vec2 SphereSet::getTextureCoordinates(const glm::vec3 & point, const IntersectionData & intersectionData)
+{
+	uint32_t i = intersectionData.primitiveIndex;
+	//Spherical mapping of the direction from the center of the sphere that was hit to the point
+	glm::vec3 direction = glm::normalize(point - glm::vec3(centersX[i], centersY[i], centersZ[i]));
+	return glm::vec2((1 + atan2(direction.z, direction.x) / (float)M_PI) * 0.5f, acosf(MathFunctions::clamp(-1.0f, 1.0f, direction.y)) / (float)M_PI);
+}
+
+bool SphereSet::possibleIntersection(const Ray & ray, float & parameter)
+{
+	float tEnter, tExit;
+	if (getSphereCount() == 0 || !intersectBounds(ray, tEnter, tExit))
+	{
+		return false;
+	}
+	parameter = tEnter;
+	return true;
+}
+
+bool SphereSet::getBounds(glm::vec3 & minPoint, glm::vec3 & maxPoint)
+{
+	minPoint = this->boundsMin;
+	maxPoint = this->boundsMax;
+	return true;
+}
+
+bool SphereSet::intersect(const Ray & ray, float & parameter, IntersectionData & intersectionData)
+{
+	float tEnter, tExit;
+	if (cellOffsets.empty() || !intersectBounds(ray, tEnter, tExit))
+	{
+		return false;
+	}
+
+	glm::vec3 origin = ray.getOrigin();
+	glm::vec3 direction = ray.getDirectionVector();
+	glm::vec3 entryPoint = origin + direction * tEnter;
+
+	//Setup the 3D digital differential analyzer to step through the cells along the ray
+	int32_t cell[3];
+	int32_t step[3];
+	float tNext[3];
+	float tDelta[3];
+	for (uint32_t axis = 0; axis < 3; axis++)
+	{
+		cell[axis] = std::min(std::max((int32_t)((entryPoint[axis] - boundsMin[axis]) * inverseCellSize[axis]), 0), gridResolution[axis] - 1);
+		if (direction[axis] > 0.0f)
+		{
+			step[axis] = 1;
+			tNext[axis] = tEnter + (boundsMin[axis] + (cell[axis] + 1) * cellSize[axis] - entryPoint[axis]) / direction[axis];
+			tDelta[axis] = cellSize[axis] / direction[axis];
+		}
+		else if (direction[axis] < 0.0f)
+		{
+			step[axis] = -1;
+			tNext[axis] = tEnter + (boundsMin[axis] + cell[axis] * cellSize[axis] - entryPoint[axis]) / direction[axis];
+			tDelta[axis] = -cellSize[axis] / direction[axis];
+		}
+		else
+		{
+			step[axis] = 0;
+			tNext[axis] = MathFunctions::T_INFINITY;
+			tDelta[axis] = MathFunctions::T_INFINITY;
+		}
+	}
+
+	uint32_t sphereHit = 0;
+	bool hit = false;
+	while (true)
+	{
+		float tCellExit = std::min(std::min(tNext[0], tNext[1]), std::min(tNext[2], tExit));
+		if (intersectCell(ray, getCellIndex(cell[0], cell[1], cell[2]), parameter, sphereHit))
+		{
+			hit = true;
+		}
+
+		//A hit inside the current cell is the nearest hit, hits past the cell could still be beaten by spheres in the next cells
+		if (hit && parameter <= tCellExit)
+		{
+			break;
+		}
+
+		//Step into the neighbouring cell along the axis with the nearest cell boundary
+		uint32_t axis = tNext[0] < tNext[1] ? (tNext[0] < tNext[2] ? 0 : 2) : (tNext[1] < tNext[2] ? 1 : 2);
+		cell[axis] += step[axis];
+		if (cell[axis] < 0 || cell[axis] >= gridResolution[axis] || tNext[axis] > tExit)
+		{
+			break;
+		}
+		tNext[axis] += tDelta[axis];
+	}
+
+	if (hit)
+	{
+		intersectionData.primitiveIndex = sphereHit;
+	}
+	return hit;
+}
+
+bool SphereSet::intersectBounds(const Ray & ray, float & tEnter, float & tExit)
+{
+	glm::vec3 inverseDirection = 1.0f / ray.getDirectionVector();
+	glm::vec3 t0 = (boundsMin - ray.getOrigin()) * inverseDirection;
+	glm::vec3 t1 = (boundsMax - ray.getOrigin()) * inverseDirection;
+	glm::vec3 tSmaller = glm::min(t0, t1);
+	glm::vec3 tLarger = glm::max(t0, t1);
+
+	tEnter = std::max(std::max(tSmaller.x, tSmaller.y), std::max(tSmaller.z, 0.0f));
+	tExit = std::min(std::min(tLarger.x, tLarger.y), tLarger.z);
+	return tEnter <= tExit;
+}
+
+bool SphereSet::intersectCell(const Ray & ray, uint32_t cellIndex, float & parameter, uint32_t & sphereHit)
+{
+	const uint32_t * indices = sphereIndices.data();
+	uint32_t begin = cellOffsets[cellIndex];
+	uint32_t end = cellOffsets[cellIndex + 1];
+	glm::vec3 origin = ray.getOrigin();
+	glm::vec3 direction = ray.getDirectionVector();
+	bool hit = false;
+
+	uint32_t i = begin;
+#ifdef SPHERE_SET_USE_SSE
+	const __m128 originX = _mm_set1_ps(origin.x);
+	const __m128 originY = _mm_set1_ps(origin.y);
+	const __m128 originZ = _mm_set1_ps(origin.z);
+	const __m128 directionX = _mm_set1_ps(direction.x);
+	const __m128 directionY = _mm_set1_ps(direction.y);
+	const __m128 directionZ = _mm_set1_ps(direction.z);
+	const __m128 epsilon = _mm_set1_ps(MathFunctions::EPSILON);
+	const __m128 zero = _mm_setzero_ps();
+
+	//Test 4 spheres at a time
+	for (; i + 4 <= end; i += 4)
+	{
+		const uint32_t * s = indices + i;
+		__m128 toCenterX = _mm_sub_ps(_mm_setr_ps(centersX[s[0]], centersX[s[1]], centersX[s[2]], centersX[s[3]]), originX);
+		__m128 toCenterY = _mm_sub_ps(_mm_setr_ps(centersY[s[0]], centersY[s[1]], centersY[s[2]], centersY[s[3]]), originY);
+		__m128 toCenterZ = _mm_sub_ps(_mm_setr_ps(centersZ[s[0]], centersZ[s[1]], centersZ[s[2]], centersZ[s[3]]), originZ);
+		__m128 radius = _mm_setr_ps(radii[s[0]], radii[s[1]], radii[s[2]], radii[s[3]]);
+
+		//Distance along the ray to the point closest to each sphere center
+		__m128 closestApproach = _mm_add_ps(_mm_add_ps(_mm_mul_ps(toCenterX, directionX), _mm_mul_ps(toCenterY, directionY)), _mm_mul_ps(toCenterZ, directionZ));
+		__m128 distanceSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(toCenterX, toCenterX), _mm_mul_ps(toCenterY, toCenterY)), _mm_mul_ps(toCenterZ, toCenterZ));
+		__m128 halfChordSquared = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(radius, radius), _mm_mul_ps(closestApproach, closestApproach)), distanceSquared);
+		__m128 valid = _mm_cmpge_ps(halfChordSquared, zero);
+		if (_mm_movemask_ps(valid) == 0)
+		{
+			continue;
+		}
+
+		//Take the near intersection unless it is behind the ray origin, then take the far intersection
+		__m128 halfChord = _mm_sqrt_ps(_mm_max_ps(halfChordSquared, zero));
+		__m128 nearT = _mm_sub_ps(closestApproach, halfChord);
+		__m128 farT = _mm_add_ps(closestApproach, halfChord);
+		__m128 useNear = _mm_cmpgt_ps(nearT, epsilon);
+		__m128 t = _mm_or_ps(_mm_and_ps(useNear, nearT), _mm_andnot_ps(useNear, farT));
+		valid = _mm_and_ps(valid, _mm_and_ps(_mm_cmpgt_ps(t, epsilon), _mm_cmplt_ps(t, _mm_set1_ps(parameter))));
+
+		int mask = _mm_movemask_ps(valid);
+		if (mask != 0)
+		{
+			float tValues[4];
+			_mm_storeu_ps(tValues, t);
+			for (uint32_t lane = 0; lane < 4; lane++)
+			{
+				if ((mask & (1 << lane)) && tValues[lane] < parameter)
+				{
+					parameter = tValues[lane];
+					sphereHit = s[lane];
+					hit = true;
+				}
+			}
+		}
+	}
+#endif
+
+	//Test the remaining spheres one at a time
+	for (; i < end; i++)
+	{
+		uint32_t s = indices[i];
+		glm::vec3 toCenter = glm::vec3(centersX[s], centersY[s], centersZ[s]) - origin;
+		float closestApproach = glm::dot(toCenter, direction);
+		float halfChordSquared = radii[s] * radii[s] + closestApproach * closestApproach - glm::dot(toCenter, toCenter);
+		if (halfChordSquared < 0.0f)
+		{
+			continue;
+		}
+
+		float halfChord = sqrtf(halfChordSquared);
+		float t = closestApproach - halfChord > MathFunctions::EPSILON ? closestApproach - halfChord : closestApproach + halfChord;
+		if (t > MathFunctions::EPSILON && t < parameter)
+		{
+			parameter = t;
+			sphereHit = s;
+			hit = true;
+		}
+	}
+
+	return hit;
+}
+
+void SphereSet::calculateGridResolution()
+{
+	glm::vec3 extent = glm::max(boundsMax - boundsMin, glm::vec3(MathFunctions::EPSILON));
+	//Choose a cubic cell size which gives about CELLS_PER_SPHERE cells for each sphere
+	float cellEdge = cbrtf(extent.x * extent.y * extent.z / (getSphereCount() * CELLS_PER_SPHERE));
+	//Cells smaller than the average sphere make each sphere overlap many cells, which multiplies the size of the index list
+	double radiusSum = 0.0;
+	for (float radius : radii)
+	{
+		radiusSum += radius;
+	}
+	cellEdge = std::max(cellEdge, (float)(2.0 * radiusSum / getSphereCount()));
+	for (uint32_t axis = 0; axis < 3; axis++)
+	{
+		gridResolution[axis] = std::min(std::max((int32_t)ceilf(extent[axis] / cellEdge), 1), MAX_GRID_RESOLUTION);
+		cellSize[axis] = extent[axis] / gridResolution[axis];
+		inverseCellSize[axis] = 1.0f / cellSize[axis];
+	}
+}
+
+void SphereSet::getCellRange(uint32_t sphereIndex, int32_t cellMin[3], int32_t cellMax[3])
+{
+	glm::vec3 center(centersX[sphereIndex], centersY[sphereIndex], centersZ[sphereIndex]);
+	glm::vec3 minCell = (center - glm::vec3(radii[sphereIndex]) - boundsMin) * inverseCellSize;
+	glm::vec3 maxCell = (center + glm::vec3(radii[sphereIndex]) - boundsMin) * inverseCellSize;
+	for (uint32_t axis = 0; axis < 3; axis++)
+	{
+		cellMin[axis] = std::min(std::max((int32_t)minCell[axis], 0), gridResolution[axis] - 1);
+		cellMax[axis] = std::min(std::max((int32_t)maxCell[axis], 0), gridResolution[axis] - 1);
+	}
+}
+
+uint32_t SphereSet::getCellIndex(int32_t x, int32_t y, int32_t z)
+{
+	x = std::min(std::max(x, 0), gridResolution[0] - 1);
+	y = std::min(std::max(y, 0), gridResolution[1] - 1);
+	z = std::min(std::max(z, 0), gridResolution[2] - 1);
+	return (uint32_t)x + (uint32_t)gridResolution[0] * ((uint32_t)y + (uint32_t)gridResolution[1] * (uint32_t)z);
+}
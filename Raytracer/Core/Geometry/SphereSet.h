@@ -0,0 +1,54 @@
+#pragma once
+
+#include "../Objects/Object.h"
+#include "../Renderer/Ray.h"
+
+#include <vector>
+
+//A compact set of spheres sharing one material, meant for particle scale scenes with millions of spheres
+//Sphere data is stored as structure of arrays and indexed by a uniform grid so a ray only tests the spheres in the cells it passes through
+class SphereSet : public Object
+{
+public:
+	SphereSet(Material * material);
+
+	void reserve(uint32_t count);
+	void addSphere(glm::vec3 center, float radius);
+	//Builds the uniform grid, must be called after all the spheres are added and before rendering
+	void build();
+
+	uint32_t getSphereCount() const;
+	size_t getMemoryUsage() const;
+
+	void getSurfaceData(const glm::vec3 & intersectionPoint, const IntersectionData & intersectionData, glm::vec3 & normal, glm::vec2 & textureCoords, Material *& material);
+	glm::vec2 getTextureCoordinates(const glm::vec3 & point, const IntersectionData & intersectionData);
+
+	//This intersection test is meant to be a rough but fast intersection test to cull impossible intersections
+	bool possibleIntersection(const Ray & ray, float & parameter);
+	//This intersection test is a definitive intersection test to see if a ray intersects an object
+	bool intersect(const Ray & ray, float & parameter, IntersectionData & intersectionData);
+	bool getBounds(glm::vec3 & minPoint, glm::vec3 & maxPoint);
+
+private:
+	//Structure of arrays for the sphere data so the intersection kernel can load 4 spheres at a time
+	std::vector<float> centersX;
+	std::vector<float> centersY;
+	std::vector<float> centersZ;
+	std::vector<float> radii;
+
+	//Uniform grid stored in compressed row form, the spheres in cell i are sphereIndices[cellOffsets[i]] to sphereIndices[cellOffsets[i + 1]]
+	std::vector<uint32_t> cellOffsets;
+	std::vector<uint32_t> sphereIndices;
+
+	glm::vec3 boundsMin;
+	glm::vec3 boundsMax;
+	glm::vec3 cellSize;
+	glm::vec3 inverseCellSize;
+	int32_t gridResolution[3];
+
+	bool intersectBounds(const Ray & ray, float & tEnter, float & tExit);
+	bool intersectCell(const Ray & ray, uint32_t cellIndex, float & parameter, uint32_t & sphereHit);
+	void calculateGridResolution();
+	void getCellRange(uint32_t sphereIndex, int32_t cellMin[3], int32_t cellMax[3]);
+	uint32_t getCellIndex(int32_t x, int32_t y, int32_t z);
+};
\ No newline at end of file
@@ -5,6 +5,7 @@
 #include "../Renderer/Materials/Material.h"
 
 #include <glm/geometric.hpp>
+#include <glm/common.hpp>
 
 Triangle::Triangle(glm::vec3 v1, glm::vec3 v2, glm::vec3 v3, Material * material) : Object((v1 + v2 + v3) / 3.0f, material), vertex1(v1), vertex2(v2), vertex3(v3)
 {
@@ -20,16 +21,29 @@ bool Triangle::intersect(const Ray & ray, float & parameter, IntersectionData &
 	return intersectTriangle(ray, this->vertex1, this->vertex2, this->vertex3, parameter);
 }
 
+bool Triangle::getBounds(glm::vec3 & minPoint, glm::vec3 & maxPoint)
+{
+	minPoint = glm::min(this->vertex1, glm::min(this->vertex2, this->vertex3));
+	maxPoint = glm::max(this->vertex1, glm::max(this->vertex2, this->vertex3));
+	return true;
+}
+
 void Triangle::getSurfaceData(const glm::vec3 & intersectionPoint, const IntersectionData & intersectionData, glm::vec3 & normal, glm::vec2 & textureCoords, Material *& material)
 {
 	//Calculate the normal by taking the cross product of the difference of the vertices
 	normal = glm::normalize(glm::cross(this->vertex2 - this->vertex1, this->vertex3 - this->vertex1));
 
-	textureCoords = glm::vec2();
+	textureCoords = getTextureCoordinates(intersectionPoint, intersectionData);
 
 	material = this->getMaterial();
 }
 
+glm::vec2 Triangle::getTextureCoordinates(const glm::vec3 & point, const IntersectionData & intersectionData)
+{
+	//A single triangle has no texture coordinates
+	return glm::vec2();
+}
+
 //Implmentation of Moller-Trumbore Algorithm from https://www.scratchapixel.com/lessons/3d-basic-rendering/ray-tracing-rendering-a-triangle/moller-trumbore-ray-triangle-intersection
 bool Triangle::intersectTriangle(const Ray & ray, const glm::vec3 & vertex1, const glm::vec3 & vertex2, const glm::vec3 & vertex3, float & parameter)
 {
@@ -11,8 +11,10 @@ public:
 	bool possibleIntersection(const Ray & ray, float & parameter);
 	//This intersection test is a definitive intersection test to see if a ray intersects an object
 	bool intersect(const Ray & ray, float & parameter, IntersectionData & intersectionData);
+	bool getBounds(glm::vec3 & minPoint, glm::vec3 & maxPoint);
 
 	void getSurfaceData(const glm::vec3 & intersectionPoint, const IntersectionData & intersectionData, glm::vec3 & normal, glm::vec2 & textureCoords, Material *& material);
+	glm::vec2 getTextureCoordinates(const glm::vec3 & point, const IntersectionData & intersectionData);
 
 	static bool intersectTriangle(const Ray & ray, const glm::vec3 & vertex1, const glm::vec3 & vertex2, const glm::vec3 & vertex3, float & parameter);
 
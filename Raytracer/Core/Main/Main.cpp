@@ -4,19 +4,40 @@
 #include <glm/vec4.hpp>
 #include <algorithm>
 #include <chrono>
+#include <cstring>
+#include <cstdlib>
+#include <future>
+#include <string>
+#include <cstdio>
+#include <cmath>
 
 #include "../Geometry/Sphere.h"
+#include "../Math/MathFunctions.h"
 #include "../Renderer/Camera.h"
 #include "../Renderer/Image.h"
 #include "../Renderer/Lights/DirectionalLight.h"
 #include "../Renderer/Lights/PointLight.h"
 #include "../Renderer/Renderer.h"
+#include "../Renderer/FramePipeline.h"
 #include "../Objects/Models/Mesh.h"
 #include "../Objects/Models/Model.h"
 #include "../Objects/Entity.h"
+#include "../Objects/SceneCompiler.h"
 #include "../Renderer/Materials/RefractiveMaterial.h"
 #include "../Renderer/Materials/PhongMaterial.h"
 #include "../Renderer/Materials/ReflectMaterial.h"
+#include "../Benchmarks/TextureBenchmark.h"
+#include "../Benchmarks/ModelLoadBenchmark.h"
+#include "../Benchmarks/MeshBenchmark.h"
+#include "../Benchmarks/OctreeBenchmark.h"
+#include "../Benchmarks/LazyOctreeBenchmark.h"
+#include "../Benchmarks/SphereSetBenchmark.h"
+#include "../Assets/AssetLoader.h"
+#include "../Assets/ModelCache.h"
+#include "../Assets/GeometryCache.h"
+#include "../Memory/HugePages.h"
+#include "../Memory/TlbCounter.h"
+#include "../Memory/MemoryTracker.h"
 
 #define _USE_MATH_DEFINES
 #include <math.h>
@@ -24,6 +45,8 @@
 //Width and Height of the image in pixels
 const uint32_t WIDTH = 800;
 const uint32_t HEIGHT = 600;
+//Frame rate the keyframe times of a sequence are sampled at
+const uint32_t FRAMES_PER_SECOND = 24;
 
 //Deletes all the dynamically allocated memory in the object and light list
 void cleanup(std::vector<Object*> & objectList, std::vector<Light*> & lightList)
@@ -39,8 +62,116 @@ void cleanup(std::vector<Object*> & objectList, std::vector<Light*> & lightList)
 	}
 }
 
-int main()
+//Prints how far apart two renders of the scene are in 8 bit color values, the way they would be written to the image
+void printImageDifference(const std::vector<glm::vec3> & image, const std::vector<glm::vec3> & reference)
 {
+	double totalDifference = 0.0;
+	float maxDifference = 0.0f;
+	uint32_t differentPixels = 0;
+	for (uint32_t i = 0; i < image.size(); i++)
+	{
+		float pixelDifference = 0.0f;
+		for (uint32_t channel = 0; channel < 3; channel++)
+		{
+			float difference = std::abs(MathFunctions::clamp(0.0f, 1.0f, image[i][channel]) - MathFunctions::clamp(0.0f, 1.0f, reference[i][channel])) * 255.0f;
+			totalDifference += difference;
+			pixelDifference = std::max(pixelDifference, difference);
+		}
+		maxDifference = std::max(maxDifference, pixelDifference);
+		differentPixels += pixelDifference >= 1.0f;
+	}
+	printf("Image difference: mean %.3f, max %.0f, %.2f%% of pixels differ\n", totalDifference / (image.size() * 3.0), maxDifference, 100.0 * differentPixels / image.size());
+}
+
+//Steps through settings of a material and a light the way a look development session would, shading each from primary hits cached once
+//The last setting is checked against a full render of the scene
+void renderLookdev(Renderer & renderer, Camera & camera, std::vector<Object*> & objectList, std::vector<Light*> & lightList, PhongMaterial & material, Light & light)
+{
+	auto renderStartTime = std::chrono::high_resolution_clock::now();
+	renderer.render(camera, objectList, lightList);
+	auto cacheStartTime = std::chrono::high_resolution_clock::now();
+	renderer.cacheHits(camera, objectList);
+	auto cacheEndTime = std::chrono::high_resolution_clock::now();
+	double renderTime = std::chrono::duration<double, std::milli>(cacheStartTime - renderStartTime).count();
+	printf("Full render: %.2f sec\n", renderTime / 1000.0);
+	printf("Cached hits in: %.2f sec, %.1f MB\n", std::chrono::duration<double, std::milli>(cacheEndTime - cacheStartTime).count() / 1000.0, renderer.getHitBufferMemoryUsage() / (1024.0 * 1024.0));
+
+	//Diffuse, specular and power of the material, then the intensity of the light
+	const float settings[][4] = { { 1.0f, 0.0f, 0.0f, 2.0f }, { 0.8f, 0.4f, 20.0f, 2.0f }, { 0.8f, 0.4f, 20.0f, 1.2f }, { 0.6f, 0.8f, 60.0f, 3.0f } };
+	for (uint32_t i = 0; i < sizeof(settings) / sizeof(settings[0]); i++)
+	{
+		material.setDiffuseComponent(settings[i][0]);
+		material.setSpecularComponent(settings[i][1]);
+		material.setPowerComponent(settings[i][2]);
+		light.setIntensity(settings[i][3]);
+
+		auto reshadeStartTime = std::chrono::high_resolution_clock::now();
+		renderer.reshade(camera, objectList, lightList);
+		auto reshadeEndTime = std::chrono::high_resolution_clock::now();
+		double reshadeTime = std::chrono::duration<double, std::milli>(reshadeEndTime - reshadeStartTime).count();
+		printf("Reshade %u (diffuse %.1f, specular %.1f, power %.0f, light %.1f): %.2f sec, %.2fx the speed of a full render\n", i, settings[i][0], settings[i][1], settings[i][2], settings[i][3], reshadeTime / 1000.0, renderTime / reshadeTime);
+	}
+
+	Image image("./out.ppm", WIDTH, HEIGHT);
+	image.writeFramebufferToImage(renderer.getFramebuffer());
+	std::vector<glm::vec3> reshaded = renderer.getFramebuffer();
+	renderer.render(camera, objectList, lightList);
+	printImageDifference(reshaded, renderer.getFramebuffer());
+}
+
+//Returns true if the flag was passed on the command line
+bool hasArgument(int argc, char * argv[], const char * flag)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::strcmp(argv[i], flag) == 0)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+//Returns the value following the flag on the command line, or nullptr if the flag was not passed
+const char * getArgumentValue(int argc, char * argv[], const char * flag)
+{
+	for (int i = 1; i < argc - 1; i++)
+	{
+		if (std::strcmp(argv[i], flag) == 0)
+		{
+			return argv[i + 1];
+		}
+	}
+	return nullptr;
+}
+
+int main(int argc, char * argv[])
+{
+	//Puts large geometry, octree and texture buffers on huge pages, "transparent" asks the kernel for them and "explicit" takes them from the reserved pool first, "off" keeps them on the heap
+	const char * hugePages = getArgumentValue(argc, argv, "--huge-pages");
+	if (hugePages != nullptr)
+	{
+		if (std::strcmp(hugePages, "explicit") == 0)
+		{
+			HugePages::setMode(HugePageMode::Explicit);
+		}
+		else if (std::strcmp(hugePages, "transparent") == 0)
+		{
+			HugePages::setMode(HugePageMode::Transparent);
+		}
+		else if (std::strcmp(hugePages, "off") != 0)
+		{
+			std::cout << "WARNING: Unknown huge page mode " << hugePages << ", expected off, transparent or explicit, huge pages stay off" << std::endl;
+		}
+	}
+
+	//Caps the tracked memory of the render at the given number of megabytes, caches evict to stay under it and anything else going over it stops the render
+	const char * memoryBudget = getArgumentValue(argc, argv, "--memory-budget");
+	if (memoryBudget != nullptr)
+	{
+		MemoryTracker::setBudget((size_t)(atof(memoryBudget) * 1024 * 1024));
+	}
+
 	//Initializes the raytracer renderer
 	Renderer renderer(WIDTH, HEIGHT);
 
@@ -52,9 +183,125 @@ int main()
 	lightList.push_back(new DirectionalLight(glm::vec3(1, -1, -1), glm::vec3(1, 1, 1), 2.0f));
 	lightList.push_back(new PointLight(glm::vec3(1.0f, 1.5f, -9.9f), glm::vec3(1, 1, 1), 50.0f));
 
+	//Block compresses textures in memory, trading a small loss in quality for 4-8x less texture memory
+	renderer.getImageLoader().setCompressTextures(hasArgument(argc, argv, "--compress-textures"));
+	//Pages textures in from tiled cache files on disk, keeping at most the given number of megabytes of texture pages in memory
+	const char * textureCacheBudget = getArgumentValue(argc, argv, "--texture-cache");
+	if (textureCacheBudget != nullptr)
+	{
+		renderer.getImageLoader().enableTextureCache("Resources/TextureCache", (size_t)(atof(textureCacheBudget) * 1024 * 1024));
+	}
 	int32_t missing_texture = renderer.getImageLoader().loadTexture("bad_path");
 	int32_t marble_texture = renderer.getImageLoader().loadTexture("Resources/Textures/marble_floor.png");
 	int32_t trex_texture = renderer.getImageLoader().loadTexture("Resources/Textures/T-REX.png");
+	renderer.getImageLoader().printStatistics();
+
+	//Runs the texture lookup microbenchmark instead of rendering the scene
+	if (hasArgument(argc, argv, "--benchmark-textures"))
+	{
+		TextureBenchmark benchmark(renderer.getImageLoader(), 1 << 22);
+		benchmark.run(marble_texture);
+		benchmark.run(trex_texture);
+		return 0;
+	}
+
+	//Runs the model loading benchmark on the bundled T-Rex and on larger generated files instead of rendering the scene
+	if (hasArgument(argc, argv, "--benchmark-models"))
+	{
+		ModelLoadBenchmark benchmark(3);
+		benchmark.run("Resources/Models/t-rex.obj");
+		uint32_t resolutions[] = { 256, 1024 };
+		for (uint32_t resolution : resolutions)
+		{
+			std::string path = "benchmark_grid_" + std::to_string(resolution) + ".obj";
+			if (ModelLoadBenchmark::writeSyntheticObj(path, resolution))
+			{
+				benchmark.run(path);
+			}
+			std::remove(path.c_str());
+		}
+		return 0;
+	}
+
+	//Runs the octree allocation benchmark on the bundled T-Rex and on a larger generated grid instead of rendering the scene
+	if (hasArgument(argc, argv, "--benchmark-octrees"))
+	{
+		OctreeBenchmark benchmark(5);
+		benchmark.run("Resources/Models/t-rex.obj");
+		std::string path = "benchmark_grid_256.obj";
+		if (ModelLoadBenchmark::writeSyntheticObj(path, 256))
+		{
+			ModelCache::setCacheDirectory("");
+			benchmark.run(path);
+		}
+		std::remove(path.c_str());
+		return 0;
+	}
+
+	//Compares eager and lazy octree building on a scene with a large generated model that is off screen and then in view, instead of rendering the scene
+	if (hasArgument(argc, argv, "--benchmark-lazy-octrees"))
+	{
+		ModelCache::setCacheDirectory("");
+		LazyOctreeBenchmark benchmark(WIDTH, HEIGHT);
+		std::string path = "benchmark_grid_512.obj";
+		if (ModelLoadBenchmark::writeSyntheticObj(path, 512, 10.0f))
+		{
+			benchmark.run("Resources/Models/t-rex.obj", path);
+		}
+		std::remove(path.c_str());
+		return 0;
+	}
+
+	//Renders clouds of up to a million spheres as a SphereSet, and the smaller clouds as separate spheres as well, instead of rendering the scene
+	if (hasArgument(argc, argv, "--benchmark-sphere-sets"))
+	{
+		SphereSetBenchmark benchmark(WIDTH, HEIGHT);
+		benchmark.run({ 1000, 10000, 100000, 1000000 }, 100000);
+		return 0;
+	}
+
+	//Builds the octrees of imported models as rays reach them instead of all at once when they are loaded
+	Model::setLazyOctrees(hasArgument(argc, argv, "--lazy-octrees"));
+
+	//Keeps model geometry in the compact mesh format, quantizing normals and texture coordinates to cut mesh memory
+	Model::setCompactMeshes(hasArgument(argc, argv, "--compact-meshes"));
+	//Replaces model octrees with quantized flat octrees that take a fraction of the memory
+	Model::setQuantizeOctrees(hasArgument(argc, argv, "--quantize-octrees"));
+
+	//Gives meshes coarser levels of detail that rays pick from by their footprint, the threshold scales the footprint and the bias sends secondary rays to coarser levels
+	const char * lodLevels = getArgumentValue(argc, argv, "--lod-levels");
+	if (lodLevels != nullptr)
+	{
+		const char * lodThreshold = getArgumentValue(argc, argv, "--lod-threshold");
+		const char * lodSecondaryBias = getArgumentValue(argc, argv, "--lod-secondary-bias");
+		Model::setLodLevels(atoi(lodLevels));
+		Entity::setLodSelection(true, lodThreshold ? (float)atof(lodThreshold) : 1.0f, lodSecondaryBias ? atoi(lodSecondaryBias) : 0);
+	}
+	//Renders the scene a second time with only the full meshes to report the triangle tests saved and how much the image changed
+	bool lodComparison = lodLevels != nullptr && hasArgument(argc, argv, "--lod-compare");
+	//Triangle tests are only counted for the levels of detail report
+	Mesh::setCountTriangleTests(lodLevels != nullptr);
+
+	//Runs the mesh format benchmark on every model in the scene instead of rendering the scene
+	if (hasArgument(argc, argv, "--benchmark-meshes"))
+	{
+		MeshBenchmark benchmark(1 << 18);
+		const char * modelPaths[] = { "Resources/Models/straw.obj", "Resources/Models/cylinder.obj", "Resources/Models/plane.obj", "Resources/Models/uvsphere.obj", "Resources/Models/t-rex.obj" };
+		for (const char * path : modelPaths)
+		{
+			benchmark.run(path);
+		}
+		return 0;
+	}
+
+	//Streams model geometry in clusters from a cache file on disk, keeping at most the given number of megabytes of clusters in memory
+	GeometryCache * geometryCache = nullptr;
+	const char * geometryCacheBudget = getArgumentValue(argc, argv, "--geometry-cache");
+	if (geometryCacheBudget != nullptr)
+	{
+		geometryCache = new GeometryCache("Resources/GeometryCache", (size_t)(atof(geometryCacheBudget) * 1024 * 1024));
+		Model::setGeometryCache(geometryCache);
+	}
 
 	std::vector<Object*> objectList;
 	PhongMaterial whiteDiffuse = PhongMaterial(glm::vec3(1.0f, 1.0f, 1.0f), 1.0f, 0.0f, 0.0f, true);
@@ -69,34 +316,142 @@ int main()
 	objectList.push_back(new Sphere(glm::vec3(-2.5f, 2.0f, -7.0f), 1.0f, &missingTextureDiffuse));
 	
 
-	Model strawModel = Model("Resources/Models/straw.obj");
-	Entity * straw = new Entity(glm::vec3(0.0f, 1.0f, -7.0f), 1.0f, &strawModel, &greenDiffuse);
+	//Imports every model from its source file instead of the binary model cache
+	if (hasArgument(argc, argv, "--no-model-cache"))
+	{
+		ModelCache::setCacheDirectory("");
+	}
+
+	//Queues every model at once so they are imported and their octrees are built at the same time
+	auto assetStartTime = std::chrono::high_resolution_clock::now();
+	AssetLoader assetLoader;
+	std::shared_future<Model*> strawModel = assetLoader.loadModel("Resources/Models/straw.obj");
+	std::shared_future<Model*> cylinderModel = assetLoader.loadModel("Resources/Models/cylinder.obj");
+	std::shared_future<Model*> planeModel = assetLoader.loadModel("Resources/Models/plane.obj");
+	std::shared_future<Model*> sphereModel = assetLoader.loadModel("Resources/Models/uvsphere.obj");
+	std::shared_future<Model*> tRexModel = assetLoader.loadModel("Resources/Models/t-rex.obj");
+
+	//Starts rendering while the models load, drawing each model as its bounds until it is ready and writing a preview image once every tile has been drawn
+	bool progressive = hasArgument(argc, argv, "--progressive");
+	if (!progressive)
+	{
+		assetLoader.waitForAll();
+		auto assetEndTime = std::chrono::high_resolution_clock::now();
+		printf("Loaded models in: %.1f ms\n", std::chrono::duration<double, std::milli>(assetEndTime - assetStartTime).count());
+	}
+	auto createEntity = [&](const glm::vec3 & position, float scale, const char * path, std::shared_future<Model*> & model, Material * material)
+	{
+		if (!progressive)
+		{
+			return new Entity(position, scale, model.get(), material);
+		}
+		Entity * entity = new Entity(position, scale, model, material);
+		glm::vec3 minPoint;
+		glm::vec3 maxPoint;
+		if (assetLoader.loadProxyBounds(path, minPoint, maxPoint))
+		{
+			entity->setProxyBounds(minPoint, maxPoint);
+		}
+		return entity;
+	};
+
+	Entity * straw = createEntity(glm::vec3(0.0f, 1.0f, -7.0f), 1.0f, "Resources/Models/straw.obj", strawModel, &greenDiffuse);
 	straw->setRotation(0.0f, 0.0f, -45.0f);
 	objectList.push_back(straw);
 
-	Model cylinderModel = Model("Resources/Models/cylinder.obj");
-	objectList.push_back(new Entity(glm::vec3(0.0f, 1.0f, -7.0f), 1.0f, &cylinderModel, &water));
+	objectList.push_back(createEntity(glm::vec3(0.0f, 1.0f, -7.0f), 1.0f, "Resources/Models/cylinder.obj", cylinderModel, &water));
 
-	Model planeModel = Model("Resources/Models/plane.obj");
-	objectList.push_back(new Entity(glm::vec3(0.0f, 0.0f, -6.0f), 10.0f, &planeModel, &marbleFloor));
+	objectList.push_back(createEntity(glm::vec3(0.0f, 0.0f, -6.0f), 10.0f, "Resources/Models/plane.obj", planeModel, &marbleFloor));
 
-	Entity * reflectPlaneEntity = new Entity(glm::vec3(1.0f, 1.5f, -10.0f), 3.0f, &planeModel, &reflect);
+	Entity * reflectPlaneEntity = createEntity(glm::vec3(1.0f, 1.5f, -10.0f), 3.0f, "Resources/Models/plane.obj", planeModel, &reflect);
 	reflectPlaneEntity->setRotation(0.0f, 45.0f, 90.0f);
 	objectList.push_back(reflectPlaneEntity);
 
-	Model sphereModel = Model("Resources/Models/uvsphere.obj");
-	objectList.push_back(new Entity(glm::vec3(3.0f, 1.0f, -6.0f), 1.0f, &sphereModel, &whiteDiffuse));
+	Entity * sphereEntity = createEntity(glm::vec3(3.0f, 1.0f, -6.0f), 1.0f, "Resources/Models/uvsphere.obj", sphereModel, &whiteDiffuse);
+	objectList.push_back(sphereEntity);
 
-	Model tRexModel = Model("Resources/Models/t-rex.obj");
-	Entity * tRexEntity = new Entity(glm::vec3(0.0f, 1.0f, -8.0f), 1.0f, &tRexModel, &tRex);
+	Entity * tRexEntity = createEntity(glm::vec3(0.0f, 1.0f, -8.0f), 1.0f, "Resources/Models/t-rex.obj", tRexModel, &tRex);
 	tRexEntity->setRotation(0.0f, 45.0f, 0.0f);
 	objectList.push_back(tRexEntity);
 
+	//Renders a range of frames, given as first-last, of the t-rex turning around while the white sphere rolls towards the camera and back
+	//With --flythrough the scene stays still and the camera moves in towards the t-rex instead
+	const char * frameRange = getArgumentValue(argc, argv, "--frames");
+	uint32_t firstFrame = 0;
+	uint32_t lastFrame = 0;
+	bool sequence = frameRange != nullptr && !progressive && sscanf(frameRange, "%u-%u", &firstFrame, &lastFrame) == 2 && firstFrame <= lastFrame;
+	if (sequence && hasArgument(argc, argv, "--flythrough"))
+	{
+		camera.addKeyframe(0.0f, glm::vec3(0.0f, 2.5f, 2.0f), 0.0f, 0.0f);
+		camera.addKeyframe(2.0f, glm::vec3(1.5f, 2.0f, -1.0f), -15.0f, 0.0f);
+	}
+	else if (sequence)
+	{
+		tRexEntity->addKeyframe(0.0f, glm::vec3(0.0f, 1.0f, -8.0f), 0.0f, 45.0f, 0.0f, 1.0f);
+		tRexEntity->addKeyframe(2.0f, glm::vec3(0.0f, 1.0f, -8.0f), 0.0f, 405.0f, 0.0f, 1.0f);
+		sphereEntity->addKeyframe(0.0f, glm::vec3(3.0f, 1.0f, -6.0f), 0.0f, 0.0f, 0.0f, 1.0f);
+		sphereEntity->addKeyframe(1.0f, glm::vec3(3.0f, 1.0f, -2.0f), 0.0f, 0.0f, 360.0f, 1.0f);
+		sphereEntity->addKeyframe(2.0f, glm::vec3(3.0f, 1.0f, -6.0f), 0.0f, 0.0f, 0.0f, 1.0f);
+	}
+	else if (frameRange != nullptr)
+	{
+		std::cout << "WARNING: --frames takes a range such as 0-47 and can not be used with --progressive, rendering a single frame" << std::endl;
+	}
+
+	//Bakes entities with at most the given number of faces into world space, the models have to be loaded so this is skipped when rendering progressively
+	const char * flattenThreshold = getArgumentValue(argc, argv, "--flatten-entities");
+	SceneCompiler sceneCompiler(flattenThreshold ? atoi(flattenThreshold) : 0);
+	if (flattenThreshold != nullptr && !progressive)
+	{
+		auto compileStartTime = std::chrono::high_resolution_clock::now();
+		sceneCompiler.flattenStaticEntities(objectList);
+		auto compileEndTime = std::chrono::high_resolution_clock::now();
+		printf("Compiled scene in: %.1f ms\n", std::chrono::duration<double, std::milli>(compileEndTime - compileStartTime).count());
+	}
+
+	//Shades the scene again for a few settings of the t-rex material and the sun without tracing the primary rays again
+	if (hasArgument(argc, argv, "--lookdev") && !progressive && !sequence)
+	{
+		renderLookdev(renderer, camera, objectList, lightList, tRex, *lightList[0]);
+		cleanup(objectList, lightList);
+		delete geometryCache;
+		return 0;
+	}
+
+	if (sequence)
+	{
+		FramePipeline pipeline(renderer, camera, objectList, lightList, WIDTH, HEIGHT, FRAMES_PER_SECOND);
+		//Reuses the pixels of the frame before where they are still valid, retracing the given fraction of the others every frame
+		const char * refreshFraction = getArgumentValue(argc, argv, "--temporal-reuse");
+		if (refreshFraction != nullptr)
+		{
+			pipeline.setTemporalReuse((float)atof(refreshFraction));
+		}
+		pipeline.run(firstFrame, lastFrame);
+		cleanup(objectList, lightList);
+		delete geometryCache;
+		return 0;
+	}
+
 	std::cout << "Start raytracing scene!" << std::endl;
 	//Stores the clock time at the start of the rendering process
 	auto startTime = std::chrono::high_resolution_clock::now();
 
-	renderer.render(camera, objectList, lightList);
+	TlbCounter tlbCounter;
+	tlbCounter.start();
+	if (progressive)
+	{
+		renderer.renderProgressive(camera, objectList, lightList, [&]()
+		{
+			Image preview("./preview.ppm", WIDTH, HEIGHT);
+			preview.writeFramebufferToImage(renderer.getFramebuffer());
+		});
+	}
+	else
+	{
+		renderer.render(camera, objectList, lightList);
+	}
+	tlbCounter.stop();
 
 	std::cout << "Raytracing finished!" << std::endl;
 	//Stores the clock time at the end of the rendering process
@@ -105,6 +460,37 @@ int main()
 	auto elapsedTime = std::chrono::duration<double, std::milli>(endTime - startTime).count();
 	//Prints out the elapsed time in seconds to 2 decimal places
 	printf("Completed Rendering in: %.2f sec\n", elapsedTime / 1000.0f);
+	tlbCounter.printStatistics("Rendering");
+	uint64_t triangleTests = Mesh::getTriangleTests();
+	if (Mesh::isCountingTriangleTests())
+	{
+		printf("Triangle tests: %llu\n", (unsigned long long)triangleTests);
+	}
+	if (lodComparison)
+	{
+		//The levels of detail render is kept as the output image
+		std::vector<glm::vec3> lodImage = renderer.getFramebuffer();
+		Entity::setLodSelection(false);
+		Mesh::resetTriangleTests();
+		auto fullStartTime = std::chrono::high_resolution_clock::now();
+		renderer.render(camera, objectList, lightList);
+		auto fullEndTime = std::chrono::high_resolution_clock::now();
+		uint64_t fullTriangleTests = Mesh::getTriangleTests();
+		printf("Full meshes: %llu triangle tests in %.2f sec, levels of detail do %.1f%% of the tests\n", (unsigned long long)fullTriangleTests, std::chrono::duration<double>(fullEndTime - fullStartTime).count(), 100.0 * triangleTests / std::max<uint64_t>(fullTriangleTests, 1));
+		printImageDifference(lodImage, renderer.getFramebuffer());
+		renderer.getFramebuffer() = lodImage;
+	}
+	if (HugePages::getMode() != HugePageMode::Disabled)
+	{
+		HugePages::printStatistics();
+	}
+
+	renderer.getImageLoader().printStatistics();
+	if (geometryCache)
+	{
+		geometryCache->printStatistics();
+	}
+	MemoryTracker::printReport();
 
 	std::cout << "Writing Image!" << std::endl;
 	Image image("./out.ppm", WIDTH, HEIGHT);
@@ -112,5 +498,6 @@ int main()
 	std::cout << "Image Ready!" << std::endl;
 
 	cleanup(objectList, lightList);
+	delete geometryCache;
 	return 0;
 }
\ No newline at end of file
@@ -0,0 +1,73 @@
+#include "Arena.h"
+
+#include "HugePages.h"
+
+#include <algorithm>
+
+Arena::Arena(MemoryCategory memoryCategory, size_t initialBlockSize, size_t maxBlockSize) : category(memoryCategory), asset(MemoryTracker::getCurrentAsset()), nextBlockSize(initialBlockSize), maxBlockSize(std::max(initialBlockSize, maxBlockSize)), current(nullptr), remaining(0), allocatedBytes(0), reservedBytes(0)
+{
+	//Lets the blocks grow to a whole huge page so the arena can use them
+	if (HugePages::getMode() != HugePageMode::Disabled)
+	{
+		this->maxBlockSize = std::max(this->maxBlockSize, HugePages::HUGE_PAGE_SIZE);
+	}
+}
+
+Arena::~Arena()
+{
+	release();
+}
+
+void * Arena::allocate(size_t size, size_t alignment)
+{
+	size_t padding = (alignment - ((uintptr_t)this->current & (alignment - 1))) & (alignment - 1);
+	if (this->current == nullptr || padding + size > this->remaining)
+	{
+		//Allocations bigger than a block get a block of their own
+		size_t blockSize = std::max(this->nextBlockSize, size + alignment);
+		this->nextBlockSize = std::min(this->nextBlockSize * 2, this->maxBlockSize);
+		MemoryTracker::allocated(this->category, this->asset, blockSize);
+		this->current = (unsigned char *)HugePages::allocate(blockSize);
+		this->remaining = blockSize;
+		this->reservedBytes += blockSize;
+		this->blocks.push_back(this->current);
+		this->blockSizes.push_back(blockSize);
+		padding = (alignment - ((uintptr_t)this->current & (alignment - 1))) & (alignment - 1);
+	}
+
+	unsigned char * result = this->current + padding;
+	this->current += padding + size;
+	this->remaining -= padding + size;
+	this->allocatedBytes += size;
+	return result;
+}
+
+void Arena::release()
+{
+	for (size_t i = 0; i < this->blocks.size(); i++)
+	{
+		HugePages::deallocate(this->blocks[i], this->blockSizes[i]);
+		MemoryTracker::released(this->category, this->asset, this->blockSizes[i]);
+	}
+	this->blocks.clear();
+	this->blockSizes.clear();
+	this->current = nullptr;
+	this->remaining = 0;
+	this->allocatedBytes = 0;
+	this->reservedBytes = 0;
+}
+
+size_t Arena::getAllocatedBytes() const
+{
+	return this->allocatedBytes;
+}
+
+size_t Arena::getReservedBytes() const
+{
+	return this->reservedBytes;
+}
+
+size_t Arena::getBlockCount() const
+{
+	return this->blocks.size();
+}
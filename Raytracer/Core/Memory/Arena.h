@@ -0,0 +1,102 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <utility>
+
+#include "MemoryTracker.h"
+
+//Bump allocator that hands out memory from a few large blocks and frees all of it at once
+//Objects made in an arena never have their destructors run, so it is only for objects that own nothing outside the arena
+//Blocks come from HugePages, so once they grow to a huge page the arena is backed by huge pages when they are enabled
+//Blocks are accounted to the category of the arena and to the asset that was loading when the arena was made
+class Arena
+{
+public:
+	//Blocks start at the initial size and double up to the maximum size so big structures only take a handful of blocks
+	Arena(MemoryCategory category = MemoryCategory::Other, size_t initialBlockSize = 4096, size_t maxBlockSize = 1 << 20);
+	~Arena();
+
+	Arena(const Arena &) = delete;
+	Arena & operator=(const Arena &) = delete;
+
+	void * allocate(size_t size, size_t alignment);
+
+	template <typename T, typename... Arguments>
+	T * create(Arguments&&... arguments)
+	{
+		return new (allocate(sizeof(T), alignof(T))) T(std::forward<Arguments>(arguments)...);
+	}
+
+	//Frees every block, everything allocated from the arena is gone after this
+	void release();
+
+	size_t getAllocatedBytes() const;
+	size_t getReservedBytes() const;
+	size_t getBlockCount() const;
+
+private:
+	std::vector<unsigned char *> blocks;
+	std::vector<size_t> blockSizes;
+	MemoryCategory category;
+	uint32_t asset;
+	size_t nextBlockSize;
+	size_t maxBlockSize;
+	unsigned char * current;
+	size_t remaining;
+	size_t allocatedBytes;
+	size_t reservedBytes;
+};
+
+//Standard library allocator on top of an arena so containers can keep their storage next to the objects that own them
+//Memory given back by the container stays in the arena until it is released, a null arena allocates from the heap instead
+template <typename T>
+class ArenaAllocator
+{
+public:
+	typedef T value_type;
+
+	ArenaAllocator(Arena * a = nullptr) : arena(a) {}
+
+	template <typename U>
+	ArenaAllocator(const ArenaAllocator<U> & other) : arena(other.getArena()) {}
+
+	T * allocate(size_t count)
+	{
+		if (this->arena)
+		{
+			return (T *)this->arena->allocate(count * sizeof(T), alignof(T));
+		}
+		return (T *)::operator new(count * sizeof(T));
+	}
+
+	void deallocate(T * pointer, size_t /*count*/)
+	{
+		if (!this->arena)
+		{
+			::operator delete(pointer);
+		}
+	}
+
+	Arena * getArena() const
+	{
+		return this->arena;
+	}
+
+	template <typename U>
+	bool operator==(const ArenaAllocator<U> & other) const
+	{
+		return this->arena == other.getArena();
+	}
+
+	template <typename U>
+	bool operator!=(const ArenaAllocator<U> & other) const
+	{
+		return this->arena != other.getArena();
+	}
+
+private:
+	Arena * arena;
+};
\ No newline at end of file
@@ -0,0 +1,211 @@
+#include "HugePages.h"
+
+#include <unordered_map>
+#include <mutex>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+const size_t HugePages::HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+namespace
+{
+	enum class Backing
+	{
+		Explicit,
+		Transparent,
+		Regular
+	};
+
+	struct Mapping
+	{
+		size_t size;
+		Backing backing;
+	};
+
+	std::atomic<HugePageMode> currentMode(HugePageMode::Disabled);
+
+	//Mappings made for large buffers, buffers missing from the table came from the heap
+	std::mutex mappingMutex;
+	std::unordered_map<void *, Mapping> mappings;
+	size_t backedBytes[3] = { 0, 0, 0 };
+	size_t peakBackedBytes[3] = { 0, 0, 0 };
+	bool reportedFallback = false;
+
+#ifdef _WIN32
+	//Large pages can only be allocated once the process holds the lock memory privilege, which has to be granted to the user by policy
+	bool enableLockMemoryPrivilege()
+	{
+		HANDLE token;
+		if (!OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &token))
+		{
+			return false;
+		}
+		TOKEN_PRIVILEGES privileges;
+		privileges.PrivilegeCount = 1;
+		privileges.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+		bool enabled = LookupPrivilegeValueA(nullptr, "SeLockMemoryPrivilege", &privileges.Privileges[0].Luid) && AdjustTokenPrivileges(token, FALSE, &privileges, 0, nullptr, nullptr) && GetLastError() == ERROR_SUCCESS;
+		CloseHandle(token);
+		return enabled;
+	}
+
+	void * mapPages(size_t size, HugePageMode mode, Backing & backing)
+	{
+		//Windows has no transparent huge pages, both modes ask for large pages and fall back to regular pages
+		static bool largePagesAllowed = enableLockMemoryPrivilege() && GetLargePageMinimum() == HugePages::HUGE_PAGE_SIZE;
+		if (largePagesAllowed)
+		{
+			void * pointer = VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+			if (pointer != nullptr)
+			{
+				backing = Backing::Explicit;
+				return pointer;
+			}
+		}
+		backing = Backing::Regular;
+		return VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+	}
+
+	void unmapPages(void * pointer, size_t /*size*/)
+	{
+		VirtualFree(pointer, 0, MEM_RELEASE);
+	}
+#else
+	//madvise succeeds even when transparent huge pages are turned off system wide, so the setting is read to know if the advice is followed
+	bool transparentHugePagesEnabled()
+	{
+		FILE * file = fopen("/sys/kernel/mm/transparent_hugepage/enabled", "r");
+		if (file == nullptr)
+		{
+			return false;
+		}
+		char setting[128] = {};
+		fgets(setting, sizeof(setting), file);
+		fclose(file);
+		return std::strstr(setting, "[never]") == nullptr;
+	}
+
+	void * mapPages(size_t size, HugePageMode mode, Backing & backing)
+	{
+#ifdef MAP_HUGETLB
+		if (mode == HugePageMode::Explicit)
+		{
+			void * pointer = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+			if (pointer != MAP_FAILED)
+			{
+				backing = Backing::Explicit;
+				return pointer;
+			}
+		}
+#endif
+
+		//Maps an extra huge page so the buffer can start on a huge page boundary, otherwise the kernel could only use huge pages for the middle of it
+		size_t mappedSize = size + HugePages::HUGE_PAGE_SIZE;
+		unsigned char * mapped = (unsigned char *)mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (mapped == (unsigned char *)MAP_FAILED)
+		{
+			return nullptr;
+		}
+		unsigned char * aligned = (unsigned char *)(((uintptr_t)mapped + HugePages::HUGE_PAGE_SIZE - 1) & ~(uintptr_t)(HugePages::HUGE_PAGE_SIZE - 1));
+		if (aligned > mapped)
+		{
+			munmap(mapped, aligned - mapped);
+		}
+		if (aligned + size < mapped + mappedSize)
+		{
+			munmap(aligned + size, mapped + mappedSize - (aligned + size));
+		}
+
+		backing = Backing::Regular;
+#ifdef MADV_HUGEPAGE
+		static bool transparentEnabled = transparentHugePagesEnabled();
+		if (transparentEnabled && madvise(aligned, size, MADV_HUGEPAGE) == 0)
+		{
+			backing = Backing::Transparent;
+		}
+#endif
+		return aligned;
+	}
+
+	void unmapPages(void * pointer, size_t size)
+	{
+		munmap(pointer, size);
+	}
+#endif
+}
+
+void HugePages::setMode(HugePageMode mode)
+{
+	currentMode = mode;
+}
+
+HugePageMode HugePages::getMode()
+{
+	return currentMode;
+}
+
+void * HugePages::allocate(size_t size)
+{
+	HugePageMode mode = currentMode;
+	if (mode == HugePageMode::Disabled || size < HUGE_PAGE_SIZE)
+	{
+		return ::operator new(size);
+	}
+
+	size_t mappedSize = (size + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+	Backing backing;
+	void * pointer = mapPages(mappedSize, mode, backing);
+	if (pointer == nullptr)
+	{
+		return ::operator new(size);
+	}
+
+	std::lock_guard<std::mutex> lock(mappingMutex);
+	mappings[pointer] = { mappedSize, backing };
+	backedBytes[(int)backing] += mappedSize;
+	peakBackedBytes[(int)backing] = std::max(peakBackedBytes[(int)backing], backedBytes[(int)backing]);
+	if (backing == Backing::Regular && !reportedFallback)
+	{
+		reportedFallback = true;
+		std::printf("WARNING: Huge pages are not available, large buffers use regular pages\n");
+	}
+	return pointer;
+}
+
+void HugePages::deallocate(void * pointer, size_t size)
+{
+	if (pointer == nullptr)
+	{
+		return;
+	}
+	if (size >= HUGE_PAGE_SIZE)
+	{
+		std::unique_lock<std::mutex> lock(mappingMutex);
+		auto mapping = mappings.find(pointer);
+		if (mapping != mappings.end())
+		{
+			Mapping released = mapping->second;
+			mappings.erase(mapping);
+			backedBytes[(int)released.backing] -= released.size;
+			lock.unlock();
+			unmapPages(pointer, released.size);
+			return;
+		}
+	}
+	::operator delete(pointer);
+}
+
+void HugePages::printStatistics()
+{
+	std::lock_guard<std::mutex> lock(mappingMutex);
+	const char * modeNames[] = { "disabled", "transparent", "explicit" };
+	printf("Huge pages (%s): %.1f MB explicit, %.1f MB transparent, %.1f MB regular pages at peak\n", modeNames[(int)currentMode.load()], peakBackedBytes[(int)Backing::Explicit] / (1024.0 * 1024.0), peakBackedBytes[(int)Backing::Transparent] / (1024.0 * 1024.0), peakBackedBytes[(int)Backing::Regular] / (1024.0 * 1024.0));
+}
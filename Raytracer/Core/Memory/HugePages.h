@@ -0,0 +1,99 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+
+#include "MemoryTracker.h"
+
+enum class HugePageMode
+{
+	//Every buffer comes from the heap
+	Disabled,
+	//Large buffers are mapped on their own and the kernel is asked to back them with transparent huge pages
+	Transparent,
+	//Large buffers are taken from the reserved huge page pool, falling back to transparent huge pages and then to regular pages if none are left
+	Explicit
+};
+
+//Backend for the large read only buffers of a scene, mesh vertices and faces, octree arenas and texture levels, that can place them on 2 MB pages
+//A traversal touching a few GB of geometry and textures needs far fewer TLB entries when its pages are 2 MB instead of 4 KB
+//Buffers smaller than a huge page always come from the heap, larger ones are rounded up to whole huge pages
+//Every huge page request falls back to regular pages when the system can not give huge pages, so enabling it never makes an allocation fail
+class HugePages
+{
+public:
+	static const size_t HUGE_PAGE_SIZE;
+
+	static void setMode(HugePageMode mode);
+	static HugePageMode getMode();
+
+	static void * allocate(size_t size);
+	//The size has to be the one the buffer was allocated with
+	static void deallocate(void * pointer, size_t size);
+
+	//Prints how many bytes ended up on explicit huge pages, on transparent huge pages and back on regular pages
+	static void printStatistics();
+};
+
+//Standard library allocator for containers of scene data that may grow large enough to be put on huge pages
+//The bytes are accounted to the category and to the asset that was loading on the thread when the container was made
+//The allocator moves with the storage of its container so the bytes are always released from the asset they were charged to
+template <typename T, MemoryCategory Category = MemoryCategory::Other>
+class HugePageAllocator
+{
+public:
+	typedef T value_type;
+	typedef std::true_type propagate_on_container_copy_assignment;
+	typedef std::true_type propagate_on_container_move_assignment;
+	typedef std::true_type propagate_on_container_swap;
+
+	template <typename U>
+	struct rebind
+	{
+		typedef HugePageAllocator<U, Category> other;
+	};
+
+	HugePageAllocator() : asset(MemoryTracker::getCurrentAsset()) {}
+
+	template <typename U>
+	HugePageAllocator(const HugePageAllocator<U, Category> & other) : asset(other.getAsset()) {}
+
+	T * allocate(size_t count)
+	{
+		MemoryTracker::allocated(Category, this->asset, count * sizeof(T));
+		return (T *)HugePages::allocate(count * sizeof(T));
+	}
+
+	void deallocate(T * pointer, size_t count)
+	{
+		HugePages::deallocate(pointer, count * sizeof(T));
+		MemoryTracker::released(Category, this->asset, count * sizeof(T));
+	}
+
+	uint32_t getAsset() const
+	{
+		return this->asset;
+	}
+
+	//Any allocator can free the storage of another since they only differ in the asset the bytes are charged to
+	template <typename U>
+	bool operator==(const HugePageAllocator<U, Category> & /*other*/) const
+	{
+		return true;
+	}
+
+	template <typename U>
+	bool operator!=(const HugePageAllocator<U, Category> & /*other*/) const
+	{
+		return false;
+	}
+
+private:
+	uint32_t asset;
+};
+
+template <typename T, MemoryCategory Category = MemoryCategory::Other>
+using HugePageVector = std::vector<T, HugePageAllocator<T, Category>>;
\ No newline at end of file
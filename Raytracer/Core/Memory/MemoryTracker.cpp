@@ -0,0 +1,185 @@
+#include "MemoryTracker.h"
+
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+namespace
+{
+	const int CATEGORY_COUNT = (int)MemoryCategory::Count;
+	const char * CATEGORY_NAMES[CATEGORY_COUNT] = { "geometry", "octrees", "textures", "caches", "framebuffer", "other" };
+
+	struct AssetUsage
+	{
+		std::string name;
+		size_t bytes[CATEGORY_COUNT];
+		size_t peakBytes;
+	};
+
+	std::mutex trackerMutex;
+	//Asset zero collects everything allocated outside of an asset scope
+	std::vector<AssetUsage> assets(1, AssetUsage{ "(no asset)", {}, 0 });
+	std::unordered_map<std::string, uint32_t> assetRegistry;
+	std::vector<MemoryReclaimer *> reclaimers;
+	size_t categoryBytes[CATEGORY_COUNT] = {};
+	size_t categoryPeakBytes[CATEGORY_COUNT] = {};
+	size_t peakBytes = 0;
+	std::atomic<size_t> totalBytes(0);
+	std::atomic<size_t> budget(0);
+
+	thread_local uint32_t currentAsset = 0;
+
+	//Asks the reclaimers to free the bytes, called without holding the tracker lock since reclaimers release memory through the tracker
+	void reclaim(size_t bytes)
+	{
+		std::vector<MemoryReclaimer *> currentReclaimers;
+		{
+			std::lock_guard<std::mutex> lock(trackerMutex);
+			currentReclaimers = reclaimers;
+		}
+		size_t freed = 0;
+		for (MemoryReclaimer * reclaimer : currentReclaimers)
+		{
+			if (freed >= bytes)
+			{
+				break;
+			}
+			freed += reclaimer->reclaimMemory(bytes - freed);
+		}
+	}
+}
+
+MemoryTracker::AssetScope::AssetScope(const std::string & name) : previousAsset(currentAsset)
+{
+	std::lock_guard<std::mutex> lock(trackerMutex);
+	auto entry = assetRegistry.find(name);
+	if (entry == assetRegistry.end())
+	{
+		assets.push_back(AssetUsage{ name, {}, 0 });
+		entry = assetRegistry.emplace(name, assets.size() - 1).first;
+	}
+	currentAsset = entry->second;
+}
+
+MemoryTracker::AssetScope::~AssetScope()
+{
+	currentAsset = this->previousAsset;
+}
+
+void MemoryTracker::setBudget(size_t bytes)
+{
+	budget = bytes;
+}
+
+size_t MemoryTracker::getBudget()
+{
+	return budget;
+}
+
+size_t MemoryTracker::getAvailableBytes()
+{
+	size_t limit = budget;
+	if (limit == 0)
+	{
+		return SIZE_MAX;
+	}
+	size_t used = totalBytes;
+	return used < limit ? limit - used : 0;
+}
+
+uint32_t MemoryTracker::getCurrentAsset()
+{
+	return currentAsset;
+}
+
+void MemoryTracker::allocated(MemoryCategory category, uint32_t asset, size_t bytes)
+{
+	if (category != MemoryCategory::Caches && getAvailableBytes() < bytes)
+	{
+		reclaim(bytes - getAvailableBytes());
+		if (getAvailableBytes() < bytes)
+		{
+			std::string assetName;
+			{
+				std::lock_guard<std::mutex> lock(trackerMutex);
+				assetName = assets[asset].name;
+			}
+			printf("(ERROR) Memory budget of %.1f MB exceeded allocating %.1f KB of %s for %s\n", budget / (1024.0 * 1024.0), bytes / 1024.0, CATEGORY_NAMES[(int)category], assetName.c_str());
+			printReport();
+			fflush(stdout);
+			std::exit(EXIT_FAILURE);
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(trackerMutex);
+	size_t total = totalBytes += bytes;
+	peakBytes = std::max(peakBytes, total);
+	categoryBytes[(int)category] += bytes;
+	categoryPeakBytes[(int)category] = std::max(categoryPeakBytes[(int)category], categoryBytes[(int)category]);
+	AssetUsage & usage = assets[asset];
+	usage.bytes[(int)category] += bytes;
+	size_t assetTotal = 0;
+	for (int i = 0; i < CATEGORY_COUNT; i++)
+	{
+		assetTotal += usage.bytes[i];
+	}
+	usage.peakBytes = std::max(usage.peakBytes, assetTotal);
+}
+
+void MemoryTracker::released(MemoryCategory category, uint32_t asset, size_t bytes)
+{
+	std::lock_guard<std::mutex> lock(trackerMutex);
+	totalBytes -= bytes;
+	categoryBytes[(int)category] -= bytes;
+	assets[asset].bytes[(int)category] -= bytes;
+}
+
+void MemoryTracker::addReclaimer(MemoryReclaimer * reclaimer)
+{
+	std::lock_guard<std::mutex> lock(trackerMutex);
+	reclaimers.push_back(reclaimer);
+}
+
+void MemoryTracker::removeReclaimer(MemoryReclaimer * reclaimer)
+{
+	std::lock_guard<std::mutex> lock(trackerMutex);
+	reclaimers.erase(std::remove(reclaimers.begin(), reclaimers.end(), reclaimer), reclaimers.end());
+}
+
+void MemoryTracker::printReport()
+{
+	std::lock_guard<std::mutex> lock(trackerMutex);
+	size_t limit = budget;
+	if (limit > 0)
+	{
+		printf("Memory: %.1f KB in use, %.1f KB at peak, %.1f KB budget\n", totalBytes / 1024.0, peakBytes / 1024.0, limit / 1024.0);
+	}
+	else
+	{
+		printf("Memory: %.1f KB in use, %.1f KB at peak\n", totalBytes / 1024.0, peakBytes / 1024.0);
+	}
+	for (int i = 0; i < CATEGORY_COUNT; i++)
+	{
+		printf("  %-12s %10.1f KB in use %10.1f KB at peak\n", CATEGORY_NAMES[i], categoryBytes[i] / 1024.0, categoryPeakBytes[i] / 1024.0);
+	}
+	for (const AssetUsage & usage : assets)
+	{
+		if (usage.peakBytes == 0)
+		{
+			continue;
+		}
+		printf("  %s: %.1f KB at peak,", usage.name.c_str(), usage.peakBytes / 1024.0);
+		for (int i = 0; i < CATEGORY_COUNT; i++)
+		{
+			if (usage.bytes[i] > 0)
+			{
+				printf(" %s %.1f KB", CATEGORY_NAMES[i], usage.bytes[i] / 1024.0);
+			}
+		}
+		printf("\n");
+	}
+}
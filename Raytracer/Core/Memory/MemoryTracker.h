@@ -0,0 +1,65 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+//Subsystems memory is accounted to
+enum class MemoryCategory
+{
+	Geometry,
+	Octrees,
+	Textures,
+	//Pages and clusters held by the texture and geometry caches, these can be evicted to make room
+	Caches,
+	Framebuffer,
+	Other,
+	Count
+};
+
+//Anything holding memory it can give back when the budget runs out, such as the least recently used pages of a cache
+class MemoryReclaimer
+{
+public:
+	virtual ~MemoryReclaimer() {}
+
+	//Frees at least the given number of bytes if it can, returns the number of bytes freed
+	virtual size_t reclaimMemory(size_t bytes) = 0;
+};
+
+//Accounts the bytes held by each subsystem and each asset, and optionally enforces a hard budget on the whole render
+//Bytes are charged to the asset of the thread that allocates them, set with an AssetScope while the asset is loading
+//Allocations that would go over the budget first make the reclaimers evict, and if that is not enough the render stops with an error
+//Cache allocations never stop the render, the caches evict their own pages to stay under the budget instead
+class MemoryTracker
+{
+public:
+	//Charges allocations made by this thread to the named asset while it exists
+	class AssetScope
+	{
+	public:
+		AssetScope(const std::string & name);
+		~AssetScope();
+
+	private:
+		uint32_t previousAsset;
+	};
+
+	//A budget of zero means no budget
+	static void setBudget(size_t bytes);
+	static size_t getBudget();
+	//Bytes left under the budget, or SIZE_MAX if there is no budget
+	static size_t getAvailableBytes();
+
+	//Asset allocations made on this thread are currently charged to, zero when there is no asset
+	static uint32_t getCurrentAsset();
+
+	static void allocated(MemoryCategory category, uint32_t asset, size_t bytes);
+	static void released(MemoryCategory category, uint32_t asset, size_t bytes);
+
+	static void addReclaimer(MemoryReclaimer * reclaimer);
+	static void removeReclaimer(MemoryReclaimer * reclaimer);
+
+	//Prints the current and peak bytes of every subsystem and the bytes of every asset
+	static void printReport();
+};
\ No newline at end of file
@@ -0,0 +1,129 @@
+#include "TlbCounter.h"
+
+#include <cstdio>
+#include <initializer_list>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cstring>
+
+namespace
+{
+	int openCounter(uint64_t result)
+	{
+		perf_event_attr attributes;
+		std::memset(&attributes, 0, sizeof(attributes));
+		attributes.type = PERF_TYPE_HW_CACHE;
+		attributes.size = sizeof(attributes);
+		attributes.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (result << 16);
+		attributes.disabled = 1;
+		attributes.inherit = 1;
+		attributes.exclude_kernel = 1;
+		attributes.exclude_hv = 1;
+		return (int)syscall(__NR_perf_event_open, &attributes, 0, -1, -1, 0);
+	}
+
+	uint64_t readCounter(int descriptor)
+	{
+		uint64_t value = 0;
+		if (descriptor < 0 || read(descriptor, &value, sizeof(value)) != sizeof(value))
+		{
+			return 0;
+		}
+		return value;
+	}
+}
+
+TlbCounter::TlbCounter() : misses(0), accesses(0)
+{
+	this->missDescriptor = openCounter(PERF_COUNT_HW_CACHE_RESULT_MISS);
+	//Not every CPU counts dTLB accesses, the misses are still reported without a rate
+	this->accessDescriptor = this->missDescriptor >= 0 ? openCounter(PERF_COUNT_HW_CACHE_RESULT_ACCESS) : -1;
+}
+
+TlbCounter::~TlbCounter()
+{
+	if (this->missDescriptor >= 0)
+	{
+		close(this->missDescriptor);
+	}
+	if (this->accessDescriptor >= 0)
+	{
+		close(this->accessDescriptor);
+	}
+}
+
+void TlbCounter::start()
+{
+	for (int descriptor : { this->missDescriptor, this->accessDescriptor })
+	{
+		if (descriptor >= 0)
+		{
+			ioctl(descriptor, PERF_EVENT_IOC_RESET, 0);
+			ioctl(descriptor, PERF_EVENT_IOC_ENABLE, 0);
+		}
+	}
+}
+
+void TlbCounter::stop()
+{
+	for (int descriptor : { this->missDescriptor, this->accessDescriptor })
+	{
+		if (descriptor >= 0)
+		{
+			ioctl(descriptor, PERF_EVENT_IOC_DISABLE, 0);
+		}
+	}
+	this->misses = readCounter(this->missDescriptor);
+	this->accesses = readCounter(this->accessDescriptor);
+}
+#else
+TlbCounter::TlbCounter() : missDescriptor(-1), accessDescriptor(-1), misses(0), accesses(0)
+{
+}
+
+TlbCounter::~TlbCounter()
+{
+}
+
+void TlbCounter::start()
+{
+}
+
+void TlbCounter::stop()
+{
+}
+#endif
+
+bool TlbCounter::isAvailable() const
+{
+	return this->missDescriptor >= 0;
+}
+
+uint64_t TlbCounter::getMisses() const
+{
+	return this->misses;
+}
+
+uint64_t TlbCounter::getAccesses() const
+{
+	return this->accesses;
+}
+
+void TlbCounter::printStatistics(const char * label) const
+{
+	if (!isAvailable())
+	{
+		printf("%s: dTLB counters are not available\n", label);
+		return;
+	}
+	if (this->accessDescriptor < 0 || this->accesses == 0)
+	{
+		printf("%s: %llu dTLB load misses\n", label, (unsigned long long)this->misses);
+		return;
+	}
+	printf("%s: %llu dTLB load misses in %llu loads (%.3f%% miss rate)\n", label, (unsigned long long)this->misses, (unsigned long long)this->accesses, 100.0 * this->misses / this->accesses);
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+
+//Counts data TLB misses and accesses with the hardware performance counters of the CPU, for the thread that starts it and the threads it creates after
+//Counters are only read on Linux through perf events, elsewhere or when the kernel does not allow access the counter reports itself as unavailable
+class TlbCounter
+{
+public:
+	TlbCounter();
+	~TlbCounter();
+
+	TlbCounter(const TlbCounter &) = delete;
+	TlbCounter & operator=(const TlbCounter &) = delete;
+
+	bool isAvailable() const;
+
+	void start();
+	void stop();
+
+	uint64_t getMisses() const;
+	uint64_t getAccesses() const;
+	//Prints the misses and the miss rate, or why they could not be counted
+	void printStatistics(const char * label) const;
+
+private:
+	int missDescriptor;
+	int accessDescriptor;
+	uint64_t misses;
+	uint64_t accesses;
+};
\ No newline at end of file
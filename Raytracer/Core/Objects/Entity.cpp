@@ -3,6 +3,7 @@
 #include "Models/Model.h"
 #include "Models/Mesh.h"
 #include "../Renderer/Materials/Material.h"
+#include "../Renderer/Materials/PhongMaterial.h"
 #include "../Math/MathFunctions.h"
 #include "../Geometry/AABB.h"
 #include "../Renderer/Ray.h"
@@ -10,12 +11,158 @@
 
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtx/norm.hpp>
+#include <glm/common.hpp>
 
-Entity::Entity(glm::vec3 pos, float s, Model * m, Material * material) : Object(pos, material), scale(s), model(m), pitchRotation(0.0f), yawRotation(0.0f), rollRotation(0.0f)
+#include <algorithm>
+
+//Loading models are all drawn in the same flat grey so the stand ins are easy to tell apart from loaded models
+static PhongMaterial proxyMaterial(glm::vec3(0.5f, 0.5f, 0.5f), 1.0f, 0.0f, 0.0f);
+
+bool Entity::lodSelection = false;
+float Entity::lodThreshold = 1.0f;
+uint32_t Entity::lodSecondaryBias = 0;
+
+Entity::Entity(glm::vec3 pos, float s, Model * m, Material * material) : Object(pos, material), model(m), hasProxyBounds(false), scale(s), yawRotation(0.0f), pitchRotation(0.0f), rollRotation(0.0f)
 {
 	this->calculateTransformationMatrices();
 }
 
+Entity::Entity(glm::vec3 pos, float s, std::shared_future<Model*> pendingModel, Material * material) : Object(pos, material), model(nullptr), pendingModel(pendingModel), hasProxyBounds(false), scale(s), yawRotation(0.0f), pitchRotation(0.0f), rollRotation(0.0f)
+{
+	this->calculateTransformationMatrices();
+}
+
+void Entity::setProxyBounds(const glm::vec3 & minPoint, const glm::vec3 & maxPoint)
+{
+	//The bounds are grown a little so rounding can not leave the bounding box of the loaded model poking out of them
+	glm::vec3 margin = (maxPoint - minPoint) * 0.001f + MathFunctions::EPSILON;
+	this->proxyMin = minPoint - margin;
+	this->proxyMax = maxPoint + margin;
+	this->hasProxyBounds = true;
+}
+
+void Entity::addKeyframe(float time, const glm::vec3 & position, float pitch, float yaw, float roll, float scale)
+{
+	Keyframe keyframe;
+	keyframe.time = time;
+	keyframe.position = position;
+	keyframe.pitch = pitch;
+	keyframe.yaw = yaw;
+	keyframe.roll = roll;
+	keyframe.scale = scale;
+	//Keyframes are kept sorted by time so setTime can search them
+	auto next = std::upper_bound(this->keyframes.begin(), this->keyframes.end(), time, [](float keyTime, const Keyframe & other) { return keyTime < other.time; });
+	this->keyframes.insert(next, keyframe);
+}
+
+bool Entity::isAnimated() const
+{
+	return !this->keyframes.empty();
+}
+
+void Entity::setTime(float time)
+{
+	if (this->keyframes.empty())
+	{
+		return;
+	}
+	setPose(getPoseAtTime(time));
+}
+
+Entity::Keyframe Entity::getPoseAtTime(float time) const
+{
+	auto next = std::upper_bound(this->keyframes.begin(), this->keyframes.end(), time, [](float keyTime, const Keyframe & other) { return keyTime < other.time; });
+	const Keyframe & after = next == this->keyframes.end() ? this->keyframes.back() : *next;
+	const Keyframe & before = next == this->keyframes.begin() ? this->keyframes.front() : *(next - 1);
+	float blend = after.time > before.time ? (time - before.time) / (after.time - before.time) : 0.0f;
+
+	Keyframe pose;
+	pose.time = time;
+	pose.position = glm::mix(before.position, after.position, blend);
+	pose.pitch = glm::mix(before.pitch, after.pitch, blend);
+	pose.yaw = glm::mix(before.yaw, after.yaw, blend);
+	pose.roll = glm::mix(before.roll, after.roll, blend);
+	pose.scale = glm::mix(before.scale, after.scale, blend);
+	return pose;
+}
+
+void Entity::setPose(const Keyframe & pose)
+{
+	this->position = pose.position;
+	this->pitchRotation = pose.pitch;
+	this->yawRotation = pose.yaw;
+	this->rollRotation = pose.roll;
+	this->scale = pose.scale;
+	this->calculateTransformationMatrices();
+}
+
+Model * Entity::getModel()
+{
+	return this->model;
+}
+
+const glm::mat4 & Entity::getLocalToWorldMatrix() const
+{
+	return this->localToWorldMatrix;
+}
+
+bool Entity::getBounds(glm::vec3 & minPoint, glm::vec3 & maxPoint)
+{
+	return getBounds(this->localToWorldMatrix, minPoint, maxPoint);
+}
+
+bool Entity::getBounds(const Keyframe & pose, glm::vec3 & minPoint, glm::vec3 & maxPoint)
+{
+	return getBounds(calculateLocalToWorldMatrix(pose.position, pose.pitch, pose.yaw, pose.roll, pose.scale), minPoint, maxPoint);
+}
+
+bool Entity::getBounds(const glm::mat4 & localToWorld, glm::vec3 & minPoint, glm::vec3 & maxPoint)
+{
+	glm::vec3 localMin = this->proxyMin;
+	glm::vec3 localMax = this->proxyMax;
+	if (this->model)
+	{
+		AABB * boundingBox = this->model->getModelBoundingBox() ? this->model->getModelBoundingBox() : this->model->getMeshList()[0]->getBoundingBox();
+		localMin = boundingBox->getMinAsPoint();
+		localMax = boundingBox->getMaxAsPoint();
+	}
+	else if (!this->hasProxyBounds)
+	{
+		return false;
+	}
+
+	//The corners of the local bounds are moved into world space and boxed again
+	minPoint = glm::vec3(MathFunctions::T_INFINITY);
+	maxPoint = glm::vec3(-MathFunctions::T_INFINITY);
+	for (uint32_t corner = 0; corner < 8; corner++)
+	{
+		glm::vec3 point((corner & 1) ? localMax.x : localMin.x, (corner & 2) ? localMax.y : localMin.y, (corner & 4) ? localMax.z : localMin.z);
+		glm::vec3 worldPoint = localToWorld * glm::vec4(point, 1.0f);
+		minPoint = glm::min(minPoint, worldPoint);
+		maxPoint = glm::max(maxPoint, worldPoint);
+	}
+	return true;
+}
+
+bool Entity::isLoading()
+{
+	return this->model == nullptr;
+}
+
+bool Entity::finishLoading(bool wait)
+{
+	if (this->model)
+	{
+		return true;
+	}
+	if (!wait && this->pendingModel.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+	{
+		return false;
+	}
+	this->model = this->pendingModel.get();
+	return true;
+}
+
 void Entity::setRotation(float pitch, float yaw, float roll)
 {
 	this->pitchRotation = pitch;
@@ -26,56 +173,97 @@ void Entity::setRotation(float pitch, float yaw, float roll)
 
 bool Entity::possibleIntersection(const Ray & ray, float & parameter)
 {
-	Ray localRay = Ray::convertToNewSpace(ray, this->worldToLocalMatrix);
-	if (this->model->getModelBoundingBox())
+	//Without proxy bounds a loading model could be anywhere, so every ray has to be treated as possibly hitting it
+	if (!this->model && !this->hasProxyBounds)
 	{
-		if (this->model->getModelBoundingBox()->intersect(localRay, parameter))
-		{
-			parameter = convertLocalParameterToWorldParameter(localRay, parameter, ray);
-			return true;
-		}
+		parameter = 0.0f;
+		return true;
+	}
+
+	Ray localRay = this->worldSpace ? ray : Ray::convertToNewSpace(ray, this->worldToLocalMatrix);
+	glm::vec3 minPoint = this->proxyMin;
+	glm::vec3 maxPoint = this->proxyMax;
+	if (this->model)
+	{
+		AABB * boundingBox = this->model->getModelBoundingBox() ? this->model->getModelBoundingBox() : this->model->getMeshList()[0]->getBoundingBox();
+		minPoint = boundingBox->getMinAsPoint();
+		maxPoint = boundingBox->getMaxAsPoint();
+	}
+
+	if (!AABB::intersectBounds(minPoint, maxPoint, localRay, parameter))
+	{
+		return false;
+	}
+	//A ray starting inside the bounds can hit the model right away, the renderer relies on the parameter never being past the nearest hit
+	if (AABB::containsPoint(minPoint, maxPoint, localRay.getOrigin()))
+	{
+		parameter = 0.0f;
 	}
 	else
 	{
-		if (this->model->getMeshList()[0]->boundingOctree->root->boundingBox->intersect(localRay, parameter))
-		{
-			parameter = convertLocalParameterToWorldParameter(localRay, parameter, ray);
-			return true;
-		}
+		parameter = convertLocalParameterToWorldParameter(localRay, parameter, ray);
 	}
-	return false;
+	return true;
 }
 
 bool Entity::intersect(const Ray & ray, float & parameter, IntersectionData & intersectionData)
 {
-	Ray localRay = Ray::convertToNewSpace(ray, this->worldToLocalMatrix);
+	//A loading model is hit wherever its proxy bounds are hit
+	if (!this->model)
+	{
+		return this->hasProxyBounds && possibleIntersection(ray, parameter);
+	}
+
+	Ray localRay = this->worldSpace ? ray : Ray::convertToNewSpace(ray, this->worldToLocalMatrix);
 
 	//Check to make sure the model bounding box exists
 	if (model->getModelBoundingBox())
 	{
 		//Check if the ray intersects with the models bounding box to see if there could be an intersection
 		float t = MathFunctions::T_INFINITY;
-		if (model->getModelBoundingBox()->intersect(localRay, t))
+		if (!model->getModelBoundingBox()->intersect(localRay, t))
 		{
 			return false;
 		}
 	}
 
-	for (uint32_t j = 0; j < this->model->getMeshList().size(); j++)
+	const std::vector<MeshInstance> & instanceList = this->model->getInstanceList();
+	for (uint32_t j = 0; j < instanceList.size(); j++)
 	{
-		Mesh * mesh = this->model->getMeshList()[j];
-
+		const MeshInstance & instance = instanceList[j];
+		Mesh * mesh = this->model->getMeshList()[instance.meshIndex];
 
 		//Check to make sure that the ray intersects with the mesh's bounding box
 		float t = MathFunctions::T_INFINITY;
-		Face * intersectedFace = nullptr;
-		if (mesh->intersectMesh(localRay, t, intersectedFace) && t < parameter)
+		uint32_t intersectedFace = 0;
+		uint32_t lodLevel = 0;
+		bool hit;
+		if (instance.identity)
+		{
+			lodLevel = selectLod(ray, localRay, mesh);
+			hit = mesh->getLod(lodLevel)->intersectMesh(localRay, t, intersectedFace);
+		}
+		else
+		{
+			//Shared meshes are intersected in their own space and the hit is brought back to a parameter along the local ray
+			Ray meshRay = Ray::convertToNewSpace(localRay, instance.modelToMeshMatrix);
+			lodLevel = selectLod(ray, meshRay, mesh);
+			hit = mesh->getLod(lodLevel)->intersectMesh(meshRay, t, intersectedFace);
+			if (hit)
+			{
+				glm::vec3 modelIntersection = instance.meshToModelMatrix * glm::vec4(meshRay.getOrigin() + meshRay.getDirectionVector() * t, 1.0f);
+				t = glm::dot(modelIntersection - localRay.getOrigin(), localRay.getDirectionVector());
+			}
+		}
+
+		if (hit && t < parameter)
 		{
 			parameter = t;
 			//Capture the index number of the triangle for use in normal calculation later
-			intersectionData.face = intersectedFace;
-			//Capture the index of the mesh for use in calculations later
-			intersectionData.meshIndex = j;
+			intersectionData.faceIndex = intersectedFace;
+			//Capture the index of the instance for use in calculations later
+			intersectionData.instanceIndex = j;
+			intersectionData.lodLevel = lodLevel;
 		}
 	}
 
@@ -91,13 +279,24 @@ bool Entity::intersect(const Ray & ray, float & parameter, IntersectionData & in
 
 void Entity::getSurfaceData(const glm::vec3 & intersectionPoint, const IntersectionData & intersectionData, glm::vec3 & normal, glm::vec2 & textureCoords, Material *& material)
 {
-	//Get the current mesh intersected from the index provided by the intersection data
-	Mesh * mesh = this->model->getMeshList()[intersectionData.meshIndex];
-	//Get the vertex data from the index provided by the intersection data
-	Face * face = intersectionData.face;
+	if (!this->model)
+	{
+		glm::vec3 localPoint = this->worldToLocalMatrix * glm::vec4(intersectionPoint, 1.0f);
+		normal = glm::normalize(glm::transpose(glm::mat3(this->worldToLocalMatrix)) * getProxyNormal(localPoint));
+		textureCoords = glm::vec2(0, 0);
+		material = &proxyMaterial;
+		return;
+	}
 
-	//Convert the intersection point to local coordinates so that per mesh data can be used
-	glm::vec3 localIntersectionPoint = this->worldToLocalMatrix * glm::vec4(intersectionPoint, 1.0f);
+	//Get the current mesh intersected from the instance and level of detail provided by the intersection data
+	const MeshInstance & instance = this->model->getInstanceList()[intersectionData.instanceIndex];
+	Mesh * mesh = this->model->getMeshList()[instance.meshIndex]->getLod(intersectionData.lodLevel);
+	//Get the vertex data of the face provided by the intersection data
+	FaceAttributes face;
+	mesh->getFaceAttributes(intersectionData.faceIndex, face, true);
+
+	//Convert the intersection point to the coordinates of the mesh so that per mesh data can be used
+	glm::vec3 localIntersectionPoint = this->convertWorldPointToMeshSpace(intersectionPoint, instance);
 
 	//If the underlaying Entity has a material, override all other mesh specific materials with this material
 	if (this->getMaterial())
@@ -106,35 +305,38 @@ void Entity::getSurfaceData(const glm::vec3 & intersectionPoint, const Intersect
 	}
 	else
 	{
-		material = face->material;
+		material = face.material;
 	}
 
 	glm::vec3 localNormal;
-	if (mesh->normals.size() > 0)
+	if (mesh->hasNormals())
 	{
 		if (material->isSmoothShading())
 		{
-			localNormal = this->getSmoothNormal(localIntersectionPoint, face, intersectionData.meshIndex);
+			localNormal = this->getSmoothNormal(localIntersectionPoint, face);
 		}
 		else
 		{
-			localNormal = (mesh->normals[face->indices[0]] + mesh->normals[face->indices[1]] + mesh->normals[face->indices[2]]) / 3.0f;
+			localNormal = (face.normals[0] + face.normals[1] + face.normals[2]) / 3.0f;
 		}
 	}
 	else
 	{
-		glm::vec3 vertex1 = mesh->vertices[face->indices[0]];
-		glm::vec3 vertex2 = mesh->vertices[face->indices[1]];
-		glm::vec3 vertex3 = mesh->vertices[face->indices[2]];
 		//Calculate the normal by taking the cross product of the difference of the vertices
-		localNormal = glm::cross(vertex2 - vertex1, vertex3 - vertex1);
+		localNormal = glm::cross(face.vertices[1] - face.vertices[0], face.vertices[2] - face.vertices[0]);
+	}
+
+	//Normals leave the space of the mesh through the inverse transpose of the instance transform so they stay perpendicular under non uniform scaling
+	if (!instance.identity)
+	{
+		localNormal = glm::transpose(glm::mat3(instance.modelToMeshMatrix)) * localNormal;
 	}
 
 	normal = glm::normalize(localToWorldMatrix * glm::vec4(localNormal, 0.0f));
 
-	if (mesh->textureCoords.size() > 0)
+	if (mesh->hasTextureCoords())
 	{
-		textureCoords = calculateUVCoordinatesAtIntersection(localIntersectionPoint, face, intersectionData.meshIndex);
+		textureCoords = calculateUVCoordinatesAtIntersection(localIntersectionPoint, face);
 	}
 	else
 	{
@@ -142,8 +344,42 @@ void Entity::getSurfaceData(const glm::vec3 & intersectionPoint, const Intersect
 	}
 }
 
+glm::vec2 Entity::getTextureCoordinates(const glm::vec3 & point, const IntersectionData & intersectionData)
+{
+	if (!this->model)
+	{
+		return glm::vec2(0, 0);
+	}
+	const MeshInstance & instance = this->model->getInstanceList()[intersectionData.instanceIndex];
+	Mesh * mesh = this->model->getMeshList()[instance.meshIndex]->getLod(intersectionData.lodLevel);
+	if (!mesh->hasTextureCoords())
+	{
+		return glm::vec2(0, 0);
+	}
+
+	//Convert the point to the coordinates of the mesh so that per mesh data can be used
+	glm::vec3 localPoint = this->convertWorldPointToMeshSpace(point, instance);
+	FaceAttributes face;
+	mesh->getFaceAttributes(intersectionData.faceIndex, face, false);
+	return calculateUVCoordinatesAtIntersection(localPoint, face);
+}
+
+glm::vec3 Entity::convertWorldPointToMeshSpace(const glm::vec3 & point, const MeshInstance & instance)
+{
+	glm::vec3 localPoint = this->worldToLocalMatrix * glm::vec4(point, 1.0f);
+	if (instance.identity)
+	{
+		return localPoint;
+	}
+	return instance.modelToMeshMatrix * glm::vec4(localPoint, 1.0f);
+}
+
 float Entity::convertLocalParameterToWorldParameter(const Ray & localRay, float localParameter, const Ray & worldRay)
 {
+	if (this->worldSpace)
+	{
+		return localParameter;
+	}
 	glm::vec3 localIntersection = localRay.getOrigin() + localRay.getDirectionVector() * localParameter;
 	glm::vec3 globalIntersection = this->localToWorldMatrix * glm::vec4(localIntersection, 1.0f);
 	if (!ARE_FLOATS_EQUAL(worldRay.getDirectionVector().x, 0.0f))
@@ -162,69 +398,128 @@ float Entity::convertLocalParameterToWorldParameter(const Ray & localRay, float
 	}
 }
 
-glm::vec3 Entity::getSmoothNormal(const glm::vec3 & intersectionPoint, const Face * face, const uint32_t & meshIndex)
+glm::vec3 Entity::getSmoothNormal(const glm::vec3 & intersectionPoint, const FaceAttributes & face)
 {
-	Mesh * mesh = this->model->getMeshList()[meshIndex];
-
-	glm::vec3 barycentricCoords = getBarycentricCoordinatesAtIntersection(intersectionPoint, face, meshIndex);
+	glm::vec3 barycentricCoords = getBarycentricCoordinatesAtIntersection(intersectionPoint, face);
 
-	glm::vec3 normal1 = mesh->normals[face->indices[0]];
-	glm::vec3 normal2 = mesh->normals[face->indices[1]];
-	glm::vec3 normal3 = mesh->normals[face->indices[2]];
-	return normal1 * barycentricCoords.x + normal2 * barycentricCoords.y + normal3 * barycentricCoords.z;
+	return face.normals[0] * barycentricCoords.x + face.normals[1] * barycentricCoords.y + face.normals[2] * barycentricCoords.z;
 }
 
-glm::vec3 Entity::getBarycentricCoordinatesAtIntersection(const glm::vec3 & intersectionPoint, const Face * face, const uint32_t & meshIndex)
+glm::vec3 Entity::getBarycentricCoordinatesAtIntersection(const glm::vec3 & intersectionPoint, const FaceAttributes & face)
 {
-	Mesh * mesh = this->model->getMeshList()[meshIndex];
-
 	//Get the vertex positions for each vertex in the face
-	glm::vec3 vertex1 = mesh->vertices[face->indices[0]];
-	glm::vec3 vertex2 = mesh->vertices[face->indices[1]];
-	glm::vec3 vertex3 = mesh->vertices[face->indices[2]];
+	const glm::vec3 & vertex1 = face.vertices[0];
+	const glm::vec3 & vertex2 = face.vertices[1];
+	const glm::vec3 & vertex3 = face.vertices[2];
 
 	//Calculate the vectors from each vertex to the intersection point
 	glm::vec3 v1ToPointVector = vertex1 - intersectionPoint;
 	glm::vec3 v2ToPointVector = vertex2 - intersectionPoint;
 	glm::vec3 v3ToPointVector = vertex3 - intersectionPoint;
 
+	//The sub triangle areas are signed by projecting onto the face normal, so points outside the triangle give extrapolated coordinates
+	glm::vec3 faceNormal = glm::cross(vertex2 - vertex1, vertex3 - vertex1);
 	//Calculates the area of the triangle
-	float inverseArea = 1 / glm::length(glm::cross(vertex1 - vertex2, vertex1 - vertex3));
+	float inverseArea = 1 / glm::dot(faceNormal, faceNormal);
 	//Calculate the ratio that each of the sub triangles areas take up
-	float area1Ratio = glm::length(glm::cross(v2ToPointVector, v3ToPointVector)) * inverseArea;
-	float area2Ratio = glm::length(glm::cross(v3ToPointVector, v1ToPointVector)) * inverseArea;
-	float area3Ratio = glm::length(glm::cross(v1ToPointVector, v2ToPointVector)) * inverseArea;
+	float area1Ratio = glm::dot(glm::cross(v2ToPointVector, v3ToPointVector), faceNormal) * inverseArea;
+	float area2Ratio = glm::dot(glm::cross(v3ToPointVector, v1ToPointVector), faceNormal) * inverseArea;
+	float area3Ratio = glm::dot(glm::cross(v1ToPointVector, v2ToPointVector), faceNormal) * inverseArea;
 
 	return glm::vec3(area1Ratio, area2Ratio, area3Ratio);
 }
 
-glm::vec2 Entity::calculateUVCoordinatesAtIntersection(const glm::vec3 & intersectionPoint, const Face * face, const uint32_t & meshIndex)
+glm::vec2 Entity::calculateUVCoordinatesAtIntersection(const glm::vec3 & intersectionPoint, const FaceAttributes & face)
 {
-	Mesh * mesh = this->model->getMeshList()[meshIndex];
-
-	glm::vec3 barycentricCoords = getBarycentricCoordinatesAtIntersection(intersectionPoint, face, meshIndex);
+	glm::vec3 barycentricCoords = getBarycentricCoordinatesAtIntersection(intersectionPoint, face);
 
 	//Get the UV coordinates at each of the vertices
-	glm::vec2 v1UVCoords = mesh->textureCoords[face->indices[0]];
-	glm::vec2 v2UVCoords = mesh->textureCoords[face->indices[1]];
-	glm::vec2 v3UVCoords = mesh->textureCoords[face->indices[2]];
+	const glm::vec2 & v1UVCoords = face.textureCoords[0];
+	const glm::vec2 & v2UVCoords = face.textureCoords[1];
+	const glm::vec2 & v3UVCoords = face.textureCoords[2];
 
 	//Interpolate each UV coordinate from the 3 vertices using the area ratios calculated from the subtriangles
 	return v1UVCoords * barycentricCoords.x + v2UVCoords * barycentricCoords.y + v3UVCoords * barycentricCoords.z;
 }
 
+void Entity::setLodSelection(bool enabled, float threshold, uint32_t secondaryBias)
+{
+	lodSelection = enabled;
+	lodThreshold = threshold;
+	lodSecondaryBias = secondaryBias;
+}
+
+uint32_t Entity::selectLod(const Ray & worldRay, const Ray & meshRay, Mesh * mesh)
+{
+	uint32_t levelCount = mesh->getLodCount();
+	if (!lodSelection || levelCount == 1)
+	{
+		return 0;
+	}
+
+	uint32_t level = 0;
+	if (worldRay.hasDifferentials())
+	{
+		//Rays that miss the bounds of the mesh miss every level, so they skip the rest of the selection
+		float distance = 0.0f;
+		if (!mesh->getBoundingBox()->intersect(meshRay, distance))
+		{
+			return 0;
+		}
+		//The footprint is the distance between the ray and the rays through the neighbouring pixels where the ray reaches the mesh
+		float worldDistance = std::max(distance, 0.0f) * this->scale;
+		float footprintX = glm::length(worldRay.getOriginDx() + worldRay.getDirectionDx() * worldDistance);
+		float footprintY = glm::length(worldRay.getOriginDy() + worldRay.getDirectionDy() * worldDistance);
+		float footprint = std::max(footprintX, footprintY) / this->scale * lodThreshold;
+		while (level + 1 < levelCount && mesh->getLodError(level + 1) <= footprint)
+		{
+			level++;
+		}
+	}
+	if (worldRay.getRayType() != Ray::Type::PRIMARY)
+	{
+		level = std::min(level + lodSecondaryBias, levelCount - 1);
+	}
+	return level;
+}
+
+glm::vec3 Entity::getProxyNormal(const glm::vec3 & localPoint)
+{
+	//The face of the proxy bounds that was hit is the one the point is furthest out towards relative to the size of the bounds
+	glm::vec3 center = (this->proxyMin + this->proxyMax) * 0.5f;
+	glm::vec3 offset = (localPoint - center) / glm::max(this->proxyMax - center, glm::vec3(MathFunctions::EPSILON));
+	glm::vec3 absoluteOffset = glm::abs(offset);
+	if (absoluteOffset.x >= absoluteOffset.y && absoluteOffset.x >= absoluteOffset.z)
+	{
+		return glm::vec3(offset.x < 0.0f ? -1.0f : 1.0f, 0.0f, 0.0f);
+	}
+	if (absoluteOffset.y >= absoluteOffset.z)
+	{
+		return glm::vec3(0.0f, offset.y < 0.0f ? -1.0f : 1.0f, 0.0f);
+	}
+	return glm::vec3(0.0f, 0.0f, offset.z < 0.0f ? -1.0f : 1.0f);
+}
+
 void Entity::calculateTransformationMatrices()
 {
-	//Create the local to world matrix by applying position transformation, rotational transformation, and scale transformation
-	this->localToWorldMatrix = glm::mat4(1.0f);
-	this->localToWorldMatrix = glm::translate(this->localToWorldMatrix, position);
-	this->localToWorldMatrix = glm::rotate(this->localToWorldMatrix, glm::radians(pitchRotation), glm::vec3(1, 0, 0));
-	this->localToWorldMatrix = glm::rotate(this->localToWorldMatrix, glm::radians(yawRotation), glm::vec3(0, 1, 0));
-	this->localToWorldMatrix = glm::rotate(this->localToWorldMatrix, glm::radians(rollRotation), glm::vec3(0, 0, 1));
-	this->localToWorldMatrix = glm::scale(this->localToWorldMatrix, glm::vec3(scale));
+	this->localToWorldMatrix = calculateLocalToWorldMatrix(position, pitchRotation, yawRotation, rollRotation, scale);
 
 	//Create the world to local matrix by applying the inverse of the local to world matrix
 	this->worldToLocalMatrix = glm::inverse(this->localToWorldMatrix);
+	//Entities that are not moved from the origin test rays as they are, without converting them into local space and back
+	this->worldSpace = this->localToWorldMatrix == glm::mat4(1.0f);
+}
+
+glm::mat4 Entity::calculateLocalToWorldMatrix(const glm::vec3 & position, float pitch, float yaw, float roll, float scale)
+{
+	//Create the local to world matrix by applying position transformation, rotational transformation, and scale transformation
+	glm::mat4 localToWorld = glm::mat4(1.0f);
+	localToWorld = glm::translate(localToWorld, position);
+	localToWorld = glm::rotate(localToWorld, glm::radians(pitch), glm::vec3(1, 0, 0));
+	localToWorld = glm::rotate(localToWorld, glm::radians(yaw), glm::vec3(0, 1, 0));
+	localToWorld = glm::rotate(localToWorld, glm::radians(roll), glm::vec3(0, 0, 1));
+	localToWorld = glm::scale(localToWorld, glm::vec3(scale));
+	return localToWorld;
 }
 
 AABB * Entity::calculateBoundingBox(const std::vector<glm::vec3> & pointList)
@@ -3,11 +3,13 @@
 #include "Object.h"
 
 #include <vector>
+#include <future>
 
 #include <glm/vec3.hpp>
 #include <glm/matrix.hpp>
 
-struct Face;
+struct MeshInstance;
+struct FaceAttributes;
 class Mesh;
 class Material;
 class Model;
@@ -16,9 +18,39 @@ class AABB;
 class Entity : public Object
 {
 public:
+	//Pose of an animated entity at a point in time, rotations are in degrees like setRotation
+	struct Keyframe
+	{
+		float time;
+		glm::vec3 position;
+		float pitch;
+		float yaw;
+		float roll;
+		float scale;
+	};
+
 	Entity(glm::vec3 pos, float s, Model * m, Material * material);
+	//Entity whose model is still loading, it is drawn as its proxy bounds until finishLoading sees the model is ready
+	Entity(glm::vec3 pos, float s, std::shared_future<Model*> pendingModel, Material * material);
+
+	//Bounds in the space of the model that the loading model is drawn as, they have to contain the whole model for the final image to be right
+	//An entity without proxy bounds is left out of the image until its model has loaded
+	void setProxyBounds(const glm::vec3 & minPoint, const glm::vec3 & maxPoint);
 
 	void setRotation(float pitch, float yaw, float roll);
+	//Keyframes can be added in any order, an entity with keyframes is moved by setTime and is never baked by SceneCompiler
+	void addKeyframe(float time, const glm::vec3 & position, float pitch, float yaw, float roll, float scale);
+	bool isAnimated() const;
+	//Moves the entity to its pose at the time, interpolating linearly between the keyframes around it and holding the first and last pose outside of them
+	//The scene BVH has to be refit afterwards, see Renderer::updateScene
+	void setTime(float time);
+	//The pose setTime would move the entity to, without moving it, so the next frame can be prepared while rays are traced through the current one
+	Keyframe getPoseAtTime(float time) const;
+	void setPose(const Keyframe & pose);
+
+	//Model of the entity, null while the model is still loading
+	Model * getModel();
+	const glm::mat4 & getLocalToWorldMatrix() const;
 
 	//This intersection test is meant to be a rough but fast intersection test to cull impossible intersections
 	bool possibleIntersection(const Ray & ray, float & parameter);
@@ -26,23 +58,51 @@ public:
 	bool intersect(const Ray & ray, float & parameter, IntersectionData & intersectionData);
 
 	void getSurfaceData(const glm::vec3 & intersectionPoint, const IntersectionData & intersectionData, glm::vec3 & normal, glm::vec2 & textureCoords, Material *& material);
+	glm::vec2 getTextureCoordinates(const glm::vec3 & point, const IntersectionData & intersectionData);
+
+	bool isLoading();
+	bool finishLoading(bool wait);
+	//The bounds of the model, or of the proxy while it is loading, turned into world space
+	bool getBounds(glm::vec3 & minPoint, glm::vec3 & maxPoint);
+	//The bounds the entity would have in the pose
+	bool getBounds(const Keyframe & pose, glm::vec3 & minPoint, glm::vec3 & maxPoint);
+
+	//Rays use the coarsest level of detail of each mesh whose error is below the footprint of the ray where it reaches the mesh, scaled by the threshold
+	//Secondary and shadow rays go the given number of levels coarser, shadow rays have no footprint so they start from the full mesh
+	static void setLodSelection(bool enabled, float threshold = 1.0f, uint32_t secondaryBias = 0);
 
 private:
+	static bool lodSelection;
+	static float lodThreshold;
+	static uint32_t lodSecondaryBias;
+
 	Model * model;
+	std::shared_future<Model*> pendingModel;
+	bool hasProxyBounds;
+	glm::vec3 proxyMin;
+	glm::vec3 proxyMax;
 
+	std::vector<Keyframe> keyframes;
 	float scale;
 	float yawRotation;
 	float pitchRotation;
 	float rollRotation;
 	glm::mat4 worldToLocalMatrix;
 	glm::mat4 localToWorldMatrix;
+	bool worldSpace;
 
 	float convertLocalParameterToWorldParameter(const Ray & localRay, float localParameter, const Ray & worldRay);
+	glm::vec3 convertWorldPointToMeshSpace(const glm::vec3 & point, const MeshInstance & instance);
+	glm::vec3 getProxyNormal(const glm::vec3 & localPoint);
+	//The mesh ray is the ray in the space of the mesh, which is taken to be scaled from world space by the scale of the entity
+	uint32_t selectLod(const Ray & worldRay, const Ray & meshRay, Mesh * mesh);
 
-	glm::vec3 getSmoothNormal(const glm::vec3 & intersectionPoint, const Face * face, const uint32_t & meshIndex);
-	glm::vec3 getBarycentricCoordinatesAtIntersection(const glm::vec3 & intersectionPoint, const Face * face, const uint32_t & meshIndex);
-	glm::vec2 calculateUVCoordinatesAtIntersection(const glm::vec3 & intersectionPoint, const Face * face, const uint32_t & meshIndex);
+	glm::vec3 getSmoothNormal(const glm::vec3 & intersectionPoint, const FaceAttributes & face);
+	glm::vec3 getBarycentricCoordinatesAtIntersection(const glm::vec3 & intersectionPoint, const FaceAttributes & face);
+	glm::vec2 calculateUVCoordinatesAtIntersection(const glm::vec3 & intersectionPoint, const FaceAttributes & face);
 
 	void calculateTransformationMatrices();
+	static glm::mat4 calculateLocalToWorldMatrix(const glm::vec3 & position, float pitch, float yaw, float roll, float scale);
+	bool getBounds(const glm::mat4 & localToWorld, glm::vec3 & minPoint, glm::vec3 & maxPoint);
 	AABB * calculateBoundingBox(const std::vector<glm::vec3> & pointList);
 };
\ No newline at end of file
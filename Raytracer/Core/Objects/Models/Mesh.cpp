@@ -2,12 +2,31 @@
 
 #include "../../Geometry/AABB.h"
 #include "../../DataStructures/Octree.h"
+#include "../../DataStructures/QuantizedOctree.h"
 #include "../../Math/MathFunctions.h"
 #include "../../Geometry/Triangle.h"
+#include "../../Assets/GeometryCache.h"
+#include "MeshSimplifier.h"
+#include "MeshOptimizer.h"
 
 #include <bitset>
+#include <algorithm>
+#include <iostream>
+#include <cmath>
 
-Mesh::Mesh() 
+#include <glm/packing.hpp>
+#include <glm/geometric.hpp>
+
+const uint32_t Mesh::OCTREE_MIN_OBJECTS = 4;
+const uint32_t Mesh::OCTREE_MAX_DEPTH = 5;
+const uint32_t Mesh::CLUSTER_SHIFT = 8;
+const uint32_t Mesh::STREAM_CLUSTER_SHIFT = 10;
+const uint32_t Mesh::LOD_BASE_RESOLUTION = 256;
+
+bool Mesh::countTriangleTests = false;
+std::atomic<uint64_t> Mesh::triangleTests(0);
+
+Mesh::Mesh() : boundingOctree(nullptr), quantizedOctree(nullptr), compacted(false), geometryCache(nullptr), streamedFaceCount(0), streamedNormals(false), streamedTextureCoords(false)
 {
 
 }
@@ -18,12 +37,25 @@ Mesh::~Mesh()
 	{
 		delete this->boundingOctree;
 	}
+
+	if (this->quantizedOctree)
+	{
+		delete this->quantizedOctree;
+	}
+
+	for (Mesh * lod : this->lods)
+	{
+		delete lod;
+	}
 }
 
-void Mesh::constructOctree()
+void Mesh::constructOctree(bool useArena, bool lazy)
 {
-	this->boundingOctree = new Octree<uint32_t>(4, 5);
-	AABB * meshBoundingBox = AABB::calculateBoundingBox(this->vertices);
+	this->boundingOctree = new Octree<uint32_t>(OCTREE_MIN_OBJECTS, OCTREE_MAX_DEPTH, useArena);
+	AABB * meshBoundingBox = AABB::calculateBoundingBox(this->vertices.data(), this->vertices.size());
+	glm::vec3 center = meshBoundingBox->getCenter();
+	glm::vec3 halfDistances = meshBoundingBox->getHalfDistances();
+	delete meshBoundingBox;
 
 	std::vector<uint32_t> triContents;
 	for (uint32_t i = 0; i < this->faces.size(); i++)
@@ -35,21 +67,44 @@ void Mesh::constructOctree()
 	if (this->faces.size() <= this->boundingOctree->getMinObjects())
 	{
 		//Generate the octree as just the root as a leaf node with all the faces in its list
-		LeafNode<uint32_t> * leafNode = new LeafNode<uint32_t>(meshBoundingBox);
-		leafNode->contents = std::vector<uint32_t>(triContents.begin(), triContents.end());
-		this->boundingOctree->root = leafNode;
+		this->boundingOctree->root = this->boundingOctree->createLeaf(center, halfDistances, triContents.data(), triContents.size());
+	}
+	//A lazy octree keeps all of the faces in its root until a ray first enters it
+	else if (lazy)
+	{
+		this->boundingOctree->root = this->boundingOctree->createPendingBranch(center, halfDistances, 1, triContents.data(), triContents.size());
 	}
 	//Otherwise generate all of the children recursively for the octree
 	else
 	{
-		this->boundingOctree->root = new BranchNode(meshBoundingBox);
+		BranchNode * root = this->boundingOctree->createBranch(center, halfDistances);
+		this->boundingOctree->root = root;
 		//Start generating children at a depth of 1
-		generateChildren(this->boundingOctree->root, triContents, 1);
+		generateChildren(root, triContents.data(), triContents.size(), 1, false);
 	}
 }
 
-bool Mesh::intersectMesh(const Ray & ray, float & parameter, Face *& intersectedFace)
+void Mesh::completeOctree()
 {
+	if (this->boundingOctree)
+	{
+		this->boundingOctree->buildAllPendingChildren(this->boundingOctree->root, [this](BranchNode * branch, const uint32_t * contents, uint32_t count, uint32_t depth)
+		{
+			generateChildren(branch, contents, count, depth, true);
+		});
+	}
+}
+
+bool Mesh::intersectMesh(const Ray & ray, float & parameter, uint32_t & intersectedFace)
+{
+	if (this->quantizedOctree)
+	{
+		return this->quantizedOctree->traverse(ray, parameter, [&](const uint32_t * faceIndices, uint32_t faceCount)
+		{
+			return intersectLeaf(ray, faceIndices, faceCount, parameter, intersectedFace);
+		});
+	}
+
 	std::list<OctreeNode*> intersectionsList;
 	float r = MathFunctions::T_INFINITY;
 	if (this->boundingOctree->root->boundingBox->intersect(ray, r))
@@ -58,12 +113,25 @@ bool Mesh::intersectMesh(const Ray & ray, float & parameter, Face *& intersected
 	}
 
 	//Continue working through the list until an intersection is found and breaks out of the loop
+	bool hit = false;
 	while(true)
 	{
 		//If the intersection list is empty, there is no intersection
 		if (intersectionsList.empty())
 		{
-			return false;
+			return hit;
+		}
+
+		//A face can reach out of its leaf, so after a hit the nodes the ray enters before that hit still have to be tested for a nearer one
+		if (hit)
+		{
+			AABB * boundingBox = intersectionsList.front()->boundingBox;
+			float entryParameter = MathFunctions::T_INFINITY;
+			boundingBox->intersect(ray, entryParameter);
+			if (!AABB::containsPoint(boundingBox->getMinAsPoint(), boundingBox->getMaxAsPoint(), ray.getOrigin()) && entryParameter >= parameter)
+			{
+				return true;
+			}
 		}
 
 		//If the first node in the list is a leaf node, check its contents for triangle intersection
@@ -71,37 +139,101 @@ bool Mesh::intersectMesh(const Ray & ray, float & parameter, Face *& intersected
 		{
 			LeafNode<uint32_t> * leafNode = (LeafNode<uint32_t> *)intersectionsList.front();
 			intersectionsList.pop_front();
-			for (uint32_t i = 0; i < leafNode->contents.size(); i++)
+			//Faces of the leaf only replace the hit if they are nearer
+			if (intersectLeaf(ray, leafNode->contents.data(), leafNode->contents.size(), parameter, intersectedFace))
 			{
-				Face * face = &this->faces[leafNode->contents[i]];
-				glm::vec3 vertex1 = this->vertices[face->indices[0]];
-				glm::vec3 vertex2 = this->vertices[face->indices[1]];
-				glm::vec3 vertex3 = this->vertices[face->indices[2]];
-
-				float rayParameter = MathFunctions::T_INFINITY;
-				//Check the triangle for intersection, do not accept an intersection if the rayParameter is zero because the intersection is with the same face and check it is the nearest intersection
-				if (Triangle::intersectTriangle(ray, vertex1, vertex2, vertex3, rayParameter) && !ARE_FLOATS_EQUAL(rayParameter, 0.0f) && rayParameter < parameter)
-				{
-					parameter = rayParameter;
-					intersectedFace = face;
-				}
+				hit = true;
 			}
+		}
+		else
+		{
+			//Expand the current list so that the list will empty or the until the first node is a leaf node, building the branches of a lazy octree as they are reached
+			this->boundingOctree->expandWithRayIntersection(ray, intersectionsList, [this](BranchNode * branch, const uint32_t * contents, uint32_t count, uint32_t depth)
+			{
+				generateChildren(branch, contents, count, depth, true);
+			});
+		}
+	}
+}
 
-			//If there is an intersection, stop executing the loop and return to the calling function
-			if (parameter != MathFunctions::T_INFINITY)
+bool Mesh::intersectLeaf(const Ray & ray, const uint32_t * faceIndices, uint32_t faceCount, float & parameter, uint32_t & intersectedFace)
+{
+	if (countTriangleTests)
+	{
+		triangleTests.fetch_add(faceCount, std::memory_order_relaxed);
+	}
+	//Faces of a leaf are in ascending order so the faces of a streamed mesh are tested one cluster at a time
+	std::shared_ptr<const GeometryCluster> cluster;
+	uint32_t clusterIndex = UINT32_MAX;
+	for (uint32_t i = 0; i < faceCount; i++)
+	{
+		glm::vec3 vertex1, vertex2, vertex3;
+		if (this->geometryCache)
+		{
+			if (faceIndices[i] >> STREAM_CLUSTER_SHIFT != clusterIndex)
 			{
-				return true;
+				clusterIndex = faceIndices[i] >> STREAM_CLUSTER_SHIFT;
+				cluster = getStreamedCluster(clusterIndex);
 			}
+			const CompactFace & face = cluster->faces[faceIndices[i] & ((1 << STREAM_CLUSTER_SHIFT) - 1)];
+			vertex1 = cluster->vertices[face.indices[0]];
+			vertex2 = cluster->vertices[face.indices[1]];
+			vertex3 = cluster->vertices[face.indices[2]];
 		}
 		else
 		{
-			//Expand the current list so that the list will empty or the until the first node is a leaf node
-			this->boundingOctree->expandWithRayIntersection(ray, intersectionsList);
+			uint32_t indices[3];
+			getFaceVertexIndices(faceIndices[i], indices);
+			vertex1 = this->vertices[indices[0]];
+			vertex2 = this->vertices[indices[1]];
+			vertex3 = this->vertices[indices[2]];
+		}
+
+		float rayParameter = MathFunctions::T_INFINITY;
+		//Check the triangle for intersection, do not accept an intersection if the rayParameter is zero because the intersection is with the same face and check it is the nearest intersection
+		if (Triangle::intersectTriangle(ray, vertex1, vertex2, vertex3, rayParameter) && !ARE_FLOATS_EQUAL(rayParameter, 0.0f) && rayParameter < parameter)
+		{
+			parameter = rayParameter;
+			intersectedFace = faceIndices[i];
 		}
 	}
+	return parameter != MathFunctions::T_INFINITY;
+}
+
+bool Mesh::quantizeOctree()
+{
+	if (this->quantizedOctree)
+	{
+		return true;
+	}
+
+	//The quantized octree is flattened from the whole tree
+	completeOctree();
+	QuantizedOctree * quantized = new QuantizedOctree(this->boundingOctree->root);
+	if (!quantized->isValid())
+	{
+		std::cout << "WARNING: Octree is too deep to be quantized, keeping the full octree" << std::endl;
+		delete quantized;
+		return false;
+	}
+
+	this->quantizedOctree = quantized;
+	delete this->boundingOctree;
+	this->boundingOctree = nullptr;
+	return true;
+}
+
+AABB * Mesh::getBoundingBox()
+{
+	return this->quantizedOctree ? this->quantizedOctree->getBoundingBox() : this->boundingOctree->root->boundingBox;
+}
+
+size_t Mesh::getOctreeMemoryUsage()
+{
+	return this->quantizedOctree ? this->quantizedOctree->getMemoryUsage() : this->boundingOctree->getMemoryUsage();
 }
 
-void Mesh::generateChildren(OctreeNode * node, const std::vector<uint32_t> & triContents, uint32_t depth)
+void Mesh::generateChildren(BranchNode * node, const uint32_t * triContents, uint32_t triCount, uint32_t depth, bool lazy)
 {
 	AABB * parentBoundingBox = node->boundingBox;
 	const glm::vec3 parentCenter = parentBoundingBox->getCenter();
@@ -119,14 +251,15 @@ void Mesh::generateChildren(OctreeNode * node, const std::vector<uint32_t> & tri
 		//Create the bounding box the the subdivided box by supplying the half distances and calculated centers
 		glm::vec3 center = parentCenter + glm::vec3(parentHalfDistances.x * s1 * 0.5f, parentHalfDistances.y * s2 * 0.5f, parentHalfDistances.z * s3 * 0.5f);
 		glm::vec3 halfDistances = parentHalfDistances * 0.5f;
-		AABB * boundingBox = new AABB(center, halfDistances);
+		//The box is only allocated in the octree once it is known to hold triangles
+		AABB boundingBox(center, halfDistances);
 
-		for (uint32_t j = 0; j < triContents.size(); j++)
+		//Faces are read through the accessors since a lazy octree can be built after the mesh has been compacted or streamed
+		for (uint32_t j = 0; j < triCount; j++)
 		{
-			uint32_t index1 = this->faces[triContents[j]].indices[0];
-			uint32_t index2 = this->faces[triContents[j]].indices[1];
-			uint32_t index3 = this->faces[triContents[j]].indices[2];
-			if (boundingBox->isTriangleOverlapping(this->vertices[index1], this->vertices[index2], this->vertices[index3]))
+			uint32_t indices[3];
+			getFaceVertexIndices(triContents[j], indices);
+			if (boundingBox.isTriangleOverlapping(getVertex(indices[0]), getVertex(indices[1]), getVertex(indices[2])))
 			{
 				triangleContents.push_back(triContents[j]);
 			}
@@ -140,22 +273,423 @@ void Mesh::generateChildren(OctreeNode * node, const std::vector<uint32_t> & tri
 		//Otherwise, if the size is less than the min triangle count or the depth has reached the maximum depth stop creating nodes
 		if (triangleContents.size() <= this->boundingOctree->getMinObjects() || depth == this->boundingOctree->getMaxDepth())
 		{
-			LeafNode<uint32_t> * leafNode = new LeafNode<uint32_t>(boundingBox);
-			leafNode->contents = std::vector<uint32_t>(triangleContents.begin(), triangleContents.end());
-			BranchNode * branchNode = (BranchNode*)node;
-			branchNode->children[i] = leafNode;
+			LeafNode<uint32_t> * leafNode = this->boundingOctree->createLeaf(center, halfDistances, triangleContents.data(), triangleContents.size());
+			node->children[i] = leafNode;
 			leafNode->parent = node;
 			continue;
 		}
+		//A lazy build stops at the new branch and leaves its children to be built when a ray reaches it
+		else if (lazy)
+		{
+			BranchNode * branchNode = this->boundingOctree->createPendingBranch(center, halfDistances, depth + 1, triangleContents.data(), triangleContents.size());
+			branchNode->parent = node;
+			node->children[i] = branchNode;
+		}
 		//Otherwise, create a branch node and continue making the octree
 		else
 		{
-			BranchNode * branchNode = new BranchNode(boundingBox);
-			BranchNode * parentNode = (BranchNode*)node;
-			parentNode->children[i] = branchNode;
+			BranchNode * branchNode = this->boundingOctree->createBranch(center, halfDistances);
+			node->children[i] = branchNode;
 			branchNode->parent = node;
-			generateChildren(branchNode, triangleContents, depth+1);
+			generateChildren(branchNode, triangleContents.data(), triangleContents.size(), depth+1, false);
+		}
+	}
+}
+
+bool Mesh::compact()
+{
+	if (this->compacted)
+	{
+		return true;
+	}
+
+	std::vector<uint16_t> materialIndices;
+	if (this->geometryCache || !buildMaterialPalette(materialIndices))
+	{
+		std::cout << "WARNING: Mesh is streamed or uses too many materials to be compacted, keeping it uncompressed" << std::endl;
+		return false;
+	}
+
+	//Each cluster copies in the vertices its faces use, so a vertex shared by faces in different clusters is stored once per cluster
+	//The octree only holds face indices and the face order is unchanged, so the octree stays valid
+	const uint32_t clusterFaces = 1 << CLUSTER_SHIFT;
+	HugePageVector<glm::vec3, MemoryCategory::Geometry> clusterVertices;
+	clusterVertices.reserve(this->vertices.size());
+	std::vector<uint32_t> vertexCluster(this->vertices.size(), UINT32_MAX);
+	std::vector<uint16_t> localIndices(this->vertices.size());
+	this->compactFaces.resize(this->faces.size());
+
+	for (uint32_t firstFace = 0; firstFace < this->faces.size(); firstFace += clusterFaces)
+	{
+		uint32_t cluster = firstFace >> CLUSTER_SHIFT;
+		uint32_t clusterOffset = clusterVertices.size();
+		this->clusterVertexOffsets.push_back(clusterOffset);
+
+		uint32_t lastFace = std::min<uint32_t>(firstFace + clusterFaces, this->faces.size());
+		for (uint32_t i = firstFace; i < lastFace; i++)
+		{
+			CompactFace & compactFace = this->compactFaces[i];
+			for (uint32_t j = 0; j < 3; j++)
+			{
+				uint32_t index = this->faces[i].indices[j];
+				if (vertexCluster[index] != cluster)
+				{
+					vertexCluster[index] = cluster;
+					localIndices[index] = clusterVertices.size() - clusterOffset;
+					clusterVertices.push_back(this->vertices[index]);
+					if (!this->normals.empty())
+					{
+						//Oct encoding folds the unit sphere onto the square [-1, 1]^2, the lower hemisphere is folded over the diagonals
+						glm::vec3 normal = this->normals[index] / (std::abs(this->normals[index].x) + std::abs(this->normals[index].y) + std::abs(this->normals[index].z));
+						glm::vec2 encoded(normal.x, normal.y);
+						if (normal.z < 0.0f)
+						{
+							encoded = glm::vec2((1.0f - std::abs(normal.y)) * (normal.x >= 0.0f ? 1.0f : -1.0f), (1.0f - std::abs(normal.x)) * (normal.y >= 0.0f ? 1.0f : -1.0f));
+						}
+						this->packedNormals.push_back(glm::packSnorm2x16(encoded));
+					}
+					if (!this->textureCoords.empty())
+					{
+						this->packedTextureCoords.push_back(glm::packHalf2x16(this->textureCoords[index]));
+					}
+				}
+				compactFace.indices[j] = localIndices[index];
+			}
+			compactFace.materialIndex = materialIndices[i];
+		}
+	}
+
+	this->vertices.swap(clusterVertices);
+	HugePageVector<Face, MemoryCategory::Geometry>().swap(this->faces);
+	HugePageVector<glm::vec3, MemoryCategory::Geometry>().swap(this->normals);
+	HugePageVector<glm::vec2, MemoryCategory::Geometry>().swap(this->textureCoords);
+	this->compacted = true;
+	return true;
+}
+
+bool Mesh::isCompacted() const
+{
+	return this->compacted;
+}
+
+bool Mesh::buildMaterialPalette(std::vector<uint16_t> & materialIndices)
+{
+	//Collects the materials used by the faces so each face can refer to its material by a small index
+	materialIndices.resize(this->faces.size());
+	for (uint32_t i = 0; i < this->faces.size(); i++)
+	{
+		auto found = std::find(this->materials.begin(), this->materials.end(), this->faces[i].material);
+		if (found == this->materials.end())
+		{
+			if (this->materials.size() > UINT16_MAX)
+			{
+				this->materials.clear();
+				return false;
+			}
+			found = this->materials.insert(found, this->faces[i].material);
+		}
+		materialIndices[i] = found - this->materials.begin();
+	}
+	return true;
+}
+
+bool Mesh::stream(GeometryCache * cache)
+{
+	if (this->geometryCache)
+	{
+		return true;
+	}
+
+	//Vertex indices of a streamed mesh only have 16 bits for the cluster
+	const uint32_t clusterFaces = 1 << STREAM_CLUSTER_SHIFT;
+	std::vector<uint16_t> materialIndices;
+	if (this->compacted || ((this->faces.size() + clusterFaces - 1) >> STREAM_CLUSTER_SHIFT) > (1 << 16) || !buildMaterialPalette(materialIndices))
+	{
+		std::cout << "WARNING: Mesh is compacted, too large or uses too many materials to be streamed, keeping it in memory" << std::endl;
+		return false;
+	}
+
+	//Works the same way as compact, each cluster copies in the vertices its faces use and its faces index them with 16 bit indices
+	std::vector<uint32_t> vertexCluster(this->vertices.size(), UINT32_MAX);
+	std::vector<uint16_t> localIndices(this->vertices.size());
+	std::vector<int32_t> clusterIDs;
+	for (uint32_t firstFace = 0; firstFace < this->faces.size(); firstFace += clusterFaces)
+	{
+		uint32_t clusterIndex = firstFace >> STREAM_CLUSTER_SHIFT;
+		uint32_t lastFace = std::min<uint32_t>(firstFace + clusterFaces, this->faces.size());
+		GeometryCluster cluster;
+		cluster.faces.resize(lastFace - firstFace);
+		for (uint32_t i = firstFace; i < lastFace; i++)
+		{
+			CompactFace & clusterFace = cluster.faces[i - firstFace];
+			for (uint32_t j = 0; j < 3; j++)
+			{
+				uint32_t index = this->faces[i].indices[j];
+				if (vertexCluster[index] != clusterIndex)
+				{
+					vertexCluster[index] = clusterIndex;
+					localIndices[index] = cluster.vertices.size();
+					cluster.vertices.push_back(this->vertices[index]);
+					if (!this->normals.empty())
+					{
+						cluster.normals.push_back(this->normals[index]);
+					}
+					if (!this->textureCoords.empty())
+					{
+						cluster.textureCoords.push_back(this->textureCoords[index]);
+					}
+				}
+				clusterFace.indices[j] = localIndices[index];
+			}
+			clusterFace.materialIndex = materialIndices[i];
+		}
+
+		int32_t clusterID = cache->addCluster(cluster);
+		if (clusterID < 0)
+		{
+			std::cout << "WARNING: Could not write mesh to the geometry cache, keeping it in memory" << std::endl;
+			this->materials.clear();
+			return false;
+		}
+		clusterIDs.push_back(clusterID);
+	}
+
+	this->geometryCache = cache;
+	this->streamedClusters.swap(clusterIDs);
+	this->streamedFaceCount = this->faces.size();
+	this->streamedNormals = !this->normals.empty();
+	this->streamedTextureCoords = !this->textureCoords.empty();
+	HugePageVector<Face, MemoryCategory::Geometry>().swap(this->faces);
+	HugePageVector<glm::vec3, MemoryCategory::Geometry>().swap(this->vertices);
+	HugePageVector<glm::vec3, MemoryCategory::Geometry>().swap(this->normals);
+	HugePageVector<glm::vec2, MemoryCategory::Geometry>().swap(this->textureCoords);
+	return true;
+}
+
+bool Mesh::isStreamed() const
+{
+	return this->geometryCache != nullptr;
+}
+
+std::shared_ptr<const GeometryCluster> Mesh::getStreamedCluster(uint32_t clusterIndex) const
+{
+	return this->geometryCache->getCluster(this->streamedClusters[clusterIndex]);
+}
+
+uint32_t Mesh::getFaceCount() const
+{
+	if (this->geometryCache)
+	{
+		return this->streamedFaceCount;
+	}
+	return this->compacted ? this->compactFaces.size() : this->faces.size();
+}
+
+void Mesh::getFaceVertexIndices(uint32_t faceIndex, uint32_t indices[3]) const
+{
+	if (this->geometryCache)
+	{
+		uint32_t clusterIndex = faceIndex >> STREAM_CLUSTER_SHIFT;
+		const CompactFace & face = getStreamedCluster(clusterIndex)->faces[faceIndex & ((1 << STREAM_CLUSTER_SHIFT) - 1)];
+		indices[0] = (clusterIndex << 16) | face.indices[0];
+		indices[1] = (clusterIndex << 16) | face.indices[1];
+		indices[2] = (clusterIndex << 16) | face.indices[2];
+	}
+	else if (this->compacted)
+	{
+		const CompactFace & face = this->compactFaces[faceIndex];
+		uint32_t clusterOffset = this->clusterVertexOffsets[faceIndex >> CLUSTER_SHIFT];
+		indices[0] = clusterOffset + face.indices[0];
+		indices[1] = clusterOffset + face.indices[1];
+		indices[2] = clusterOffset + face.indices[2];
+	}
+	else
+	{
+		const Face & face = this->faces[faceIndex];
+		indices[0] = face.indices[0];
+		indices[1] = face.indices[1];
+		indices[2] = face.indices[2];
+	}
+}
+
+Material * Mesh::getFaceMaterial(uint32_t faceIndex) const
+{
+	if (this->geometryCache)
+	{
+		return this->materials[getStreamedCluster(faceIndex >> STREAM_CLUSTER_SHIFT)->faces[faceIndex & ((1 << STREAM_CLUSTER_SHIFT) - 1)].materialIndex];
+	}
+	return this->compacted ? this->materials[this->compactFaces[faceIndex].materialIndex] : this->faces[faceIndex].material;
+}
+
+bool Mesh::hasNormals() const
+{
+	if (this->geometryCache)
+	{
+		return this->streamedNormals;
+	}
+	return this->compacted ? !this->packedNormals.empty() : !this->normals.empty();
+}
+
+bool Mesh::hasTextureCoords() const
+{
+	if (this->geometryCache)
+	{
+		return this->streamedTextureCoords;
+	}
+	return this->compacted ? !this->packedTextureCoords.empty() : !this->textureCoords.empty();
+}
+
+glm::vec3 Mesh::getVertex(uint32_t vertexIndex) const
+{
+	if (this->geometryCache)
+	{
+		return getStreamedCluster(vertexIndex >> 16)->vertices[vertexIndex & 0xFFFF];
+	}
+	return this->vertices[vertexIndex];
+}
+
+glm::vec3 Mesh::getNormal(uint32_t vertexIndex) const
+{
+	if (this->geometryCache)
+	{
+		return getStreamedCluster(vertexIndex >> 16)->normals[vertexIndex & 0xFFFF];
+	}
+	if (!this->compacted)
+	{
+		return this->normals[vertexIndex];
+	}
+
+	glm::vec2 encoded = glm::unpackSnorm2x16(this->packedNormals[vertexIndex]);
+	glm::vec3 normal(encoded.x, encoded.y, 1.0f - std::abs(encoded.x) - std::abs(encoded.y));
+	if (normal.z < 0.0f)
+	{
+		normal.x = (1.0f - std::abs(encoded.y)) * (encoded.x >= 0.0f ? 1.0f : -1.0f);
+		normal.y = (1.0f - std::abs(encoded.x)) * (encoded.y >= 0.0f ? 1.0f : -1.0f);
+	}
+	return glm::normalize(normal);
+}
+
+glm::vec2 Mesh::getTextureCoord(uint32_t vertexIndex) const
+{
+	if (this->geometryCache)
+	{
+		return getStreamedCluster(vertexIndex >> 16)->textureCoords[vertexIndex & 0xFFFF];
+	}
+	return this->compacted ? glm::unpackHalf2x16(this->packedTextureCoords[vertexIndex]) : this->textureCoords[vertexIndex];
+}
+
+void Mesh::getFaceAttributes(uint32_t faceIndex, FaceAttributes & attributes, bool includeNormals) const
+{
+	if (this->geometryCache)
+	{
+		std::shared_ptr<const GeometryCluster> cluster = getStreamedCluster(faceIndex >> STREAM_CLUSTER_SHIFT);
+		const CompactFace & face = cluster->faces[faceIndex & ((1 << STREAM_CLUSTER_SHIFT) - 1)];
+		attributes.material = this->materials[face.materialIndex];
+		for (uint32_t corner = 0; corner < 3; corner++)
+		{
+			attributes.vertices[corner] = cluster->vertices[face.indices[corner]];
+			if (includeNormals && this->streamedNormals)
+			{
+				attributes.normals[corner] = cluster->normals[face.indices[corner]];
+			}
+			if (this->streamedTextureCoords)
+			{
+				attributes.textureCoords[corner] = cluster->textureCoords[face.indices[corner]];
+			}
+		}
+		return;
+	}
+
+	uint32_t indices[3];
+	getFaceVertexIndices(faceIndex, indices);
+	attributes.material = getFaceMaterial(faceIndex);
+	bool readNormals = includeNormals && hasNormals();
+	bool readTextureCoords = hasTextureCoords();
+	for (uint32_t corner = 0; corner < 3; corner++)
+	{
+		attributes.vertices[corner] = this->vertices[indices[corner]];
+		if (readNormals)
+		{
+			attributes.normals[corner] = getNormal(indices[corner]);
+		}
+		if (readTextureCoords)
+		{
+			attributes.textureCoords[corner] = getTextureCoord(indices[corner]);
 		}
 	}
 }
 
+size_t Mesh::getMemoryUsage() const
+{
+	size_t bytes = this->vertices.size() * sizeof(glm::vec3) + this->normals.size() * sizeof(glm::vec3) + this->textureCoords.size() * sizeof(glm::vec2) + this->faces.size() * sizeof(Face);
+	bytes += this->compactFaces.size() * sizeof(CompactFace) + this->clusterVertexOffsets.size() * sizeof(uint32_t);
+	bytes += (this->packedNormals.size() + this->packedTextureCoords.size()) * sizeof(uint32_t) + this->materials.size() * sizeof(Material*);
+	bytes += this->streamedClusters.size() * sizeof(int32_t);
+	return bytes;
+}
+
+void Mesh::generateLods(uint32_t levelCount, bool lazyOctrees)
+{
+	if (this->vertices.empty())
+	{
+		return;
+	}
+	AABB * meshBoundingBox = AABB::calculateBoundingBox(this->vertices.data(), this->vertices.size());
+	glm::vec3 halfDistances = meshBoundingBox->getHalfDistances();
+	float extent = 2.0f * std::max(halfDistances.x, std::max(halfDistances.y, halfDistances.z));
+	delete meshBoundingBox;
+
+	uint32_t previousFaceCount = this->faces.size();
+	for (uint32_t level = 1; level <= levelCount && (LOD_BASE_RESOLUTION >> (level - 1)) > 0; level++)
+	{
+		float cellSize = extent / (LOD_BASE_RESOLUTION >> (level - 1));
+		Mesh * lod = MeshSimplifier::simplify(this, cellSize);
+		if (lod->faces.empty() || lod->faces.size() * 4 > previousFaceCount * 3)
+		{
+			delete lod;
+			continue;
+		}
+		//The level is laid out for its octree the same way the mesh was when it was imported
+		MeshOptimizer::optimize(lod);
+		lod->constructOctree(true, lazyOctrees);
+		previousFaceCount = lod->faces.size();
+		this->lods.push_back(lod);
+		//A merged vertex stays inside its cell so it is at most a cell diagonal away from the vertices it replaced
+		this->lodErrors.push_back(cellSize * std::sqrt(3.0f));
+	}
+}
+
+uint32_t Mesh::getLodCount() const
+{
+	return this->lods.size() + 1;
+}
+
+Mesh * Mesh::getLod(uint32_t level)
+{
+	return level == 0 ? this : this->lods[level - 1];
+}
+
+float Mesh::getLodError(uint32_t level) const
+{
+	return level == 0 ? 0.0f : this->lodErrors[level - 1];
+}
+
+void Mesh::setCountTriangleTests(bool count)
+{
+	countTriangleTests = count;
+}
+
+bool Mesh::isCountingTriangleTests()
+{
+	return countTriangleTests;
+}
+
+uint64_t Mesh::getTriangleTests()
+{
+	return triangleTests.load(std::memory_order_relaxed);
+}
+
+void Mesh::resetTriangleTests()
+{
+	triangleTests.store(0, std::memory_order_relaxed);
+}
@@ -1,11 +1,16 @@
 #pragma once
 
 #include <vector>
+#include <memory>
+#include <atomic>
 #include <glm/vec3.hpp>
 #include <glm/vec2.hpp>
+#include <glm/matrix.hpp>
 
 #include <assimp/scene.h>
 
+#include "../../Memory/HugePages.h"
+
 class Material;
 class AABB;
 
@@ -13,6 +18,10 @@ template<typename T>
 class Octree;
 
 class OctreeNode;
+class BranchNode;
+class QuantizedOctree;
+class GeometryCache;
+struct GeometryCluster;
 class Ray;
 
 struct Face
@@ -22,20 +31,138 @@ struct Face
 
 };
 
+//Face of a compacted mesh, the indices are relative to the first vertex of the cluster the face is in and the material is an index into the materials of the mesh
+struct CompactFace
+{
+	uint16_t indices[3];
+	uint16_t materialIndex;
+};
+
+//The corners of a face and its material read from a mesh in any format, normals and texture coordinates are only filled in if the mesh has them
+//Shading reads the whole face at once so a streamed mesh looks up the cluster of the face a single time per hit
+struct FaceAttributes
+{
+	glm::vec3 vertices[3];
+	glm::vec3 normals[3];
+	glm::vec2 textureCoords[3];
+	Material * material;
+};
+
+//Placement of a mesh in its model, every node of an imported scene that references a mesh becomes an instance sharing that mesh and its octree
+struct MeshInstance
+{
+	uint32_t meshIndex;
+	glm::mat4 meshToModelMatrix;
+	glm::mat4 modelToMeshMatrix;
+	//Rays are only transformed into the space of the mesh for instances that are not at the origin of the model
+	bool identity;
+};
+
 class Mesh
 {
 public:
+	//Leaves hold at most this many faces unless the octree has reached its maximum depth
+	static const uint32_t OCTREE_MIN_OBJECTS;
+	static const uint32_t OCTREE_MAX_DEPTH;
+	//A compacted mesh groups its faces into clusters of 1 << CLUSTER_SHIFT faces, each cluster gets its own copy of the vertices it uses
+	static const uint32_t CLUSTER_SHIFT;
+	//A streamed mesh is written to the geometry cache in clusters of 1 << STREAM_CLUSTER_SHIFT faces
+	static const uint32_t STREAM_CLUSTER_SHIFT;
+	//The first level of detail merges vertices in cells of the largest extent of the mesh over this many, each level after it doubles the cell size
+	static const uint32_t LOD_BASE_RESOLUTION;
+
 	Mesh();
 	~Mesh();
-	std::vector<Face> faces;
-	std::vector<glm::vec3> vertices;
-	std::vector<glm::vec2> textureCoords;
-	std::vector<glm::vec3> normals;
+	//Faces and vertices are the bulk of the geometry a traversal touches, so they can be put on huge pages
+	HugePageVector<Face, MemoryCategory::Geometry> faces;
+	HugePageVector<glm::vec3, MemoryCategory::Geometry> vertices;
+	HugePageVector<glm::vec2, MemoryCategory::Geometry> textureCoords;
+	HugePageVector<glm::vec3, MemoryCategory::Geometry> normals;
+	//Null once the octree has been replaced by its quantized copy
 	Octree<uint32_t> * boundingOctree;
 
-	void constructOctree();
-	bool intersectMesh(const Ray & ray, float & parameter, Face *& intersectedFace);
+	//The octree is built in an arena of its own unless told to allocate its nodes from the heap
+	//A lazy octree starts out as only its root, each branch builds its children the first time a ray enters it
+	void constructOctree(bool useArena = true, bool lazy = false);
+	//Builds every branch of a lazy octree that has not been built yet
+	void completeOctree();
+	bool intersectMesh(const Ray & ray, float & parameter, uint32_t & intersectedFace);
+
+	//Replaces the octree with a QuantizedOctree, returns false and keeps the octree if it can not be quantized
+	bool quantizeOctree();
+	AABB * getBoundingBox();
+	size_t getOctreeMemoryUsage();
+
+	//Replaces the faces, normals and texture coordinates with the compact format, the octree has to be built first
+	//Normals are oct encoded into two 16 bit components, texture coordinates are stored as half floats and faces use 16 bit indices into their cluster
+	//Positions keep full precision so intersections are unchanged, the packed data is only decoded when a hit is shaded
+	//Returns false and leaves the mesh as it is if the faces use more materials than a 16 bit index can hold
+	bool compact();
+	bool isCompacted() const;
+
+	//Moves the faces and vertex attributes out to clusters in the geometry cache, leaving only the octree and the material palette in memory
+	//Faces were put in Morton order when the mesh was imported, so each cluster covers a compact region of the mesh and a ray reaching it pages in the faces around it
+	//The octree has to be built first, returns false and leaves the mesh as it is if it is compacted or has too many faces
+	bool stream(GeometryCache * cache);
+	bool isStreamed() const;
+
+	//Accessors that read the mesh in any format, vertex indices are the ones returned by getFaceVertexIndices
+	uint32_t getFaceCount() const;
+	void getFaceVertexIndices(uint32_t faceIndex, uint32_t indices[3]) const;
+	Material * getFaceMaterial(uint32_t faceIndex) const;
+	bool hasNormals() const;
+	bool hasTextureCoords() const;
+	glm::vec3 getVertex(uint32_t vertexIndex) const;
+	glm::vec3 getNormal(uint32_t vertexIndex) const;
+	glm::vec2 getTextureCoord(uint32_t vertexIndex) const;
+	//Reads every attribute of the face, normals are skipped unless asked for since texture coordinate lookups do not need them
+	void getFaceAttributes(uint32_t faceIndex, FaceAttributes & attributes, bool includeNormals) const;
+
+	//Bytes used by the geometry of the mesh, not counting its octree, its levels of detail or the clusters of a streamed mesh
+	size_t getMemoryUsage() const;
+
+	//Builds coarser copies of the mesh with MeshSimplifier, each with its own octree, the mesh has to be in the full format
+	//Levels that would not drop at least a quarter of the faces of the level before are skipped, so fewer levels than asked for can be made
+	void generateLods(uint32_t levelCount, bool lazyOctrees);
+	//Level 0 is the mesh itself, so the count is one more than the number of coarser levels
+	uint32_t getLodCount() const;
+	Mesh * getLod(uint32_t level);
+	//Largest distance in the space of the mesh a vertex of the level was moved from the surface of the mesh, zero for level 0
+	float getLodError(uint32_t level) const;
+
+	//Total number of ray triangle tests run on every mesh, for comparing traversal work between renders
+	//Tests are only counted once counting is turned on, since every thread adding to the shared count slows down the traversal
+	static void setCountTriangleTests(bool count);
+	static bool isCountingTriangleTests();
+	static uint64_t getTriangleTests();
+	static void resetTriangleTests();
 
 private:
-	void generateChildren(OctreeNode * node, const std::vector<uint32_t> & triContents, uint32_t depth);
+	static bool countTriangleTests;
+	static std::atomic<uint64_t> triangleTests;
+
+	std::vector<Mesh*> lods;
+	std::vector<float> lodErrors;
+	QuantizedOctree * quantizedOctree;
+	bool compacted;
+	HugePageVector<CompactFace, MemoryCategory::Geometry> compactFaces;
+	HugePageVector<uint32_t, MemoryCategory::Geometry> clusterVertexOffsets;
+	HugePageVector<uint32_t, MemoryCategory::Geometry> packedNormals;
+	HugePageVector<uint32_t, MemoryCategory::Geometry> packedTextureCoords;
+	std::vector<Material*> materials;
+	GeometryCache * geometryCache;
+	std::vector<int32_t> streamedClusters;
+	uint32_t streamedFaceCount;
+	bool streamedNormals;
+	bool streamedTextureCoords;
+
+	//Collects the materials used by the faces into the material palette, returns false if there are more than a 16 bit index can hold
+	bool buildMaterialPalette(std::vector<uint16_t> & materialIndices);
+	//Vertex indices of a streamed mesh hold the cluster in the upper 16 bits and the vertex in the cluster in the lower 16 bits
+	std::shared_ptr<const GeometryCluster> getStreamedCluster(uint32_t clusterIndex) const;
+
+	//Tests the faces of a leaf and keeps the nearest hit, returns true if any face was hit
+	bool intersectLeaf(const Ray & ray, const uint32_t * faceIndices, uint32_t faceCount, float & parameter, uint32_t & intersectedFace);
+	//Builds the children of the node at the given depth, a lazy build leaves the new branches pending instead of building them as well
+	void generateChildren(BranchNode * node, const uint32_t * triContents, uint32_t triCount, uint32_t depth, bool lazy);
 };
\ No newline at end of file
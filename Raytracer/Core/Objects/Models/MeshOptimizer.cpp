@@ -0,0 +1,208 @@
+#include "MeshOptimizer.h"
+
+#include "Mesh.h"
+#include "../../Assets/MappedFile.h"
+
+#include <glm/geometric.hpp>
+
+#include <unordered_map>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+
+//Number of cells along each axis of the grid the face centroids are snapped to before computing their Morton codes
+constexpr uint32_t MORTON_GRID_SIZE = 1 << 10;
+
+//Bit exact copy of everything stored for a vertex so vertices are only welded when welding can not change the render
+struct VertexKey
+{
+	float values[8];
+
+	bool operator==(const VertexKey & other) const
+	{
+		return std::memcmp(values, other.values, sizeof(values)) == 0;
+	}
+};
+
+struct VertexKeyHash
+{
+	size_t operator()(const VertexKey & key) const
+	{
+		return (size_t)MappedFile::hashBytes(key.values, sizeof(key.values));
+	}
+};
+
+MeshOptimizer::Statistics MeshOptimizer::optimize(Mesh * mesh)
+{
+	Statistics statistics = {};
+	statistics.bytesBefore = mesh->getMemoryUsage();
+
+	weldVertices(mesh, statistics);
+	removeDegenerateFaces(mesh, statistics);
+	sortFaces(mesh);
+	reorderVertices(mesh);
+
+	statistics.bytesAfter = mesh->getMemoryUsage();
+	return statistics;
+}
+
+void MeshOptimizer::weldVertices(Mesh * mesh, Statistics & statistics)
+{
+	bool hasNormals = !mesh->normals.empty();
+	bool hasTextureCoords = !mesh->textureCoords.empty();
+
+	std::unordered_map<VertexKey, uint32_t, VertexKeyHash> uniqueVertices;
+	uniqueVertices.reserve(mesh->vertices.size());
+	std::vector<uint32_t> remap(mesh->vertices.size());
+	uint32_t uniqueCount = 0;
+
+	for (uint32_t i = 0; i < mesh->vertices.size(); i++)
+	{
+		VertexKey key = {};
+		std::memcpy(&key.values[0], &mesh->vertices[i], sizeof(glm::vec3));
+		if (hasNormals)
+		{
+			std::memcpy(&key.values[3], &mesh->normals[i], sizeof(glm::vec3));
+		}
+		if (hasTextureCoords)
+		{
+			std::memcpy(&key.values[6], &mesh->textureCoords[i], sizeof(glm::vec2));
+		}
+
+		auto inserted = uniqueVertices.insert(std::make_pair(key, uniqueCount));
+		if (inserted.second)
+		{
+			//The unique vertices are compacted to the front of the arrays as they are found
+			mesh->vertices[uniqueCount] = mesh->vertices[i];
+			if (hasNormals)
+			{
+				mesh->normals[uniqueCount] = mesh->normals[i];
+			}
+			if (hasTextureCoords)
+			{
+				mesh->textureCoords[uniqueCount] = mesh->textureCoords[i];
+			}
+			uniqueCount++;
+		}
+		remap[i] = inserted.first->second;
+	}
+
+	statistics.weldedVertices = mesh->vertices.size() - uniqueCount;
+	mesh->vertices.resize(uniqueCount);
+	mesh->normals.resize(hasNormals ? uniqueCount : 0);
+	mesh->textureCoords.resize(hasTextureCoords ? uniqueCount : 0);
+
+	for (Face & face : mesh->faces)
+	{
+		for (uint32_t j = 0; j < 3; j++)
+		{
+			face.indices[j] = remap[face.indices[j]];
+		}
+	}
+}
+
+void MeshOptimizer::removeDegenerateFaces(Mesh * mesh, Statistics & statistics)
+{
+	//A face with no area can never be hit, this covers faces with repeated vertices as well as faces whose vertices are in a line
+	auto isDegenerate = [mesh](const Face & face)
+	{
+		glm::vec3 vertex1 = mesh->vertices[face.indices[0]];
+		glm::vec3 vertex2 = mesh->vertices[face.indices[1]];
+		glm::vec3 vertex3 = mesh->vertices[face.indices[2]];
+		return glm::cross(vertex2 - vertex1, vertex3 - vertex1) == glm::vec3(0.0f);
+	};
+
+	size_t faceCount = mesh->faces.size();
+	mesh->faces.erase(std::remove_if(mesh->faces.begin(), mesh->faces.end(), isDegenerate), mesh->faces.end());
+	statistics.removedFaces = faceCount - mesh->faces.size();
+}
+
+void MeshOptimizer::sortFaces(Mesh * mesh)
+{
+	if (mesh->faces.empty())
+	{
+		return;
+	}
+
+	glm::vec3 minPoint = mesh->vertices[0];
+	glm::vec3 maxPoint = mesh->vertices[0];
+	for (const glm::vec3 & vertex : mesh->vertices)
+	{
+		minPoint = glm::min(minPoint, vertex);
+		maxPoint = glm::max(maxPoint, vertex);
+	}
+	glm::vec3 extent = glm::max(maxPoint - minPoint, glm::vec3(1e-20f));
+
+	std::vector<std::pair<uint32_t, uint32_t>> keys(mesh->faces.size());
+	for (uint32_t i = 0; i < mesh->faces.size(); i++)
+	{
+		const Face & face = mesh->faces[i];
+		glm::vec3 centroid = (mesh->vertices[face.indices[0]] + mesh->vertices[face.indices[1]] + mesh->vertices[face.indices[2]]) / 3.0f;
+		glm::vec3 cell = glm::clamp((centroid - minPoint) / extent * (float)MORTON_GRID_SIZE, glm::vec3(0.0f), glm::vec3(MORTON_GRID_SIZE - 1));
+		keys[i] = std::make_pair(mortonCode((uint32_t)cell.x, (uint32_t)cell.y, (uint32_t)cell.z), i);
+	}
+	//Faces in the same cell keep their import order
+	std::sort(keys.begin(), keys.end());
+
+	HugePageVector<Face, MemoryCategory::Geometry> sortedFaces;
+	sortedFaces.reserve(mesh->faces.size());
+	for (const std::pair<uint32_t, uint32_t> & key : keys)
+	{
+		sortedFaces.push_back(mesh->faces[key.second]);
+	}
+	mesh->faces.swap(sortedFaces);
+}
+
+void MeshOptimizer::reorderVertices(Mesh * mesh)
+{
+	const uint32_t UNASSIGNED = UINT32_MAX;
+	std::vector<uint32_t> remap(mesh->vertices.size(), UNASSIGNED);
+	HugePageVector<glm::vec3, MemoryCategory::Geometry> vertices;
+	HugePageVector<glm::vec3, MemoryCategory::Geometry> normals;
+	HugePageVector<glm::vec2, MemoryCategory::Geometry> textureCoords;
+	vertices.reserve(mesh->vertices.size());
+	normals.reserve(mesh->normals.size());
+	textureCoords.reserve(mesh->textureCoords.size());
+
+	//Vertices no face uses any more are dropped here
+	for (Face & face : mesh->faces)
+	{
+		for (uint32_t j = 0; j < 3; j++)
+		{
+			uint32_t & index = face.indices[j];
+			if (remap[index] == UNASSIGNED)
+			{
+				remap[index] = vertices.size();
+				vertices.push_back(mesh->vertices[index]);
+				if (!mesh->normals.empty())
+				{
+					normals.push_back(mesh->normals[index]);
+				}
+				if (!mesh->textureCoords.empty())
+				{
+					textureCoords.push_back(mesh->textureCoords[index]);
+				}
+			}
+			index = remap[index];
+		}
+	}
+
+	mesh->vertices.swap(vertices);
+	mesh->normals.swap(normals);
+	mesh->textureCoords.swap(textureCoords);
+}
+
+uint32_t MeshOptimizer::mortonCode(uint32_t x, uint32_t y, uint32_t z)
+{
+	//Spreads the 10 bits of a coordinate out so there are two zero bits between each of them
+	auto spreadBits = [](uint32_t value)
+	{
+		value &= 0x3ff;
+		value = (value | (value << 16)) & 0x030000ff;
+		value = (value | (value << 8)) & 0x0300f00f;
+		value = (value | (value << 4)) & 0x030c30c3;
+		value = (value | (value << 2)) & 0x09249249;
+		return value;
+	};
+	return (spreadBits(x) << 2) | (spreadBits(y) << 1) | spreadBits(z);
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+class Mesh;
+
+//Import time pass that shrinks a mesh and lays it out in memory in the order its octree visits it
+//Vertices that match in position, normal and texture coordinate are welded, faces with no area are removed
+//and the faces are sorted along a Morton curve through their centroids so triangles close in space are close in memory
+//The vertices are then renumbered in the order the sorted faces first use them
+class MeshOptimizer
+{
+public:
+	struct Statistics
+	{
+		uint32_t weldedVertices;
+		uint32_t removedFaces;
+		size_t bytesBefore;
+		size_t bytesAfter;
+	};
+
+	//Optimizes the mesh in place, it has to run before the octree of the mesh is built since the face indices change
+	static Statistics optimize(Mesh * mesh);
+
+private:
+	static void weldVertices(Mesh * mesh, Statistics & statistics);
+	static void removeDegenerateFaces(Mesh * mesh, Statistics & statistics);
+	static void sortFaces(Mesh * mesh);
+	static void reorderVertices(Mesh * mesh);
+
+	//Interleaves the low 10 bits of each coordinate into a 30 bit Morton code
+	static uint32_t mortonCode(uint32_t x, uint32_t y, uint32_t z);
+};
\ No newline at end of file
@@ -0,0 +1,105 @@
+#include "MeshSimplifier.h"
+
+#include "Mesh.h"
+
+#include <unordered_map>
+#include <algorithm>
+
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+
+//Cell coordinates are packed into 20 bits each, meshes are never cut into more cells than that along an axis
+constexpr uint32_t MAX_CELL_COORDINATE = (1 << 20) - 1;
+
+Mesh * MeshSimplifier::simplify(const Mesh * mesh, float cellSize)
+{
+	Mesh * result = new Mesh();
+	if (mesh->vertices.empty())
+	{
+		return result;
+	}
+
+	glm::vec3 minPoint = mesh->vertices[0];
+	for (const glm::vec3 & vertex : mesh->vertices)
+	{
+		minPoint = glm::min(minPoint, vertex);
+	}
+
+	bool hasNormals = !mesh->normals.empty();
+	bool hasTextureCoords = !mesh->textureCoords.empty();
+
+	//The merged vertices first hold the sums of the vertices in their cell and are divided by the counts at the end
+	std::unordered_map<uint64_t, uint32_t> cells;
+	std::vector<uint32_t> remap(mesh->vertices.size());
+	std::vector<uint32_t> counts;
+	for (uint32_t i = 0; i < mesh->vertices.size(); i++)
+	{
+		glm::vec3 cell = (mesh->vertices[i] - minPoint) / cellSize;
+		uint64_t key = (uint64_t)std::min((uint32_t)cell.x, MAX_CELL_COORDINATE);
+		key |= (uint64_t)std::min((uint32_t)cell.y, MAX_CELL_COORDINATE) << 20;
+		key |= (uint64_t)std::min((uint32_t)cell.z, MAX_CELL_COORDINATE) << 40;
+		if (hasNormals)
+		{
+			const glm::vec3 & normal = mesh->normals[i];
+			key |= (uint64_t)((normal.x < 0.0f) | (normal.y < 0.0f) << 1 | (normal.z < 0.0f) << 2) << 60;
+		}
+
+		auto inserted = cells.emplace(key, (uint32_t)result->vertices.size());
+		if (inserted.second)
+		{
+			result->vertices.push_back(glm::vec3(0.0f));
+			if (hasNormals)
+			{
+				result->normals.push_back(glm::vec3(0.0f));
+			}
+			if (hasTextureCoords)
+			{
+				result->textureCoords.push_back(glm::vec2(0.0f));
+			}
+			counts.push_back(0);
+		}
+		uint32_t merged = inserted.first->second;
+		remap[i] = merged;
+		result->vertices[merged] += mesh->vertices[i];
+		if (hasNormals)
+		{
+			result->normals[merged] += mesh->normals[i];
+		}
+		if (hasTextureCoords)
+		{
+			result->textureCoords[merged] += mesh->textureCoords[i];
+		}
+		counts[merged]++;
+	}
+
+	for (uint32_t i = 0; i < result->vertices.size(); i++)
+	{
+		result->vertices[i] /= (float)counts[i];
+		if (hasNormals)
+		{
+			//Normals in one octant can not cancel out, so only zero length normals in the source mesh need the fallback
+			float length = glm::length(result->normals[i]);
+			result->normals[i] = length > 0.0f ? result->normals[i] / length : glm::vec3(0.0f, 1.0f, 0.0f);
+		}
+		if (hasTextureCoords)
+		{
+			result->textureCoords[i] /= (float)counts[i];
+		}
+	}
+
+	result->faces.reserve(mesh->faces.size());
+	for (const Face & face : mesh->faces)
+	{
+		Face mergedFace;
+		mergedFace.material = face.material;
+		for (uint32_t j = 0; j < 3; j++)
+		{
+			mergedFace.indices[j] = remap[face.indices[j]];
+		}
+		if (mergedFace.indices[0] != mergedFace.indices[1] && mergedFace.indices[1] != mergedFace.indices[2] && mergedFace.indices[0] != mergedFace.indices[2])
+		{
+			result->faces.push_back(mergedFace);
+		}
+	}
+	return result;
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+class Mesh;
+
+//Import time pass that builds coarser copies of a mesh by vertex clustering, used as the levels of detail of the mesh
+//The bounding box of the mesh is cut into a grid of cells and the vertices in each cell are merged into one at their average
+//Faces that lose an edge in the merge are dropped, vertices are only merged if their normals point into the same octant so thin parts do not fold onto each other
+class MeshSimplifier
+{
+public:
+	//Builds a copy of the mesh with its vertices merged in cells of the given size, the copy has no octree
+	//The mesh has to be in the full format, not compacted or streamed
+	static Mesh * simplify(const Mesh * mesh, float cellSize);
+};
\ No newline at end of file
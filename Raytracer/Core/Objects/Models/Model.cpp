@@ -5,32 +5,134 @@
 #include "../../Renderer/Materials/Material.h"
 #include "../../Geometry/AABB.h"
 #include "../../DataStructures/Octree.h"
+#include "../../Assets/ModelCache.h"
+#include "../../Assets/ObjLoader.h"
+#include "MeshOptimizer.h"
+#include "../../Memory/MemoryTracker.h"
 
 #include <glm/matrix.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
 
 #include <assimp/Importer.hpp>
 #include <assimp/postprocess.h>
 
 #include <iostream>
+#include <cstdio>
 
-Model::Model(Mesh * m)
+bool Model::nativeObjLoading = true;
+bool Model::compactMeshStorage = false;
+bool Model::quantizedOctreeStorage = false;
+bool Model::lazyOctreeConstruction = false;
+uint32_t Model::lodLevelCount = 0;
+GeometryCache * Model::geometryCache = nullptr;
+
+Model::Model(Mesh * m) : modelBoundingBox(nullptr)
 {
 	this->meshList.push_back(m);
+	addInstance(0, glm::mat4(1.0f));
 }
 
-Model::Model(std::string path)
+Model::Model(std::string path) : modelBoundingBox(nullptr)
 {
-	Assimp::Importer importer;
-	const aiScene *scene = importer.ReadFile(path, aiProcess_FlipUVs | aiProcess_Triangulate);
-
-	if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
+	//Everything the model allocates while loading is charged to it
+	MemoryTracker::AssetScope assetScope(path);
+	//A cache file written by an earlier run is loaded in place of importing the model and building its octrees
+	if (!ModelCache::load(path, this->meshList, this->instanceList) && !importModel(path))
 	{
-		std::cout << "(ERROR) ASSIMP: " << importer.GetErrorString() << std::endl;
 		return;
 	}
+	calculateModelBoundingBox();
+
+	//Levels of detail are not kept in the cache, they are simplified from the full meshes before those are streamed or compacted
+	if (lodLevelCount > 0)
+	{
+		for (Mesh * mesh : this->meshList)
+		{
+			mesh->generateLods(lodLevelCount, lazyOctreeConstruction);
+			printf("Levels of detail of %s:", path.c_str());
+			for (uint32_t level = 0; level < mesh->getLodCount(); level++)
+			{
+				printf(" %u", mesh->getLod(level)->getFaceCount());
+			}
+			printf(" faces\n");
+		}
+	}
 
-	processNode(scene->mRootNode, scene);
+	//The cache always holds the full precision meshes and octrees, they are streamed or compacted and quantized after loading
+	if (geometryCache)
+	{
+		size_t bytesBefore = getMemoryUsage();
+		streamMeshes();
+		printf("Streamed %s: %.1f KB -> %.1f KB resident\n", path.c_str(), bytesBefore / 1024.0, getMemoryUsage() / 1024.0);
+	}
+	else if (compactMeshStorage)
+	{
+		size_t bytesBefore = getMemoryUsage();
+		compactMeshes();
+		printf("Compacted %s: %.1f KB -> %.1f KB\n", path.c_str(), bytesBefore / 1024.0, getMemoryUsage() / 1024.0);
+	}
+
+	if (quantizedOctreeStorage)
+	{
+		//Lazy octrees are built in full first so the sizes compare whole trees
+		for (Mesh * mesh : this->meshList)
+		{
+			for (uint32_t level = 0; level < mesh->getLodCount(); level++)
+			{
+				mesh->getLod(level)->completeOctree();
+			}
+		}
+		size_t bytesBefore = getOctreeMemoryUsage();
+		quantizeOctrees();
+		printf("Quantized octrees of %s: %.1f KB -> %.1f KB\n", path.c_str(), bytesBefore / 1024.0, getOctreeMemoryUsage() / 1024.0);
+	}
+}
+
+bool Model::importModel(const std::string & path)
+{
+	//OBJ files have no node hierarchy so every mesh is placed once at the origin of the model
+	if (nativeObjLoading && ObjLoader::isObjFile(path) && ObjLoader::load(path, this->meshList))
+	{
+		for (uint32_t i = 0; i < this->meshList.size(); i++)
+		{
+			addInstance(i, glm::mat4(1.0f));
+		}
+	}
+	//Assimp handles every format other than OBJ and any OBJ file the native loader can not read
+	else
+	{
+		Assimp::Importer importer;
+		const aiScene *scene = importer.ReadFile(path, aiProcess_FlipUVs | aiProcess_Triangulate);
+
+		if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
+		{
+			std::cout << "(ERROR) ASSIMP: " << importer.GetErrorString() << std::endl;
+			return false;
+		}
+
+		std::vector<int32_t> meshIndices(scene->mNumMeshes, -1);
+		processNode(scene->mRootNode, scene, glm::mat4(1.0f), meshIndices);
+	}
+
+	//The meshes are welded, cleaned up and reordered before their octrees are built since that changes the face indices
+	MeshOptimizer::Statistics totals = {};
+	for (Mesh * mesh : this->meshList)
+	{
+		MeshOptimizer::Statistics statistics = MeshOptimizer::optimize(mesh);
+		totals.weldedVertices += statistics.weldedVertices;
+		totals.removedFaces += statistics.removedFaces;
+		totals.bytesBefore += statistics.bytesBefore;
+		totals.bytesAfter += statistics.bytesAfter;
+		mesh->constructOctree(true, lazyOctreeConstruction);
+	}
+	printf("Optimized %s: %u vertices welded, %u degenerate faces removed, %.1f KB -> %.1f KB (%.1f KB saved)\n", path.c_str(), totals.weldedVertices, totals.removedFaces, totals.bytesBefore / 1024.0, totals.bytesAfter / 1024.0, (totals.bytesBefore - totals.bytesAfter) / 1024.0);
+
+	if (!lazyOctreeConstruction)
+	{
+		ModelCache::save(path, this->meshList, this->instanceList);
+	}
+	return true;
 }
 
 Model::~Model()
@@ -46,35 +148,149 @@ Model::~Model()
 	}
 }
 
+void Model::setNativeObjLoading(bool enabled)
+{
+	nativeObjLoading = enabled;
+}
+
+void Model::setCompactMeshes(bool enabled)
+{
+	compactMeshStorage = enabled;
+}
+
+void Model::compactMeshes()
+{
+	for (Mesh * mesh : this->meshList)
+	{
+		for (uint32_t level = 0; level < mesh->getLodCount(); level++)
+		{
+			mesh->getLod(level)->compact();
+		}
+	}
+}
+
+void Model::setGeometryCache(GeometryCache * cache)
+{
+	geometryCache = cache;
+}
+
+void Model::streamMeshes()
+{
+	//Only the full meshes are streamed, their levels of detail are small enough to stay in memory
+	for (Mesh * mesh : this->meshList)
+	{
+		mesh->stream(geometryCache);
+	}
+}
+
+void Model::setQuantizeOctrees(bool enabled)
+{
+	quantizedOctreeStorage = enabled;
+}
+
+void Model::setLazyOctrees(bool enabled)
+{
+	lazyOctreeConstruction = enabled;
+}
+
+void Model::setLodLevels(uint32_t levelCount)
+{
+	lodLevelCount = levelCount;
+}
+
+void Model::quantizeOctrees()
+{
+	for (Mesh * mesh : this->meshList)
+	{
+		for (uint32_t level = 0; level < mesh->getLodCount(); level++)
+		{
+			mesh->getLod(level)->quantizeOctree();
+		}
+	}
+}
+
+size_t Model::getOctreeMemoryUsage()
+{
+	size_t bytes = 0;
+	for (Mesh * mesh : this->meshList)
+	{
+		for (uint32_t level = 0; level < mesh->getLodCount(); level++)
+		{
+			bytes += mesh->getLod(level)->getOctreeMemoryUsage();
+		}
+	}
+	return bytes;
+}
+
+size_t Model::getMemoryUsage() const
+{
+	size_t bytes = 0;
+	for (Mesh * mesh : this->meshList)
+	{
+		for (uint32_t level = 0; level < mesh->getLodCount(); level++)
+		{
+			bytes += mesh->getLod(level)->getMemoryUsage();
+		}
+	}
+	return bytes;
+}
+
 std::vector<Mesh*>& Model::getMeshList()
 {
 	return this->meshList;
 }
 
+const std::vector<MeshInstance> & Model::getInstanceList() const
+{
+	return this->instanceList;
+}
+
 AABB * Model::getModelBoundingBox()
 {
 	return this->modelBoundingBox;
 }
 
-void Model::processNode(aiNode * node, const aiScene * scene)
+void Model::addInstance(uint32_t meshIndex, const glm::mat4 & meshToModelMatrix)
 {
-	//Create a mesh object for all the meshes in this node
+	MeshInstance instance;
+	instance.meshIndex = meshIndex;
+	instance.meshToModelMatrix = meshToModelMatrix;
+	instance.modelToMeshMatrix = glm::inverse(meshToModelMatrix);
+	instance.identity = meshToModelMatrix == glm::mat4(1.0f);
+	this->instanceList.push_back(instance);
+}
+
+void Model::processNode(aiNode * node, const aiScene * scene, const glm::mat4 & parentTransform, std::vector<int32_t> & meshIndices)
+{
+	//Assimp matrices are row major so the node transformation is transposed into a column major glm matrix
+	glm::mat4 transform = parentTransform * glm::transpose(glm::make_mat4(&node->mTransformation.a1));
+
+	//Place an instance of every mesh in this node, converting the mesh only the first time a node references it
 	for (uint32_t i = 0; i < node->mNumMeshes; i++)
 	{
-		aiMesh *mesh = scene->mMeshes[node->mMeshes[i]];
-		meshList.push_back(processMesh(mesh, scene));
+		uint32_t sceneMeshIndex = node->mMeshes[i];
+		if (meshIndices[sceneMeshIndex] < 0)
+		{
+			meshIndices[sceneMeshIndex] = meshList.size();
+			meshList.push_back(processMesh(scene->mMeshes[sceneMeshIndex], scene));
+		}
+		addInstance(meshIndices[sceneMeshIndex], transform);
 	}
 
 	//Process the nodes for each of its children
 	for (uint32_t i = 0; i < node->mNumChildren; i++)
 	{
-		processNode(node->mChildren[i], scene);
+		processNode(node->mChildren[i], scene, transform, meshIndices);
 	}
 }
 
 Mesh * Model::processMesh(aiMesh * mesh, const aiScene * scene)
 {
 	Mesh * result = new Mesh();
+	result->vertices.reserve(mesh->mNumVertices);
+	result->normals.reserve(mesh->mNormals ? mesh->mNumVertices : 0);
+	result->textureCoords.reserve(mesh->mTextureCoords[0] ? mesh->mNumVertices : 0);
+	result->faces.reserve(mesh->mNumFaces);
 
 	for (uint32_t i = 0; i < mesh->mNumVertices; i++)
 	{
@@ -108,6 +324,7 @@ Mesh * Model::processMesh(aiMesh * mesh, const aiScene * scene)
 	{
 		aiFace face = mesh->mFaces[i];
 		Face resultFace;
+		resultFace.material = nullptr;
 		for (uint32_t j = 0; j < face.mNumIndices; j++)
 		{
 			resultFace.indices[j] = face.mIndices[j];
@@ -116,23 +333,29 @@ Mesh * Model::processMesh(aiMesh * mesh, const aiScene * scene)
 		result->faces.push_back(resultFace);
 	}
 
-	result->constructOctree();
-
 	return result;
 }
 
 void Model::calculateModelBoundingBox()
 {
-	if (meshList.size() <= 1)
+	//A single mesh at the origin of the model is bounded by the root of its octree
+	if (instanceList.empty() || (instanceList.size() == 1 && instanceList[0].identity))
 	{
 		return;
 	}
 
+	//The corners of the bounding box of each mesh are moved into the space of the model by its instances
 	std::vector<glm::vec3> pointsList;
-	for (Mesh * mesh : this->meshList)
+	for (const MeshInstance & instance : this->instanceList)
 	{
-		pointsList.push_back(mesh->boundingOctree->root->boundingBox->getMinAsPoint());
-		pointsList.push_back(mesh->boundingOctree->root->boundingBox->getMaxAsPoint());
+		AABB * meshBoundingBox = this->meshList[instance.meshIndex]->getBoundingBox();
+		glm::vec3 minPoint = meshBoundingBox->getMinAsPoint();
+		glm::vec3 maxPoint = meshBoundingBox->getMaxAsPoint();
+		for (uint32_t corner = 0; corner < 8; corner++)
+		{
+			glm::vec3 point((corner & 1) ? maxPoint.x : minPoint.x, (corner & 2) ? maxPoint.y : minPoint.y, (corner & 4) ? maxPoint.z : minPoint.z);
+			pointsList.push_back(instance.meshToModelMatrix * glm::vec4(point, 1.0f));
+		}
 	}
 
 	this->modelBoundingBox = AABB::calculateBoundingBox(pointsList);
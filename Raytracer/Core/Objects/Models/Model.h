@@ -6,6 +6,8 @@
 
 #include <assimp/scene.h> 
 
+class GeometryCache;
+
 class Model
 {
 public:
@@ -13,18 +15,57 @@ public:
 	Model(std::string path);
 	~Model();
 
+	//OBJ files are read with the native ObjLoader unless this is turned off, Assimp is used for every other format
+	static void setNativeObjLoading(bool enabled);
+	//Models loaded after this is turned on keep their meshes in the compact format, see Mesh::compact
+	static void setCompactMeshes(bool enabled);
+
+	//Models loaded after this is turned on replace their octrees with quantized ones, see QuantizedOctree
+	static void setQuantizeOctrees(bool enabled);
+	//Models imported after this is turned on build their octrees lazily as rays reach them, see Mesh::constructOctree
+	//Lazily built models are not written to the model cache since that would need their whole octrees
+	static void setLazyOctrees(bool enabled);
+
+	//Models loaded after this is set give each mesh up to this many coarser levels of detail, see Mesh::generateLods
+	static void setLodLevels(uint32_t levelCount);
+
+	//Models loaded after this is set stream their meshes out to the cache instead of compacting them, see Mesh::stream
+	static void setGeometryCache(GeometryCache * cache);
+
+	void compactMeshes();
+	void quantizeOctrees();
+	void streamMeshes();
+	//Bytes used by the geometry of every mesh in the model and their levels of detail
+	size_t getMemoryUsage() const;
+	size_t getOctreeMemoryUsage();
+
 	std::vector<Mesh*> & getMeshList();
+	const std::vector<MeshInstance> & getInstanceList() const;
 	AABB * getModelBoundingBox();
 
 private:
+	static bool nativeObjLoading;
+	static bool compactMeshStorage;
+	static bool quantizedOctreeStorage;
+	static bool lazyOctreeConstruction;
+	static uint32_t lodLevelCount;
+	static GeometryCache * geometryCache;
+
 	float scale;
 	float yawRotation;
 	float pitchRotation;
 	float rollRotation;
+	//Each mesh is stored once no matter how many nodes reference it, the instances place the meshes in the model
 	std::vector<Mesh*> meshList;
+	std::vector<MeshInstance> instanceList;
 	AABB* modelBoundingBox;
 
-	void processNode(aiNode * node, const aiScene * scene);
+	//Imports the model from its source file, optimizes its meshes, builds their octrees and writes the model cache file
+	bool importModel(const std::string & path);
+	void addInstance(uint32_t meshIndex, const glm::mat4 & meshToModelMatrix);
+
+	//The mesh indices map each mesh of the scene to its index in the mesh list, or -1 if no node has referenced it yet
+	void processNode(aiNode * node, const aiScene * scene, const glm::mat4 & parentTransform, std::vector<int32_t> & meshIndices);
 	Mesh * processMesh(aiMesh *mesh, const aiScene * scene);
 
 	void calculateModelBoundingBox();
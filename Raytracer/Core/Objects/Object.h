@@ -5,23 +5,40 @@
 
 class Ray;
 class Material;
-struct Face;
 
 struct IntersectionData
 {
-	uint32_t meshIndex;
-	Face * face;
+	//Index of the mesh instance hit for objects made up of models
+	uint32_t instanceIndex;
+	//Index of the face hit in the mesh of the instance
+	uint32_t faceIndex;
+	//Level of detail of the mesh the face index belongs to
+	uint32_t lodLevel;
+	//Index of the primitive hit for objects made up of many simple primitives, such as a SphereSet
+	uint32_t primitiveIndex;
 };
 
 class Object
 {
 public:
+	//Objects are deleted through the object list, so the entities SceneCompiler replaces are destroyed as what they are
+	virtual ~Object() {}
+
 	//This intersection test it meant to be a rough but fast test
 	virtual bool possibleIntersection(const Ray & ray, float & parameter) = 0;
 	//This intersection test gives a definitive intersection of the object
 	virtual bool intersect(const Ray & ray, float & parameter, IntersectionData & intersectionData) = 0;
 
 	virtual void getSurfaceData(const glm::vec3 & intersectionPoint, const IntersectionData & intersectionData, glm::vec3 & normal, glm::vec2 & textureCoords, Material *& material) = 0;
+	//Gives the texture coordinates at a point on the surface that was hit, points slightly off the hit primitive are extrapolated so texture coordinate differentials can be found
+	virtual glm::vec2 getTextureCoordinates(const glm::vec3 & point, const IntersectionData & intersectionData) = 0;
+
+	//Objects that are still loading are drawn as a stand in, the renderer draws again every tile whose rays reached one once it has loaded
+	virtual bool isLoading() { return false; }
+	//Switches from the stand in to the loaded object if loading has finished, waiting for it when asked to, returns true if the object is loaded
+	virtual bool finishLoading(bool /*wait*/) { return true; }
+	//Box around the object in world space that the scene BVH is built from, returns false if the object could be anywhere and has to be tested by every ray
+	virtual bool getBounds(glm::vec3 & minPoint, glm::vec3 & maxPoint) = 0;
 	
 	Material * getMaterial();
 
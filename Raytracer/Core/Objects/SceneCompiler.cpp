@@ -0,0 +1,145 @@
+#include "SceneCompiler.h"
+
+#include "Entity.h"
+#include "Models/Model.h"
+#include "Models/Mesh.h"
+#include "Models/MeshOptimizer.h"
+#include "../Geometry/AABB.h"
+
+#include <glm/matrix.hpp>
+#include <glm/geometric.hpp>
+
+#include <cstdio>
+
+//A ray hits a box about in proportion to its surface area, so an entity is only baked if the box around it in world space is not much larger than the box it was culled with
+//Rotated entities such as a diagonal straw can have world space boxes several times larger, so more rays would reach their octrees than before
+constexpr float MAX_BOUNDS_AREA_RATIO = 1.1f;
+
+static float getSurfaceArea(const glm::vec3 & size)
+{
+	return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+}
+
+SceneCompiler::SceneCompiler(uint32_t triangleThreshold) : triangleThreshold(triangleThreshold)
+{
+}
+
+SceneCompiler::~SceneCompiler()
+{
+	for (uint32_t i = 0; i < this->bakedModels.size(); i++)
+	{
+		delete this->bakedModels[i];
+	}
+}
+
+void SceneCompiler::flattenStaticEntities(std::vector<Object*> & objectList)
+{
+	uint32_t bakedEntities = 0;
+	uint32_t bakedFaces = 0;
+	size_t bakedBytes = 0;
+	for (uint32_t i = 0; i < objectList.size(); i++)
+	{
+		Entity * entity = dynamic_cast<Entity*>(objectList[i]);
+		if (!entity || entity->isLoading() || !entity->getModel() || entity->isAnimated())
+		{
+			continue;
+		}
+
+		Entity * bakedEntity = bakeEntity(entity);
+		if (bakedEntity)
+		{
+			Model * bakedModel = bakedEntity->getModel();
+			bakedEntities++;
+			bakedFaces += bakedModel->getMeshList()[0]->getFaceCount();
+			bakedBytes += bakedModel->getMemoryUsage() + bakedModel->getOctreeMemoryUsage();
+			objectList[i] = bakedEntity;
+			delete entity;
+		}
+	}
+
+	printf("Flattened %u entities into world space: %u faces, %.1f KB\n", bakedEntities, bakedFaces, bakedBytes / 1024.0);
+}
+
+Entity * SceneCompiler::bakeEntity(Entity * entity)
+{
+	Model * model = entity->getModel();
+	uint32_t faceCount = 0;
+	for (const MeshInstance & instance : model->getInstanceList())
+	{
+		faceCount += model->getMeshList()[instance.meshIndex]->getFaceCount();
+	}
+	if (faceCount == 0 || faceCount > this->triangleThreshold)
+	{
+		return nullptr;
+	}
+
+	//The baked mesh has normals and texture coordinates for every vertex or for none, so the meshes of the model have to agree on them
+	Mesh * firstMesh = model->getMeshList()[model->getInstanceList()[0].meshIndex];
+	bool hasNormals = firstMesh->hasNormals();
+	bool hasTextureCoords = firstMesh->hasTextureCoords();
+	for (const MeshInstance & instance : model->getInstanceList())
+	{
+		Mesh * mesh = model->getMeshList()[instance.meshIndex];
+		if (mesh->hasNormals() != hasNormals || mesh->hasTextureCoords() != hasTextureCoords)
+		{
+			return nullptr;
+		}
+	}
+
+	Mesh * bakedMesh = new Mesh();
+	bakedMesh->vertices.reserve(faceCount * 3);
+	bakedMesh->normals.reserve(hasNormals ? faceCount * 3 : 0);
+	bakedMesh->textureCoords.reserve(hasTextureCoords ? faceCount * 3 : 0);
+	bakedMesh->faces.reserve(faceCount);
+	for (const MeshInstance & instance : model->getInstanceList())
+	{
+		Mesh * mesh = model->getMeshList()[instance.meshIndex];
+		//Positions go through the transforms a ray would take in reverse, normals are the ones Entity::getSurfaceData gives before normalizing
+		glm::mat4 meshToWorldMatrix = entity->getLocalToWorldMatrix() * instance.meshToModelMatrix;
+		glm::mat3 normalMatrix = glm::mat3(entity->getLocalToWorldMatrix()) * glm::transpose(glm::mat3(instance.modelToMeshMatrix));
+
+		//Every corner of a face gets its own vertex since compacted and streamed meshes do not share vertices across clusters, MeshOptimizer welds them again
+		for (uint32_t face = 0; face < mesh->getFaceCount(); face++)
+		{
+			uint32_t indices[3];
+			mesh->getFaceVertexIndices(face, indices);
+			Face bakedFace;
+			bakedFace.material = mesh->getFaceMaterial(face);
+			for (uint32_t corner = 0; corner < 3; corner++)
+			{
+				bakedFace.indices[corner] = bakedMesh->vertices.size();
+				bakedMesh->vertices.push_back(glm::vec3(meshToWorldMatrix * glm::vec4(mesh->getVertex(indices[corner]), 1.0f)));
+				if (hasNormals)
+				{
+					bakedMesh->normals.push_back(normalMatrix * mesh->getNormal(indices[corner]));
+				}
+				if (hasTextureCoords)
+				{
+					bakedMesh->textureCoords.push_back(mesh->getTextureCoord(indices[corner]));
+				}
+			}
+			bakedMesh->faces.push_back(bakedFace);
+		}
+	}
+
+	//The entity was culled with the bounds of its model turned with it, each side scaled by the entity
+	AABB * localBoundingBox = model->getModelBoundingBox() ? model->getModelBoundingBox() : firstMesh->getBoundingBox();
+	const glm::mat4 & localToWorldMatrix = entity->getLocalToWorldMatrix();
+	glm::vec3 scale(glm::length(glm::vec3(localToWorldMatrix[0])), glm::length(glm::vec3(localToWorldMatrix[1])), glm::length(glm::vec3(localToWorldMatrix[2])));
+	float localArea = getSurfaceArea(2.0f * localBoundingBox->getHalfDistances() * scale);
+	AABB * worldBoundingBox = AABB::calculateBoundingBox(bakedMesh->vertices.data(), bakedMesh->vertices.size());
+	float worldArea = getSurfaceArea(2.0f * worldBoundingBox->getHalfDistances());
+	delete worldBoundingBox;
+	if (worldArea > localArea * MAX_BOUNDS_AREA_RATIO)
+	{
+		delete bakedMesh;
+		return nullptr;
+	}
+
+	MeshOptimizer::optimize(bakedMesh);
+	bakedMesh->constructOctree();
+	Model * bakedModel = new Model(bakedMesh);
+	this->bakedModels.push_back(bakedModel);
+	//The baked entity keeps the material of the entity, so it shades and casts shadows the same way
+	return new Entity(glm::vec3(0.0f, 0.0f, 0.0f), 1.0f, bakedModel, entity->getMaterial());
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+class Object;
+class Model;
+class Entity;
+
+//Scene compile step run once every model has loaded, before rendering
+//Small entities get a copy of their model baked into world space, placed at the origin so a ray tests it without being converted into the space of the entity and back
+//Each baked entity keeps its own octree, merging them would put large faces such as floors into every leaf of one shared octree
+//Large entities stay instanced since a baked copy would store their geometry again for every entity using the model
+//A baked entity is still one object of the list with its own box in the scene BVH, its faces are not moved into the BVH itself
+//What is saved is converting rays into the space of the entity and back, which is only a small part of tracing, so on the sample scene render times stay within noise
+class SceneCompiler
+{
+public:
+	//Entities whose models have at most this many faces across all their instances are baked
+	SceneCompiler(uint32_t triangleThreshold);
+	//Deletes the models holding the baked meshes, so the compiler has to outlive any render of the compiled scene
+	~SceneCompiler();
+
+	//Replaces the small entities in the list with baked ones in the same place in the list, the replaced entities are deleted
+	//Entities that are still loading or are animated are left as they are
+	void flattenStaticEntities(std::vector<Object*> & objectList);
+
+private:
+	uint32_t triangleThreshold;
+	std::vector<Model*> bakedModels;
+
+	//Returns the baked copy of the entity, or null if it has too many faces or its meshes can not be combined
+	Entity * bakeEntity(Entity * entity);
+};
\ No newline at end of file
@@ -1,6 +1,9 @@
 #include "Camera.h"
 
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/common.hpp>
+
+#include <algorithm>
 
 Camera::Camera(float aspect) : Camera(glm::vec3(0.0f, 0.0f, 0.0f), 0.0f, 0.0f, 90.0f, aspect)
 {
@@ -20,10 +23,16 @@ glm::vec3 Camera::convertCameraSpaceToWorldSpace(const glm::vec3 cameraPoint)
 	return this->cameraToWorldSpaceMatrix * glm::vec4(cameraPoint, 1.0f);
 }
 
+glm::vec3 Camera::convertWorldSpaceToCameraSpace(const glm::vec3 worldPoint)
+{
+	return this->worldToCameraSpaceMatrix * glm::vec4(worldPoint, 1.0f);
+}
+
 void Camera::calculateCameraToWorldSpaceMatrix()
 {
 	//Computes the camera to world space matrix by taking the inverse of the world to camera space view matrix
-	this->cameraToWorldSpaceMatrix = glm::inverse(getViewMatrix());
+	this->worldToCameraSpaceMatrix = getViewMatrix();
+	this->cameraToWorldSpaceMatrix = glm::inverse(this->worldToCameraSpaceMatrix);
 }
 
 glm::mat4 Camera::getViewMatrix()
@@ -51,3 +60,42 @@ float Camera::getFieldOfView()
 {
 	return fov;
 }
+
+void Camera::addKeyframe(float time, const glm::vec3 & position, float yaw, float pitch)
+{
+	Keyframe keyframe;
+	keyframe.time = time;
+	keyframe.position = position;
+	keyframe.yaw = yaw;
+	keyframe.pitch = pitch;
+	//Keyframes are kept sorted by time so getPoseAtTime can search them
+	auto next = std::upper_bound(this->keyframes.begin(), this->keyframes.end(), time, [](float keyTime, const Keyframe & other) { return keyTime < other.time; });
+	this->keyframes.insert(next, keyframe);
+}
+
+bool Camera::isAnimated() const
+{
+	return !this->keyframes.empty();
+}
+
+Camera::Keyframe Camera::getPoseAtTime(float time) const
+{
+	auto next = std::upper_bound(this->keyframes.begin(), this->keyframes.end(), time, [](float keyTime, const Keyframe & other) { return keyTime < other.time; });
+	const Keyframe & after = next == this->keyframes.end() ? this->keyframes.back() : *next;
+	const Keyframe & before = next == this->keyframes.begin() ? this->keyframes.front() : *(next - 1);
+	float blend = after.time > before.time ? (time - before.time) / (after.time - before.time) : 0.0f;
+
+	Keyframe pose;
+	pose.time = time;
+	pose.position = glm::mix(before.position, after.position, blend);
+	pose.yaw = glm::mix(before.yaw, after.yaw, blend);
+	pose.pitch = glm::mix(before.pitch, after.pitch, blend);
+	return pose;
+}
+
+void Camera::setPose(const Keyframe & pose)
+{
+	this->origin = pose.position;
+	this->yaw = pose.yaw;
+	this->pitch = pose.pitch;
+}
@@ -3,15 +3,28 @@
 #include <glm/vec3.hpp>
 #include <glm/mat4x4.hpp>
 
+#include <vector>
+
 class Camera
 {
 public:
+	//Pose of an animated camera at a point in time, rotations are in degrees
+	struct Keyframe
+	{
+		float time;
+		glm::vec3 position;
+		float yaw;
+		float pitch;
+	};
+
 	Camera(float aspect);
 	Camera(glm::vec3 position, float y, float p, float fieldOfView, float aspect);
 
 	glm::vec3 getOrigin();
 
 	glm::vec3 convertCameraSpaceToWorldSpace(glm::vec3 cameraPoint);
+	//Points in front of the camera have a positive z in camera space, the image plane is at a z of 1
+	glm::vec3 convertWorldSpaceToCameraSpace(glm::vec3 worldPoint);
 
 	void calculateCameraToWorldSpaceMatrix();
 	glm::mat4 getViewMatrix();
@@ -20,8 +33,17 @@ public:
 
 	float getFieldOfView();
 
+	//Keyframes can be added in any order, they are interpolated linearly and the first and last pose are held outside of them
+	void addKeyframe(float time, const glm::vec3 & position, float yaw, float pitch);
+	bool isAnimated() const;
+	Keyframe getPoseAtTime(float time) const;
+	//The camera to world space matrix has to be calculated again afterwards, which Renderer::render does
+	void setPose(const Keyframe & pose);
+
 private:
+	std::vector<Keyframe> keyframes;
 	glm::mat4 cameraToWorldSpaceMatrix;
+	glm::mat4 worldToCameraSpaceMatrix;
 	glm::vec3 origin;
 	float yaw;
 	float pitch;
@@ -0,0 +1,182 @@
+#include "FramePipeline.h"
+
+#include "Renderer.h"
+#include "Image.h"
+#include "../Memory/MemoryTracker.h"
+
+#include <chrono>
+#include <cstdio>
+
+FramePipeline::FramePipeline(Renderer & renderer, Camera & camera, std::vector<Object*> & objectList, std::vector<Light*> & lightList, uint32_t width, uint32_t height, uint32_t framesPerSecond)
+	: renderer(renderer), camera(camera), objectList(objectList), lightList(lightList), width(width), height(height), framesPerSecond(framesPerSecond), temporalReuse(false), refreshFraction(0.0f), workers(2)
+{
+	for (Object * object : objectList)
+	{
+		Entity * entity = dynamic_cast<Entity*>(object);
+		if (entity && entity->isAnimated())
+		{
+			this->poseIndices[entity] = this->animatedEntities.size();
+			this->animatedEntities.push_back(entity);
+		}
+	}
+	MemoryTracker::allocated(MemoryCategory::Framebuffer, 0, width * height * sizeof(glm::vec3));
+	this->writeFramebuffer.resize(width * height);
+}
+
+FramePipeline::~FramePipeline()
+{
+	MemoryTracker::released(MemoryCategory::Framebuffer, 0, width * height * sizeof(glm::vec3));
+}
+
+void FramePipeline::setTemporalReuse(float refreshFraction)
+{
+	this->temporalReuse = true;
+	this->refreshFraction = refreshFraction;
+}
+
+void FramePipeline::run(uint32_t firstFrame, uint32_t lastFrame)
+{
+	auto startTime = std::chrono::high_resolution_clock::now();
+	double totalUpdateTime = 0.0;
+	double totalRenderTime = 0.0;
+	double totalWriteTime = 0.0;
+	//Time the render stage spent waiting for the other two stages
+	double totalWaitTime = 0.0;
+	uint32_t rebuilds = 0;
+	double totalReusedFraction = 0.0;
+	std::vector<double> renderTimes;
+
+	SceneBVH firstBVH = this->renderer.getSceneBVH();
+	std::future<PreparedFrame> nextFrame = this->workers.submit([this, firstFrame, firstBVH]() { return prepareFrame(firstFrame, firstBVH); });
+	std::future<double> frameWritten;
+	for (uint32_t frame = firstFrame; frame <= lastFrame; frame++)
+	{
+		auto waitStartTime = std::chrono::high_resolution_clock::now();
+		PreparedFrame prepared = nextFrame.get();
+		auto waitEndTime = std::chrono::high_resolution_clock::now();
+		totalWaitTime += std::chrono::duration<double, std::milli>(waitEndTime - waitStartTime).count();
+		applyFrame(prepared);
+		totalUpdateTime += prepared.updateTime;
+		rebuilds += prepared.rebuilt;
+
+		//The next frame is prepared from the BVH of this one while it renders
+		if (frame < lastFrame)
+		{
+			SceneBVH currentBVH = this->renderer.getSceneBVH();
+			uint32_t next = frame + 1;
+			nextFrame = this->workers.submit([this, next, currentBVH]() { return prepareFrame(next, currentBVH); });
+		}
+
+		auto renderStartTime = std::chrono::high_resolution_clock::now();
+		float reusedFraction = 0.0f;
+		if (this->temporalReuse)
+		{
+			reusedFraction = this->renderer.renderTemporal(this->camera, this->objectList, this->lightList, this->refreshFraction);
+		}
+		else
+		{
+			this->renderer.render(this->camera, this->objectList, this->lightList);
+		}
+		auto renderEndTime = std::chrono::high_resolution_clock::now();
+		double renderTime = std::chrono::duration<double, std::milli>(renderEndTime - renderStartTime).count();
+		totalRenderTime += renderTime;
+		totalReusedFraction += reusedFraction;
+		renderTimes.push_back(renderTime);
+
+		//The framebuffers can only be swapped once the last frame has been written out of the second one
+		if (frameWritten.valid())
+		{
+			totalWriteTime += frameWritten.get();
+			totalWaitTime += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - renderEndTime).count();
+		}
+		this->renderer.swapFramebuffer(this->writeFramebuffer);
+		frameWritten = this->workers.submit([this, frame]() { return writeFrame(frame); });
+
+		printf("Frame %u: update %.3f ms (%s, BVH cost %.2f), render %.2f sec", frame, prepared.updateTime, prepared.rebuilt ? "rebuilt" : "refit", this->renderer.getSceneBVH().getCost(), renderTime / 1000.0);
+		if (this->temporalReuse)
+		{
+			printf(", reused %.1f%% of pixels", 100.0 * reusedFraction);
+		}
+		printf("\n");
+	}
+	totalWriteTime += frameWritten.get();
+	auto endTime = std::chrono::high_resolution_clock::now();
+
+	uint32_t frameCount = lastFrame - firstFrame + 1;
+	double elapsedTime = std::chrono::duration<double, std::milli>(endTime - startTime).count();
+	printf("Rendered %u frames in %.2f sec, %.2f sec per frame: update %.3f ms, render %.2f sec, write %.1f ms per frame, BVH rebuilt %u times\n", frameCount, elapsedTime / 1000.0, elapsedTime / 1000.0 / frameCount, totalUpdateTime / frameCount, totalRenderTime / 1000.0 / frameCount, totalWriteTime / frameCount, rebuilds);
+	printf("Render stage busy %.1f%% of the sequence, waited %.1f ms for the update and write stages\n", 100.0 * totalRenderTime / elapsedTime, totalWaitTime);
+	if (this->temporalReuse && frameCount > 1)
+	{
+		//The first frame also decodes textures and builds octrees, so the speed up is measured against the last frame rendered again in full once everything is warm
+		auto fullStartTime = std::chrono::high_resolution_clock::now();
+		this->renderer.render(this->camera, this->objectList, this->lightList);
+		double fullFrameTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - fullStartTime).count();
+		printf("Full render of frame %u: %.2f sec, its temporal render %.2f sec, %.2fx the speed\n", lastFrame, fullFrameTime / 1000.0, renderTimes.back() / 1000.0, fullFrameTime / renderTimes.back());
+		printf("Speed of each frame against the full render:");
+		for (uint32_t i = 0; i < frameCount; i++)
+		{
+			printf(" %.2fx", fullFrameTime / renderTimes[i]);
+		}
+		printf("\n");
+		double reusedRenderTime = totalRenderTime - renderTimes[0];
+		printf("Temporal reuse: %.1f%% of pixels reused after the first frame, %.2fx the speed of a full render\n", 100.0 * totalReusedFraction / (frameCount - 1), fullFrameTime * (frameCount - 1) / reusedRenderTime);
+	}
+}
+
+FramePipeline::PreparedFrame FramePipeline::prepareFrame(uint32_t frame, const SceneBVH & currentBVH)
+{
+	auto startTime = std::chrono::high_resolution_clock::now();
+	PreparedFrame prepared;
+	prepared.frame = frame;
+	float time = frame / (float)this->framesPerSecond;
+	prepared.poses.reserve(this->animatedEntities.size());
+	for (Entity * entity : this->animatedEntities)
+	{
+		prepared.poses.push_back(entity->getPoseAtTime(time));
+	}
+	if (this->camera.isAnimated())
+	{
+		prepared.cameraPose = this->camera.getPoseAtTime(time);
+	}
+
+	//Animated entities are boxed in the pose they will have, everything else is where it is now
+	prepared.sceneBVH = currentBVH;
+	const std::vector<Entity::Keyframe> & poses = prepared.poses;
+	prepared.rebuilt = prepared.sceneBVH.update(this->objectList, [this, &poses](Object * object, glm::vec3 & minPoint, glm::vec3 & maxPoint)
+	{
+		auto poseIndex = this->poseIndices.find(object);
+		if (poseIndex != this->poseIndices.end())
+		{
+			return this->animatedEntities[poseIndex->second]->getBounds(poses[poseIndex->second], minPoint, maxPoint);
+		}
+		return object->getBounds(minPoint, maxPoint);
+	});
+	prepared.updateTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+	return prepared;
+}
+
+void FramePipeline::applyFrame(PreparedFrame & prepared)
+{
+	for (uint32_t i = 0; i < this->animatedEntities.size(); i++)
+	{
+		this->animatedEntities[i]->setPose(prepared.poses[i]);
+	}
+	if (this->camera.isAnimated())
+	{
+		this->camera.setPose(prepared.cameraPose);
+	}
+	this->renderer.swapSceneBVH(prepared.sceneBVH);
+}
+
+double FramePipeline::writeFrame(uint32_t frame)
+{
+	auto startTime = std::chrono::high_resolution_clock::now();
+	char path[64];
+	snprintf(path, sizeof(path), "./frame_%04u.ppm", frame);
+	{
+		Image image(path, this->width, this->height);
+		image.writeFramebufferToImage(this->writeFramebuffer);
+	}
+	return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+}
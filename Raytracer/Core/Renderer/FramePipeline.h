@@ -0,0 +1,66 @@
+#pragma once
+
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include <glm/vec3.hpp>
+
+#include "Camera.h"
+#include "../Objects/Entity.h"
+#include "../DataStructures/SceneBVH.h"
+#include "../Threading/ThreadPool.h"
+
+class Renderer;
+class Light;
+
+//Renders a sequence of frames of the animated entities and camera of the scene with the stages of neighbouring frames overlapped
+//While frame N renders, frame N+1 is posed and its scene BVH refit on one worker thread and frame N-1 is written out on another
+//The next frame is prepared on copies that are only swapped in between renders, and a finished frame is handed to the writer by swapping framebuffers
+//Only one frame is prepared and one written at a time, so the render stage only waits if one of them takes longer than a render
+class FramePipeline
+{
+public:
+	FramePipeline(Renderer & renderer, Camera & camera, std::vector<Object*> & objectList, std::vector<Light*> & lightList, uint32_t width, uint32_t height, uint32_t framesPerSecond);
+	~FramePipeline();
+
+	//Renders every frame after the first with Renderer::renderTemporal, reusing the pixels of the frame before
+	void setTemporalReuse(float refreshFraction);
+
+	//Renders the frames from first to last, writing each to ./frame_NNNN.ppm, and prints the time spent in each stage
+	void run(uint32_t firstFrame, uint32_t lastFrame);
+
+private:
+	//Poses and scene BVH of a frame, made without touching the scene the render stage is tracing through
+	struct PreparedFrame
+	{
+		uint32_t frame;
+		std::vector<Entity::Keyframe> poses;
+		Camera::Keyframe cameraPose;
+		SceneBVH sceneBVH;
+		bool rebuilt;
+		double updateTime;
+	};
+
+	Renderer & renderer;
+	Camera & camera;
+	std::vector<Object*> & objectList;
+	std::vector<Light*> & lightList;
+	uint32_t width;
+	uint32_t height;
+	uint32_t framesPerSecond;
+	bool temporalReuse;
+	float refreshFraction;
+	std::vector<Entity*> animatedEntities;
+	//Index of each animated entity in the poses of a prepared frame
+	std::unordered_map<Object*, uint32_t> poseIndices;
+	//The second framebuffer, holding the last rendered frame while it is written out
+	std::vector<glm::vec3> writeFramebuffer;
+	ThreadPool workers;
+
+	//Runs on a worker thread, the BVH is a copy of the one the current frame renders with
+	PreparedFrame prepareFrame(uint32_t frame, const SceneBVH & currentBVH);
+	//Runs on the render thread between renders
+	void applyFrame(PreparedFrame & prepared);
+	//Runs on a worker thread and returns the time it took in milliseconds
+	double writeFrame(uint32_t frame);
+};
\ No newline at end of file
@@ -4,67 +4,525 @@
 #include <stb_image.h>
 
 #include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+
+#include <glm/geometric.hpp>
+#include <glm/matrix.hpp>
+
+#include "../../Math/MathFunctions.h"
+#include "TextureCache.h"
+#include "../../Threading/ThreadPool.h"
 
 constexpr float CONVERSION_FACTOR_255 = 0.00392157f;
+constexpr unsigned BYTES_PER_PIXEL = STBI_rgb_alpha;
 
-ImageLoader::ImageLoader()
+ImageLoader::ImageLoader() : textureCount(0), compressTextures(false), textureCache(nullptr), decodePool(nullptr)
 {
+	loadedTextures = new Texture2D[MAX_TEXTURES];
+	loadStates = new TextureLoadState[MAX_TEXTURES];
+	texturePaths = new std::string[MAX_TEXTURES];
 	//Load the missing texture image to first to occupy index 0 o the loadedTextures list
 	loadTexture("Resources/Textures/missing_texture.png");
 }
 
+ImageLoader::~ImageLoader()
+{
+	//Deleting the pool waits for the decodes that are still queued since they write into the texture table
+	delete decodePool;
+	delete textureCache;
+	delete[] loadedTextures;
+	delete[] loadStates;
+	delete[] texturePaths;
+}
+
 int32_t ImageLoader::loadTexture(const char * path)
 {
-	int width, height;
+	std::lock_guard<std::mutex> lock(registryMutex);
 
-	unsigned char* image = stbi_load(path, &width, &height, 0, STBI_rgb_alpha);
+	//Looks up the path in the registry to ensure that a texture at the same path is not loaded again
+	auto existing = textureRegistry.find(path);
+	if (existing != textureRegistry.end())
+	{
+		return existing->second;
+	}
 
-	if (image == nullptr)
+	//Only the header of the image is read so a bad path is still caught here without decoding the image
+	int width, height, channels;
+	if (!stbi_info(path, &width, &height, &channels))
 	{
 		std::cout << "WARNING: Could not find image at path: " << path << std::endl;
 		//this returns the image id for the missing texture image located at loadedTextures[0]
 		return 0;
 	}
 
-	//Loops through all the textures to ensure that a texture at the same path is not loaded again
-	for (uint32_t i = 0; i < loadedTextures.size(); i++)
+	if (this->textureCount.load(std::memory_order_relaxed) == MAX_TEXTURES)
 	{
-		Texture2D texture = loadedTextures[i];
-		if (std::strcmp(texture.path.c_str(), path) == 0)
-		{
-			return i;
-		}
+		std::cout << "WARNING: Texture table is full, could not load image at path: " << path << std::endl;
+		return 0;
 	}
 
-	//Sets the current texture id to the current size of the list because this index is where the texture will be stored
-	int32_t textureID = this->loadedTextures.size();
-	//Creates the texture
-	Texture2D texture;
-	texture.image = image;
-	texture.width = width;
-	texture.height = height;
+	//Sets the current texture id to the current number of textures because this index is where the texture will be stored
+	int32_t textureID = this->textureCount.load(std::memory_order_relaxed);
+	Texture2D & texture = this->loadedTextures[textureID];
+	texture.format = compressTextures ? TextureFormat::BC1 : TextureFormat::RGBA8;
+	texture.cacheID = -1;
+
+	TextureLoadState & loadState = this->loadStates[textureID];
+	loadState.decoded = false;
+	loadState.width = width;
+	loadState.height = height;
+
 	//Stores the path of the image so that it can be used to make sure textures are not repeated
-	texture.path = std::string(path);
-	//Adds the textures into the loadedTextures list
-	this->loadedTextures.push_back(texture);
+	this->texturePaths[textureID] = path;
+	this->textureRegistry[this->texturePaths[textureID]] = textureID;
+	this->textureCount.store(textureID + 1, std::memory_order_release);
 
 	//Return the index location in the list of the loaded texture
 	return textureID;
 }
 
+void ImageLoader::prefetchTexture(int32_t textureID)
+{
+	if (loadStates[textureID].decoded)
+	{
+		return;
+	}
+
+	if (decodePool == nullptr)
+	{
+		decodePool = new ThreadPool();
+	}
+	decodePool->submit([this, textureID]() { getDecodedTexture(textureID); });
+}
+
+Texture2D & ImageLoader::getDecodedTexture(int32_t textureID)
+{
+	TextureLoadState & loadState = loadStates[textureID];
+	//Only the first caller decodes the texture, any other thread sampling it at the same time waits for the decode to finish
+	if (!loadState.decoded.load(std::memory_order_acquire))
+	{
+		std::call_once(loadState.decodeFlag, &ImageLoader::decodeTexture, this, textureID);
+	}
+
+	//A texture that could not be decoded is drawn with the missing texture
+	Texture2D & texture = loadedTextures[textureID];
+	if (texture.levels.empty() && textureID != 0)
+	{
+		return getDecodedTexture(0);
+	}
+	return texture;
+}
+
+void ImageLoader::decodeTexture(int32_t textureID)
+{
+	Texture2D & texture = loadedTextures[textureID];
+	const char * path = texturePaths[textureID].c_str();
+	MemoryTracker::AssetScope assetScope(texturePaths[textureID]);
+
+	//An up to date cache file lets the texture be used without decoding the image at all
+	if (textureCache != nullptr)
+	{
+		texture.cacheID = textureCache->openTexture(path, texture);
+	}
+
+	if (texture.cacheID < 0)
+	{
+		int width, height;
+		unsigned char* image = stbi_load(path, &width, &height, 0, STBI_rgb_alpha);
+
+		if (image == nullptr)
+		{
+			std::cout << "WARNING: Could not decode image at path: " << path << std::endl;
+			loadStates[textureID].decoded.store(true, std::memory_order_release);
+			return;
+		}
+
+		//Creates the texture with the decoded image as the first level of the mip chain
+		generateMipLevels(width, height, image, texture);
+		stbi_image_free(image);
+
+		//Moves the texels out to the cache file so the texture only takes up memory for the pages that are sampled
+		if (textureCache != nullptr)
+		{
+			texture.cacheID = textureCache->addTexture(path, texture);
+			for (uint32_t i = 0; texture.cacheID >= 0 && i < texture.levels.size(); i++)
+			{
+				HugePageVector<unsigned char, MemoryCategory::Textures>().swap(texture.levels[i].texels);
+			}
+		}
+	}
+
+	loadStates[textureID].decoded.store(true, std::memory_order_release);
+}
+
+void ImageLoader::setCompressTextures(bool compress)
+{
+	this->compressTextures = compress;
+}
+
+void ImageLoader::enableTextureCache(const char * directory, size_t budgetBytes)
+{
+	if (textureCache == nullptr)
+	{
+		textureCache = new TextureCache(directory, budgetBytes);
+	}
+}
+
 glm::vec3 ImageLoader::getColorAtTextureUV(int32_t textureID, float u, float v)
 {
-	Texture2D texture = this->loadedTextures[textureID];
+	return sampleBilinear(getDecodedTexture(textureID), 0, u, v);
+}
+
+const Texture2D & ImageLoader::getTexture(int32_t textureID)
+{
+	return getDecodedTexture(textureID);
+}
+
+const std::string & ImageLoader::getTexturePath(int32_t textureID) const
+{
+	return this->texturePaths[textureID];
+}
+
+size_t ImageLoader::getTextureMemoryUsage(int32_t textureID) const
+{
+	size_t bytes = 0;
+	for (const TextureLevel & level : this->loadedTextures[textureID].levels)
+	{
+		bytes += level.texels.capacity();
+	}
+	return bytes;
+}
+
+void ImageLoader::printStatistics() const
+{
+	size_t totalBytes = 0;
+	size_t totalUncompressedBytes = 0;
+	std::cout << "Texture memory:" << std::endl;
+	uint32_t count = textureCount.load(std::memory_order_acquire);
+	for (uint32_t i = 0; i < count; i++)
+	{
+		const Texture2D & texture = loadedTextures[i];
+		size_t bytes = getTextureMemoryUsage(i);
+		//Size the texture would take up as tiled RGBA8
+		size_t uncompressedBytes = 0;
+		for (const TextureLevel & level : texture.levels)
+		{
+			uncompressedBytes += level.tilesX * level.tilesY * TEXTURE_TILE_SIZE * TEXTURE_TILE_SIZE * BYTES_PER_PIXEL;
+		}
+		totalBytes += bytes;
+		totalUncompressedBytes += uncompressedBytes;
+		const char * status = !loadStates[i].decoded ? " not decoded" : (texture.cacheID >= 0 ? " cached" : "");
+		printf("  %-40s %5s %5dx%-5d %10.1f KB (RGBA8 %.1f KB)%s\n", texturePaths[i].c_str(), texture.format == TextureFormat::BC1 ? "BC1" : "RGBA8", loadStates[i].width, loadStates[i].height, bytes / 1024.0, uncompressedBytes / 1024.0, status);
+	}
+	if (totalBytes > 0)
+	{
+		printf("  Total %.1f KB, %.2fx smaller than RGBA8\n", totalBytes / 1024.0, totalUncompressedBytes / (double)totalBytes);
+	}
+
+	if (textureCache != nullptr)
+	{
+		textureCache->printStatistics();
+	}
+}
+
+glm::vec3 ImageLoader::getColorAtTextureUV(int32_t textureID, const glm::vec2 & textureCoords, const glm::vec2 & textureCoordsDx, const glm::vec2 & textureCoordsDy)
+{
+	const Texture2D & texture = getDecodedTexture(textureID);
+	const TextureLevel & baseLevel = texture.levels[0];
+
+	//Find the size of the pixel footprint in texels of the full resolution level
+	glm::vec2 texelsDx = textureCoordsDx * glm::vec2(baseLevel.width, baseLevel.height);
+	glm::vec2 texelsDy = textureCoordsDy * glm::vec2(baseLevel.width, baseLevel.height);
+	float footprint = std::max(glm::dot(texelsDx, texelsDx), glm::dot(texelsDy, texelsDy));
+	if (footprint <= 1.0f)
+	{
+		return sampleBilinear(texture, 0, textureCoords.x, textureCoords.y);
+	}
+
+	//Each mip level halves the resolution so the level of detail is the log2 of the footprint size, which is half the log2 of its square
+	float levelOfDetail = std::min(0.5f * log2f(footprint), (float)(texture.levels.size() - 1));
+	uint32_t lowerLevel = (uint32_t)levelOfDetail;
+	uint32_t upperLevel = std::min(lowerLevel + 1, (uint32_t)texture.levels.size() - 1);
+	float levelMix = levelOfDetail - lowerLevel;
+
+	glm::vec3 lowerColor = sampleBilinear(texture, lowerLevel, textureCoords.x, textureCoords.y);
+	if (upperLevel == lowerLevel || levelMix <= 0.0f)
+	{
+		return lowerColor;
+	}
+	glm::vec3 upperColor = sampleBilinear(texture, upperLevel, textureCoords.x, textureCoords.y);
+	return lowerColor * (1.0f - levelMix) + upperColor * levelMix;
+}
+
+void ImageLoader::generateMipLevels(int width, int height, const unsigned char * image, Texture2D & texture)
+{
+	bool compressed = texture.format == TextureFormat::BC1;
+	texture.levels.push_back(compressed ? createCompressedLevel(width, height, image) : createTiledLevel(width, height, image));
+
+	//Keep halving the previous level with a box filter until a 1x1 level is reached, the filtering is done on row major copies of the levels
+	std::vector<unsigned char> previous(image, image + width * height * BYTES_PER_PIXEL);
+	int previousWidth = width;
+	int previousHeight = height;
+	while (previousWidth > 1 || previousHeight > 1)
+	{
+		int levelWidth = std::max(previousWidth / 2, 1);
+		int levelHeight = std::max(previousHeight / 2, 1);
+		std::vector<unsigned char> level(levelWidth * levelHeight * BYTES_PER_PIXEL);
+
+		for (int y = 0; y < levelHeight; y++)
+		{
+			int y0 = std::min(y * 2, previousHeight - 1);
+			int y1 = std::min(y * 2 + 1, previousHeight - 1);
+			for (int x = 0; x < levelWidth; x++)
+			{
+				int x0 = std::min(x * 2, previousWidth - 1);
+				int x1 = std::min(x * 2 + 1, previousWidth - 1);
+				const unsigned char * texel00 = &previous[(x0 + previousWidth * y0) * BYTES_PER_PIXEL];
+				const unsigned char * texel10 = &previous[(x1 + previousWidth * y0) * BYTES_PER_PIXEL];
+				const unsigned char * texel01 = &previous[(x0 + previousWidth * y1) * BYTES_PER_PIXEL];
+				const unsigned char * texel11 = &previous[(x1 + previousWidth * y1) * BYTES_PER_PIXEL];
+				unsigned char * result = &level[(x + levelWidth * y) * BYTES_PER_PIXEL];
+				for (unsigned c = 0; c < BYTES_PER_PIXEL; c++)
+				{
+					result[c] = (unsigned char)((texel00[c] + texel10[c] + texel01[c] + texel11[c] + 2) / 4);
+				}
+			}
+		}
+
+		texture.levels.push_back(compressed ? createCompressedLevel(levelWidth, levelHeight, level.data()) : createTiledLevel(levelWidth, levelHeight, level.data()));
+		previous.swap(level);
+		previousWidth = levelWidth;
+		previousHeight = levelHeight;
+	}
+}
+
+TextureLevel ImageLoader::createTiledLevel(int width, int height, const unsigned char * image)
+{
+	TextureLevel level;
+	level.width = width;
+	level.height = height;
+	//Round the size up to whole tiles, the padding texels are never sampled
+	level.tilesX = (width + TEXTURE_TILE_SIZE - 1) / TEXTURE_TILE_SIZE;
+	level.tilesY = (height + TEXTURE_TILE_SIZE - 1) / TEXTURE_TILE_SIZE;
+	level.texels.resize(level.tilesX * level.tilesY * TEXTURE_TILE_SIZE * TEXTURE_TILE_SIZE * BYTES_PER_PIXEL, 0);
+
+	for (int y = 0; y < height; y++)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			const unsigned char * source = &image[(x + width * y) * BYTES_PER_PIXEL];
+			std::copy(source, source + BYTES_PER_PIXEL, (unsigned char *)level.getTexel(x, y));
+		}
+	}
+	return level;
+}
+
+TextureLevel ImageLoader::createCompressedLevel(int width, int height, const unsigned char * image)
+{
+	TextureLevel level;
+	level.width = width;
+	level.height = height;
+	level.tilesX = (width + TEXTURE_TILE_SIZE - 1) / TEXTURE_TILE_SIZE;
+	level.tilesY = (height + TEXTURE_TILE_SIZE - 1) / TEXTURE_TILE_SIZE;
+	//Every tile holds 2x2 compressed blocks
+	level.texels.resize(level.tilesX * level.tilesY * 4 * BC1_BLOCK_BYTES, 0);
+
+	glm::vec3 colors[16];
+	for (int blockY = 0; blockY < height; blockY += 4)
+	{
+		for (int blockX = 0; blockX < width; blockX += 4)
+		{
+			//Gather the 4x4 texels of the block, repeating the edge texels for blocks that hang over the edge of the level
+			for (int i = 0; i < 16; i++)
+			{
+				int x = std::min(blockX + i % 4, width - 1);
+				int y = std::min(blockY + i / 4, height - 1);
+				const unsigned char * texel = &image[(x + width * y) * BYTES_PER_PIXEL];
+				colors[i] = glm::vec3(texel[0], texel[1], texel[2]);
+			}
+			compressBlock(colors, (unsigned char *)level.getBlock(blockX, blockY));
+		}
+	}
+	return level;
+}
+
+//Converts a color with 0 to 255 channels to RGB565
+static uint16_t packColor565(const glm::vec3 & color)
+{
+	uint16_t r = (uint16_t)(MathFunctions::clamp(0.0f, 255.0f, color.r) * 31.0f / 255.0f + 0.5f);
+	uint16_t g = (uint16_t)(MathFunctions::clamp(0.0f, 255.0f, color.g) * 63.0f / 255.0f + 0.5f);
+	uint16_t b = (uint16_t)(MathFunctions::clamp(0.0f, 255.0f, color.b) * 31.0f / 255.0f + 0.5f);
+	return (r << 11) | (g << 5) | b;
+}
+
+//Converts a RGB565 color back to 0 to 255 channels
+static glm::vec3 unpackColor565(uint16_t color)
+{
+	uint32_t r = (color >> 11) & 31;
+	uint32_t g = (color >> 5) & 63;
+	uint32_t b = color & 31;
+	return glm::vec3((r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2));
+}
+
+void ImageLoader::compressBlock(const glm::vec3 colors[16], unsigned char * block)
+{
+	//Find the axis the colors of the block vary the most along with a few power iterations on their covariance matrix
+	glm::vec3 mean(0.0f);
+	for (int i = 0; i < 16; i++)
+	{
+		mean += colors[i];
+	}
+	mean /= 16.0f;
+	glm::mat3 covariance(0.0f);
+	for (int i = 0; i < 16; i++)
+	{
+		glm::vec3 offset = colors[i] - mean;
+		covariance += glm::outerProduct(offset, offset);
+	}
+	glm::vec3 axis(1.0f, 1.0f, 1.0f);
+	for (int i = 0; i < 4; i++)
+	{
+		axis = covariance * axis;
+		float length = glm::length(axis);
+		axis = length > MathFunctions::EPSILON ? axis / length : glm::vec3(0.57735f);
+	}
+
+	//The end points are the colors furthest along the axis in each direction
+	float minProjection = 0.0f;
+	float maxProjection = 0.0f;
+	for (int i = 0; i < 16; i++)
+	{
+		float projection = glm::dot(colors[i] - mean, axis);
+		minProjection = std::min(minProjection, projection);
+		maxProjection = std::max(maxProjection, projection);
+	}
+	uint16_t color0 = packColor565(mean + axis * maxProjection);
+	uint16_t color1 = packColor565(mean + axis * minProjection);
+	//The first end point must be the larger value to select the four color palette
+	if (color0 < color1)
+	{
+		std::swap(color0, color1);
+	}
+
+	glm::vec3 palette[4];
+	palette[0] = unpackColor565(color0);
+	palette[1] = unpackColor565(color1);
+	palette[2] = (2.0f * palette[0] + palette[1]) / 3.0f;
+	palette[3] = (palette[0] + 2.0f * palette[1]) / 3.0f;
+
+	//Choose the closest palette color for every texel, a block with a single color uses index 0 everywhere
+	uint32_t indices = 0;
+	if (color0 != color1)
+	{
+		for (int i = 0; i < 16; i++)
+		{
+			uint32_t bestIndex = 0;
+			float bestDistance = MathFunctions::T_INFINITY;
+			for (uint32_t p = 0; p < 4; p++)
+			{
+				glm::vec3 difference = colors[i] - palette[p];
+				float distance = glm::dot(difference, difference);
+				if (distance < bestDistance)
+				{
+					bestDistance = distance;
+					bestIndex = p;
+				}
+			}
+			indices |= bestIndex << (i * 2);
+		}
+	}
+
+	block[0] = color0 & 0xFF;
+	block[1] = color0 >> 8;
+	block[2] = color1 & 0xFF;
+	block[3] = color1 >> 8;
+	block[4] = indices & 0xFF;
+	block[5] = (indices >> 8) & 0xFF;
+	block[6] = (indices >> 16) & 0xFF;
+	block[7] = (indices >> 24) & 0xFF;
+}
+
+glm::vec3 ImageLoader::decodeCompressedTexel(const unsigned char * block, int x, int y) const
+{
+	uint16_t color0 = block[0] | (block[1] << 8);
+	uint16_t color1 = block[2] | (block[3] << 8);
+	//Each texel has a 2 bit index into the palette, stored in row order starting from the lowest bits
+	uint32_t shift = ((y & 3) * 4 + (x & 3)) * 2;
+	uint32_t index = (block[4 + (shift >> 3)] >> (shift & 7)) & 3;
 
-	int pixelX = (int)(u * texture.width);
-	int pixelY = (int)(v * texture.height);
+	switch (index)
+	{
+		case 0: return unpackColor565(color0);
+		case 1: return unpackColor565(color1);
+		case 2: return color0 > color1 ? (2.0f * unpackColor565(color0) + unpackColor565(color1)) / 3.0f : (unpackColor565(color0) + unpackColor565(color1)) * 0.5f;
+		default: return color0 > color1 ? (unpackColor565(color0) + 2.0f * unpackColor565(color1)) / 3.0f : glm::vec3(0.0f);
+	}
+}
+
+glm::vec3 ImageLoader::getTexelColor(const Texture2D & texture, uint32_t levelIndex, int x, int y) const
+{
+	const TextureLevel & level = texture.levels[levelIndex];
+	if (texture.format == TextureFormat::BC1)
+	{
+		return decodeCompressedTexel(level.getBlock(x, y), x, y);
+	}
+
+	const unsigned char * texel = level.getTexel(x, y);
+	return glm::vec3(texel[0], texel[1], texel[2]);
+}
+
+glm::vec3 ImageLoader::getCachedTexelColor(const Texture2D & texture, const unsigned char * bytes, int x, int y) const
+{
+	if (texture.format == TextureFormat::BC1)
+	{
+		return decodeCompressedTexel(bytes, x, y);
+	}
+	return glm::vec3(bytes[0], bytes[1], bytes[2]);
+}
+
+glm::vec3 ImageLoader::sampleBilinear(const Texture2D & texture, uint32_t levelIndex, float u, float v) const
+{
+	const TextureLevel & level = texture.levels[levelIndex];
+
+	//Find the texel position with texel centers at half coordinates and wrap the coordinates so the texture repeats
+	float x = u * level.width - 0.5f;
+	float y = v * level.height - 0.5f;
+	float floorX = floorf(x);
+	float floorY = floorf(y);
+	float fractionX = x - floorX;
+	float fractionY = y - floorY;
 
-	unsigned bytePerPixel = STBI_rgb_alpha;
-	unsigned char * pixelOffset = texture.image + (pixelX + texture.width * pixelY) * bytePerPixel;
-	unsigned char r = pixelOffset[0];
-	unsigned char g = pixelOffset[1];
-	unsigned char b = pixelOffset[2];
-	unsigned char a = pixelOffset[3];
+	int x0 = (int)floorX % level.width;
+	int y0 = (int)floorY % level.height;
+	x0 = x0 < 0 ? x0 + level.width : x0;
+	y0 = y0 < 0 ? y0 + level.height : y0;
+	int x1 = x0 + 1 == level.width ? 0 : x0 + 1;
+	int y1 = y0 + 1 == level.height ? 0 : y0 + 1;
+
+	glm::vec3 color00, color10, color01, color11;
+	if (texture.cacheID >= 0)
+	{
+		//Textures in the cache are read through copies of the texels or blocks since the pages holding them may be evicted at any time
+		int texelsX[2] = { x0, x1 };
+		int texelsY[2] = { y0, y1 };
+		unsigned char bytes[4][BC1_BLOCK_BYTES];
+		textureCache->readTexels(texture.cacheID, levelIndex, texelsX, texelsY, bytes);
+		color00 = getCachedTexelColor(texture, bytes[0], x0, y0);
+		color10 = getCachedTexelColor(texture, bytes[1], x1, y0);
+		color01 = getCachedTexelColor(texture, bytes[2], x0, y1);
+		color11 = getCachedTexelColor(texture, bytes[3], x1, y1);
+	}
+	else
+	{
+		color00 = getTexelColor(texture, levelIndex, x0, y0);
+		color10 = getTexelColor(texture, levelIndex, x1, y0);
+		color01 = getTexelColor(texture, levelIndex, x0, y1);
+		color11 = getTexelColor(texture, levelIndex, x1, y1);
+	}
 
-	return glm::vec3(r * CONVERSION_FACTOR_255, g * CONVERSION_FACTOR_255, b * CONVERSION_FACTOR_255);
+	glm::vec3 top = color00 + (color10 - color00) * fractionX;
+	glm::vec3 bottom = color01 + (color11 - color01) * fractionX;
+	return (top + (bottom - top) * fractionY) * CONVERSION_FACTOR_255;
 }
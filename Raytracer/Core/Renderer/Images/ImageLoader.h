@@ -1,27 +1,135 @@
 #pragma once
 
 #include <string>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <atomic>
 
-struct Texture2D
+#include "../../Memory/HugePages.h"
+
+//Width and height in texels of the square tiles texture levels are stored in, as a power of two
+constexpr unsigned TEXTURE_TILE_SHIFT = 3;
+constexpr int TEXTURE_TILE_SIZE = 1 << TEXTURE_TILE_SHIFT;
+//Size in bytes of a compressed block of 4x4 texels
+constexpr unsigned BC1_BLOCK_BYTES = 8;
+//Number of textures an image loader can register, the texture table is allocated up front at this size
+constexpr uint32_t MAX_TEXTURES = 4096;
+
+enum class TextureFormat
+{
+	//Uncompressed 8 bits per channel color with alpha
+	RGBA8,
+	//Fixed rate block compression at 4 bits per texel, each 4x4 block has two RGB565 end point colors and a 2 bit palette index per texel
+	BC1
+};
+
+//A single level of a texture's mip chain
+//Texels are stored in square tiles so that texels which are close in both u and v are close in memory
+//Compressed levels store the 2x2 compressed blocks that make up each tile instead of the texels
+struct TextureLevel
 {
-	unsigned char* image;
 	int width;
 	int height;
-	std::string path;
+	int tilesX;
+	int tilesY;
+	HugePageVector<unsigned char, MemoryCategory::Textures> texels;
+
+	const unsigned char * getTexel(int x, int y) const
+	{
+		unsigned tileIndex = ((unsigned)y >> TEXTURE_TILE_SHIFT) * tilesX + ((unsigned)x >> TEXTURE_TILE_SHIFT);
+		unsigned texelIndex = (tileIndex << (TEXTURE_TILE_SHIFT * 2)) + (((unsigned)y & (TEXTURE_TILE_SIZE - 1)) << TEXTURE_TILE_SHIFT) + ((unsigned)x & (TEXTURE_TILE_SIZE - 1));
+		return texels.data() + texelIndex * 4;
+	}
+
+	const unsigned char * getBlock(int x, int y) const
+	{
+		unsigned tileIndex = ((unsigned)y >> TEXTURE_TILE_SHIFT) * tilesX + ((unsigned)x >> TEXTURE_TILE_SHIFT);
+		unsigned blockIndex = (tileIndex << 2) + ((((unsigned)y >> 2) & 1) << 1) + (((unsigned)x >> 2) & 1);
+		return texels.data() + blockIndex * BC1_BLOCK_BYTES;
+	}
 };
 
-#include <vector>
+//Only the data needed for sampling is kept in the texture so the texture table stays dense
+struct Texture2D
+{
+	TextureFormat format;
+	//Id of the texture in the texture cache, the levels hold no texels when the texture is paged in from the cache, -1 otherwise
+	int32_t cacheID;
+	//Mip chain of the texture, level 0 is the full resolution image and every level after is half the size of the one before
+	std::vector<TextureLevel> levels;
+};
+
+#include <glm/vec2.hpp>
 #include <glm/vec3.hpp>
 
+class TextureCache;
+class ThreadPool;
+
 class ImageLoader
 {
 public:
 	ImageLoader();
+	~ImageLoader();
 
+	//Registers the texture at the path and returns its id, the image is only decoded when the texture is first sampled or prefetched
+	//Registering the same path again returns the id it was first given
 	int32_t loadTexture(const char* path);
+	//Starts decoding the texture on a background thread so it is ready before it is sampled
+	void prefetchTexture(int32_t textureID);
+	//Textures loaded after compression is turned on are block compressed in memory and decoded when sampled
+	void setCompressTextures(bool compress);
+	//Textures loaded after the cache is enabled are kept in tiled cache files in the directory and paged into memory when sampled
+	//The pages in memory are limited to the budget, evicting the least recently used pages
+	void enableTextureCache(const char * directory, size_t budgetBytes);
 
+	//Bilinear filtered lookup in the full resolution level of the texture
 	glm::vec3 getColorAtTextureUV(int32_t textureID, float u, float v);
+	//Trilinear filtered lookup where the mip level is chosen from the change in texture coordinates between neighbouring pixels
+	glm::vec3 getColorAtTextureUV(int32_t textureID, const glm::vec2 & textureCoords, const glm::vec2 & textureCoordsDx, const glm::vec2 & textureCoordsDy);
+
+	//Gives the decoded texture, decoding it first if it has not been
+	const Texture2D & getTexture(int32_t textureID);
+	const std::string & getTexturePath(int32_t textureID) const;
+	size_t getTextureMemoryUsage(int32_t textureID) const;
+	//Prints the format and memory use of every loaded texture
+	void printStatistics() const;
 
 private:
-	std::vector<Texture2D> loadedTextures;
+	struct TextureLoadState
+	{
+		std::once_flag decodeFlag;
+		std::atomic<bool> decoded;
+		//Size of the full resolution image read from its header when the texture was registered
+		int width;
+		int height;
+	};
+
+	//Dense table of the loaded textures indexed by texture id
+	//The tables never grow so they can be read on other threads without the registry lock while more textures are registered
+	Texture2D * loadedTextures;
+	TextureLoadState * loadStates;
+	//Paths of the loaded textures, kept apart from the texture table because they are only needed when loading
+	std::string * texturePaths;
+	//Number of registered textures, only raised once the new texture's entries are filled in
+	std::atomic<uint32_t> textureCount;
+	std::unordered_map<std::string, int32_t> textureRegistry;
+	std::mutex registryMutex;
+	bool compressTextures;
+	TextureCache * textureCache;
+	//Created on the first prefetch so textures that are only sampled on the rendering thread never start any threads
+	ThreadPool * decodePool;
+
+	Texture2D & getDecodedTexture(int32_t textureID);
+	void decodeTexture(int32_t textureID);
+
+	void generateMipLevels(int width, int height, const unsigned char * image, Texture2D & texture);
+	TextureLevel createTiledLevel(int width, int height, const unsigned char * image);
+	TextureLevel createCompressedLevel(int width, int height, const unsigned char * image);
+	void compressBlock(const glm::vec3 colors[16], unsigned char * block);
+	glm::vec3 decodeCompressedTexel(const unsigned char * block, int x, int y) const;
+	glm::vec3 getTexelColor(const Texture2D & texture, uint32_t levelIndex, int x, int y) const;
+	//Decodes a texel, or the block holding it, copied out of the texture cache
+	glm::vec3 getCachedTexelColor(const Texture2D & texture, const unsigned char * bytes, int x, int y) const;
+	glm::vec3 sampleBilinear(const Texture2D & texture, uint32_t levelIndex, float u, float v) const;
 };
\ No newline at end of file
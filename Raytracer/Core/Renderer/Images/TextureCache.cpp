@@ -0,0 +1,318 @@
+#include "TextureCache.h"
+
+#include "../../Assets/MappedFile.h"
+
+#include <iostream>
+#include <cstring>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+constexpr char CACHE_FILE_MAGIC[4] = { 'R', 'T', 'T', 'C' };
+constexpr uint32_t CACHE_FILE_VERSION = 1;
+
+TextureCache::TextureCache(const char * directory, size_t budgetBytes) : cacheDirectory(directory), memoryBudget(budgetBytes), residentBytes(0), hits(0), misses(0), evictions(0)
+{
+	//Creates the cache directory if it does not exist yet
+#ifdef _WIN32
+	_mkdir(directory);
+#else
+	mkdir(directory, 0755);
+#endif
+	MemoryTracker::addReclaimer(this);
+}
+
+TextureCache::~TextureCache()
+{
+	MemoryTracker::removeReclaimer(this);
+	for (CachedTexture & texture : cachedTextures)
+	{
+		fclose(texture.file);
+	}
+}
+
+int32_t TextureCache::openTexture(const char * sourcePath, Texture2D & texture)
+{
+	uint64_t sourceSize, sourceHash;
+	if (!MappedFile::hashFile(sourcePath, sourceSize, sourceHash))
+	{
+		return -1;
+	}
+
+	FILE * file = fopen(getCacheFilePath(sourcePath).c_str(), "rb");
+	if (file == nullptr)
+	{
+		return -1;
+	}
+
+	//The cache file is only used if it was written by this version from the same source image
+	char magic[4];
+	uint32_t version, format, levelCount;
+	uint64_t cachedSize, cachedHash;
+	bool valid = fread(magic, 1, 4, file) == 4 && std::memcmp(magic, CACHE_FILE_MAGIC, 4) == 0;
+	valid = valid && fread(&version, sizeof(version), 1, file) == 1 && version == CACHE_FILE_VERSION;
+	valid = valid && fread(&cachedSize, sizeof(cachedSize), 1, file) == 1 && cachedSize == sourceSize;
+	valid = valid && fread(&cachedHash, sizeof(cachedHash), 1, file) == 1 && cachedHash == sourceHash;
+	valid = valid && fread(&format, sizeof(format), 1, file) == 1 && format == (uint32_t)texture.format;
+	valid = valid && fread(&levelCount, sizeof(levelCount), 1, file) == 1;
+
+	std::vector<TextureLevel> levels(valid ? levelCount : 0);
+	for (uint32_t i = 0; valid && i < levelCount; i++)
+	{
+		int32_t size[2];
+		valid = fread(size, sizeof(int32_t), 2, file) == 2;
+		levels[i].width = size[0];
+		levels[i].height = size[1];
+		levels[i].tilesX = (size[0] + TEXTURE_TILE_SIZE - 1) / TEXTURE_TILE_SIZE;
+		levels[i].tilesY = (size[1] + TEXTURE_TILE_SIZE - 1) / TEXTURE_TILE_SIZE;
+	}
+
+	if (!valid)
+	{
+		fclose(file);
+		return -1;
+	}
+
+	//The texture keeps the sizes of its levels for sampling but none of the texels
+	texture.levels = levels;
+	return addCachedTexture(file, texture.format, levels, ftell(file));
+}
+
+int32_t TextureCache::addTexture(const char * sourcePath, const Texture2D & texture)
+{
+	uint64_t sourceSize, sourceHash;
+	if (!MappedFile::hashFile(sourcePath, sourceSize, sourceHash))
+	{
+		return -1;
+	}
+
+	//The file is written under a temporary name and renamed when complete, so a run that stops part way through never leaves a cache file that looks valid
+	std::string cachePath = getCacheFilePath(sourcePath);
+	std::string temporaryPath = cachePath + ".tmp";
+	FILE * file = fopen(temporaryPath.c_str(), "wb");
+	if (file == nullptr)
+	{
+		std::cout << "WARNING: Could not write texture cache file: " << cachePath << std::endl;
+		return -1;
+	}
+
+	uint32_t format = (uint32_t)texture.format;
+	uint32_t levelCount = texture.levels.size();
+	fwrite(CACHE_FILE_MAGIC, 1, 4, file);
+	fwrite(&CACHE_FILE_VERSION, sizeof(CACHE_FILE_VERSION), 1, file);
+	fwrite(&sourceSize, sizeof(sourceSize), 1, file);
+	fwrite(&sourceHash, sizeof(sourceHash), 1, file);
+	fwrite(&format, sizeof(format), 1, file);
+	fwrite(&levelCount, sizeof(levelCount), 1, file);
+	for (const TextureLevel & level : texture.levels)
+	{
+		int32_t size[2] = { level.width, level.height };
+		fwrite(size, sizeof(int32_t), 2, file);
+	}
+	long dataOffset = ftell(file);
+
+	//Writes every level as pages of tiles, tiles of a page that fall outside the level are left as zeros
+	size_t tileBytes = texture.levels[0].texels.size() / (texture.levels[0].tilesX * texture.levels[0].tilesY);
+	std::vector<unsigned char> page(tileBytes * TEXTURE_PAGE_TILES * TEXTURE_PAGE_TILES);
+	for (const TextureLevel & level : texture.levels)
+	{
+		int pagesX = (level.tilesX + TEXTURE_PAGE_TILES - 1) / TEXTURE_PAGE_TILES;
+		int pagesY = (level.tilesY + TEXTURE_PAGE_TILES - 1) / TEXTURE_PAGE_TILES;
+		for (int pageY = 0; pageY < pagesY; pageY++)
+		{
+			for (int pageX = 0; pageX < pagesX; pageX++)
+			{
+				std::fill(page.begin(), page.end(), 0);
+				for (int i = 0; i < TEXTURE_PAGE_TILES * TEXTURE_PAGE_TILES; i++)
+				{
+					int tileX = pageX * TEXTURE_PAGE_TILES + i % TEXTURE_PAGE_TILES;
+					int tileY = pageY * TEXTURE_PAGE_TILES + i / TEXTURE_PAGE_TILES;
+					if (tileX < level.tilesX && tileY < level.tilesY)
+					{
+						const unsigned char * tile = level.texels.data() + (tileY * level.tilesX + tileX) * tileBytes;
+						std::copy(tile, tile + tileBytes, page.data() + i * tileBytes);
+					}
+				}
+				fwrite(page.data(), 1, page.size(), file);
+			}
+		}
+	}
+
+	bool written = !ferror(file);
+	written = fclose(file) == 0 && written;
+	//Renaming does not replace an existing file on every platform, so the out of date cache file is removed first
+	std::remove(cachePath.c_str());
+	if (!written || std::rename(temporaryPath.c_str(), cachePath.c_str()) != 0)
+	{
+		std::cout << "WARNING: Could not write texture cache file: " << cachePath << std::endl;
+		std::remove(temporaryPath.c_str());
+		return -1;
+	}
+
+	file = fopen(cachePath.c_str(), "rb");
+	if (file == nullptr)
+	{
+		std::cout << "WARNING: Could not open texture cache file: " << cachePath << std::endl;
+		return -1;
+	}
+	return addCachedTexture(file, texture.format, texture.levels, dataOffset);
+}
+
+void TextureCache::readTexels(int32_t cacheID, uint32_t level, const int x[2], const int y[2], unsigned char destinations[4][BC1_BLOCK_BYTES])
+{
+	//The copies are made while holding the lock so the pages can not be evicted by another thread during them
+	std::lock_guard<std::mutex> lock(cacheMutex);
+	const CachedTexture & texture = cachedTextures[cacheID];
+
+	//The texels of a footprint are almost always in the same page, so the last page found is reused instead of looking it up again
+	//Only the last page is kept since reading a new page can evict any other
+	const unsigned char * page = nullptr;
+	unsigned lastPageIndex = UINT32_MAX;
+	for (int i = 0; i < 4; i++)
+	{
+		unsigned texelX = (unsigned)x[i & 1];
+		unsigned texelY = (unsigned)y[i >> 1];
+		unsigned tileX = texelX >> TEXTURE_TILE_SHIFT;
+		unsigned tileY = texelY >> TEXTURE_TILE_SHIFT;
+		unsigned pageIndex = (tileY >> TEXTURE_PAGE_SHIFT) * texture.levels[level].pagesX + (tileX >> TEXTURE_PAGE_SHIFT);
+		unsigned tileInPage = ((tileY & (TEXTURE_PAGE_TILES - 1)) << TEXTURE_PAGE_SHIFT) + (tileX & (TEXTURE_PAGE_TILES - 1));
+
+		//Finds the texel, or the block holding it, inside its tile with the same addressing as TextureLevel
+		size_t offset, size;
+		if (texture.format == TextureFormat::BC1)
+		{
+			offset = (((texelY >> 2) & 1) << 1) + ((texelX >> 2) & 1);
+			offset *= BC1_BLOCK_BYTES;
+			size = BC1_BLOCK_BYTES;
+		}
+		else
+		{
+			offset = ((texelY & (TEXTURE_TILE_SIZE - 1)) << TEXTURE_TILE_SHIFT) + (texelX & (TEXTURE_TILE_SIZE - 1));
+			offset *= 4;
+			size = 4;
+		}
+		offset += tileInPage * texture.tileBytes;
+
+		if (pageIndex != lastPageIndex)
+		{
+			page = getPage(cacheID, level, pageIndex);
+			lastPageIndex = pageIndex;
+		}
+		std::memcpy(destinations[i], page + offset, size);
+	}
+}
+
+size_t TextureCache::getResidentBytes() const
+{
+	std::lock_guard<std::mutex> lock(cacheMutex);
+	return residentBytes;
+}
+
+void TextureCache::printStatistics() const
+{
+	std::lock_guard<std::mutex> lock(cacheMutex);
+	uint64_t lookups = hits + misses;
+	printf("Texture cache: %zu pages resident, %.1f KB of %.1f KB budget\n", residentPages.size(), residentBytes / 1024.0, memoryBudget / 1024.0);
+	printf("  %llu lookups, %.2f%% hits, %.2f%% misses, %llu evictions\n", (unsigned long long)lookups, lookups ? hits * 100.0 / lookups : 0.0, lookups ? misses * 100.0 / lookups : 0.0, (unsigned long long)evictions);
+}
+
+size_t TextureCache::reclaimMemory(size_t bytes)
+{
+	std::lock_guard<std::mutex> lock(cacheMutex);
+	size_t freed = 0;
+	while (!residentPages.empty() && freed < bytes)
+	{
+		Page & leastRecent = residentPages.back();
+		freed += leastRecent.data.size();
+		residentBytes -= leastRecent.data.size();
+		pageTable.erase(leastRecent.key);
+		residentPages.pop_back();
+		evictions++;
+	}
+	return freed;
+}
+
+const unsigned char * TextureCache::getPage(int32_t cacheID, uint32_t level, uint32_t pageIndex)
+{
+	uint64_t key = ((uint64_t)cacheID << 40) | ((uint64_t)level << 32) | pageIndex;
+	auto entry = pageTable.find(key);
+	if (entry != pageTable.end())
+	{
+		hits++;
+		//Moves the page to the front of the list as the most recently used
+		residentPages.splice(residentPages.begin(), residentPages, entry->second);
+		return entry->second->data.data();
+	}
+	misses++;
+
+	const CachedTexture & texture = cachedTextures[cacheID];
+	//Evicts the least recently used pages until the new page fits in the budget, always keeping room for at least the new page
+	HugePageVector<unsigned char, MemoryCategory::Caches> data;
+	while (!residentPages.empty() && (residentBytes + texture.pageBytes > memoryBudget || MemoryTracker::getAvailableBytes() + data.size() < texture.pageBytes))
+	{
+		Page & leastRecent = residentPages.back();
+		residentBytes -= leastRecent.data.size();
+		pageTable.erase(leastRecent.key);
+		//Reuses the buffer of the evicted page when it is the same size
+		if (leastRecent.data.size() == texture.pageBytes)
+		{
+			data.swap(leastRecent.data);
+		}
+		residentPages.pop_back();
+		evictions++;
+	}
+
+	data.resize(texture.pageBytes);
+	const CachedLevel & cachedLevel = texture.levels[level];
+	fseek(texture.file, cachedLevel.fileOffset + (long)(pageIndex * texture.pageBytes), SEEK_SET);
+	if (fread(data.data(), 1, texture.pageBytes, texture.file) != texture.pageBytes)
+	{
+		std::cout << "WARNING: Could not read page " << pageIndex << " of texture cache level " << level << std::endl;
+		std::fill(data.begin(), data.end(), 0);
+	}
+
+	residentPages.push_front(Page());
+	residentPages.front().key = key;
+	residentPages.front().data.swap(data);
+	pageTable[key] = residentPages.begin();
+	residentBytes += texture.pageBytes;
+	return residentPages.front().data.data();
+}
+
+int32_t TextureCache::addCachedTexture(FILE * file, TextureFormat format, const std::vector<TextureLevel> & levels, long dataOffset)
+{
+	CachedTexture texture;
+	texture.file = file;
+	texture.format = format;
+	texture.tileBytes = format == TextureFormat::BC1 ? 4 * BC1_BLOCK_BYTES : TEXTURE_TILE_SIZE * TEXTURE_TILE_SIZE * 4;
+	texture.pageBytes = texture.tileBytes * TEXTURE_PAGE_TILES * TEXTURE_PAGE_TILES;
+
+	long offset = dataOffset;
+	for (const TextureLevel & level : levels)
+	{
+		CachedLevel cachedLevel;
+		cachedLevel.width = level.width;
+		cachedLevel.height = level.height;
+		cachedLevel.pagesX = (level.tilesX + TEXTURE_PAGE_TILES - 1) / TEXTURE_PAGE_TILES;
+		cachedLevel.pagesY = (level.tilesY + TEXTURE_PAGE_TILES - 1) / TEXTURE_PAGE_TILES;
+		cachedLevel.fileOffset = offset;
+		offset += (long)(cachedLevel.pagesX * cachedLevel.pagesY * texture.pageBytes);
+		texture.levels.push_back(cachedLevel);
+	}
+
+	std::lock_guard<std::mutex> lock(cacheMutex);
+	cachedTextures.push_back(texture);
+	return cachedTextures.size() - 1;
+}
+
+std::string TextureCache::getCacheFilePath(const char * sourcePath)
+{
+	//Names the cache file after a hash of the source path so every source image gets its own file
+	uint64_t hash = MappedFile::hashBytes(sourcePath, strlen(sourcePath));
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx.rttc", (unsigned long long)hash);
+	return cacheDirectory + "/" + name;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <mutex>
+#include <cstdio>
+
+#include "ImageLoader.h"
+
+//Width and height in tiles of the square pages the texture cache reads from disk and evicts
+constexpr unsigned TEXTURE_PAGE_SHIFT = 2;
+constexpr int TEXTURE_PAGE_TILES = 1 << TEXTURE_PAGE_SHIFT;
+
+//Out of core storage for textures so scenes with more texture data than memory can still be rendered
+//The tiled levels of a texture are written to a cache file on disk, grouped into square pages of tiles
+//Pages are read back when a texel in them is sampled and the least recently used pages are evicted to stay under the memory budget
+//Pages are also evicted to stay under the budget of the MemoryTracker, and when it asks for memory back
+class TextureCache : public MemoryReclaimer
+{
+public:
+	TextureCache(const char * directory, size_t budgetBytes);
+	~TextureCache();
+
+	//Opens the cache file of the texture at the source path if it is up to date with the source image and has the format of the texture
+	//Fills in the level sizes of the texture and returns its cache id, or -1 if the texture has to be decoded and added
+	int32_t openTexture(const char * sourcePath, Texture2D & texture);
+	//Writes the levels of a decoded texture to its cache file and returns its cache id, or -1 if the file could not be written
+	int32_t addTexture(const char * sourcePath, const Texture2D & texture);
+
+	//Copies the four texels of a bilinear footprint, or for compressed textures the blocks holding them, into the destinations
+	//The destinations are in the order (x[0], y[0]), (x[1], y[0]), (x[0], y[1]), (x[1], y[1]) and are all copied under one lock
+	void readTexels(int32_t cacheID, uint32_t level, const int x[2], const int y[2], unsigned char destinations[4][BC1_BLOCK_BYTES]);
+
+	size_t getResidentBytes() const;
+	void printStatistics() const;
+
+	size_t reclaimMemory(size_t bytes) override;
+
+private:
+	struct CachedLevel
+	{
+		int width;
+		int height;
+		int pagesX;
+		int pagesY;
+		//Offset in the cache file of the first page of the level
+		long fileOffset;
+	};
+
+	struct CachedTexture
+	{
+		FILE * file;
+		TextureFormat format;
+		size_t tileBytes;
+		size_t pageBytes;
+		std::vector<CachedLevel> levels;
+	};
+
+	struct Page
+	{
+		uint64_t key;
+		HugePageVector<unsigned char, MemoryCategory::Caches> data;
+	};
+
+	std::string cacheDirectory;
+	std::vector<CachedTexture> cachedTextures;
+
+	//Resident pages ordered from most to least recently used, with a table to find the page of a key
+	std::list<Page> residentPages;
+	std::unordered_map<uint64_t, std::list<Page>::iterator> pageTable;
+	size_t memoryBudget;
+	size_t residentBytes;
+
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t evictions;
+
+	//Guards the page table so textures can be sampled from several threads, it is taken once per bilinear sample
+	mutable std::mutex cacheMutex;
+
+	const unsigned char * getPage(int32_t cacheID, uint32_t level, uint32_t pageIndex);
+	int32_t addCachedTexture(FILE * file, TextureFormat format, const std::vector<TextureLevel> & levels, long dataOffset);
+	std::string getCacheFilePath(const char * sourcePath);
+};
\ No newline at end of file
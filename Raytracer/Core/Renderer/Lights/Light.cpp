@@ -11,3 +11,13 @@ glm::vec3 Light::getColor()
 {
 	return color;
 }
+
+void Light::setIntensity(float i)
+{
+	intensity = i;
+}
+
+void Light::setColor(glm::vec3 c)
+{
+	color = c;
+}
@@ -11,6 +11,8 @@ public:
 
 	float getIntensity();
 	glm::vec3 getColor();
+	void setIntensity(float i);
+	void setColor(glm::vec3 c);
 
 protected:
 	glm::vec3 color;
@@ -22,3 +22,18 @@ float PhongMaterial::getDiffuseComponent()
 {
 	return this->diffuseComponent;
 }
+
+void PhongMaterial::setPowerComponent(float p)
+{
+	this->powerComponent = p;
+}
+
+void PhongMaterial::setSpecularComponent(float s)
+{
+	this->specularComponent = s;
+}
+
+void PhongMaterial::setDiffuseComponent(float d)
+{
+	this->diffuseComponent = d;
+}
@@ -11,6 +11,9 @@ public:
 	float getPowerComponent();
 	float getSpecularComponent();
 	float getDiffuseComponent();
+	void setPowerComponent(float p);
+	void setSpecularComponent(float s);
+	void setDiffuseComponent(float d);
 
 private:
 	float specularComponent;
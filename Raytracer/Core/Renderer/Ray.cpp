@@ -2,7 +2,7 @@
 
 #include "glm/geometric.hpp"
 
-Ray::Ray(glm::vec3 o, glm::vec3 d, Type t) : origin(o), direction(glm::normalize(d)), type(t)
+Ray::Ray(glm::vec3 o, glm::vec3 d, Type t) : origin(o), direction(glm::normalize(d)), type(t), differentials(false)
 {
 }
 
@@ -21,6 +21,40 @@ glm::vec3 Ray::getDirectionVector() const
 	return this->direction;
 }
 
+void Ray::setDifferentials(glm::vec3 oDx, glm::vec3 oDy, glm::vec3 dDx, glm::vec3 dDy)
+{
+	this->differentials = true;
+	this->originDx = oDx;
+	this->originDy = oDy;
+	this->directionDx = dDx;
+	this->directionDy = dDy;
+}
+
+bool Ray::hasDifferentials() const
+{
+	return this->differentials;
+}
+
+glm::vec3 Ray::getOriginDx() const
+{
+	return this->originDx;
+}
+
+glm::vec3 Ray::getOriginDy() const
+{
+	return this->originDy;
+}
+
+glm::vec3 Ray::getDirectionDx() const
+{
+	return this->directionDx;
+}
+
+glm::vec3 Ray::getDirectionDy() const
+{
+	return this->directionDy;
+}
+
 Ray Ray::convertToNewSpace(const Ray & ray, const glm::mat4 & matrix)
 {
 	glm::vec3 origin = matrix * glm::vec4(ray.getOrigin(), 1.0f);
@@ -6,7 +6,8 @@
 class Ray
 {
 public:
-	enum class Type { PRIMARY, SHADOW };
+	//Secondary rays are the reflection and refraction rays spawned from a hit
+	enum class Type { PRIMARY, SECONDARY, SHADOW };
 
 	Ray(glm::vec3 o, glm::vec3 d, Type t = Type::PRIMARY);
 
@@ -14,10 +15,24 @@ public:
 	glm::vec3 getOrigin() const;
 	glm::vec3 getDirectionVector() const;
 
+	//Ray differentials describe how the origin and direction change when moving one pixel in x or y on the image plane
+	void setDifferentials(glm::vec3 oDx, glm::vec3 oDy, glm::vec3 dDx, glm::vec3 dDy);
+	bool hasDifferentials() const;
+	glm::vec3 getOriginDx() const;
+	glm::vec3 getOriginDy() const;
+	glm::vec3 getDirectionDx() const;
+	glm::vec3 getDirectionDy() const;
+
 	static Ray convertToNewSpace(const Ray& ray, const glm::mat4& matrix);
 
 private:
 	Type type;
 	glm::vec3 origin;
 	glm::vec3 direction;
+
+	bool differentials;
+	glm::vec3 originDx;
+	glm::vec3 originDy;
+	glm::vec3 directionDx;
+	glm::vec3 directionDy;
 };
\ No newline at end of file
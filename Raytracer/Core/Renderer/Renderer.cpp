@@ -3,6 +3,10 @@
 #include <list>
 #include <algorithm>
 #include <iostream>
+#include <deque>
+#include <chrono>
+#include <cstdio>
+#include <cmath>
 
 #include "Camera.h"
 #include "Ray.h"
@@ -11,43 +15,393 @@
 #include "Materials/Material.h"
 #include "Materials/RefractiveMaterial.h"
 #include "Materials/PhongMaterial.h"
+#include "../Memory/MemoryTracker.h"
+#include "../Objects/Entity.h"
 
 const int Renderer::MAX_RAY_DEPTH = 4;
+const uint32_t Renderer::TILE_SIZE = 32;
+const float Renderer::TEMPORAL_DEPTH_TOLERANCE = 0.05f;
+const float Renderer::TEMPORAL_MAX_VIEW_ANGLE = 2.0f;
 
-Renderer::Renderer(uint32_t w, uint32_t h) : width(w), height(h), imageLoader(ImageLoader())
+Renderer::Renderer(uint32_t w, uint32_t h) : width(w), height(h), temporalFrames(0)
 {
 	//Resize the framebuffer to the total amount of pixels
+	MemoryTracker::allocated(MemoryCategory::Framebuffer, 0, width * height * sizeof(glm::vec3));
 	framebuffer.resize(width * height);
 }
 
+Renderer::~Renderer()
+{
+	MemoryTracker::released(MemoryCategory::Framebuffer, 0, width * height * sizeof(glm::vec3));
+	if (!temporalSamples.empty())
+	{
+		MemoryTracker::released(MemoryCategory::Framebuffer, 0, width * height * (sizeof(TemporalSample) + sizeof(glm::vec3)));
+	}
+	if (!hitBuffer.empty())
+	{
+		MemoryTracker::released(MemoryCategory::Framebuffer, 0, width * height * sizeof(SurfaceHit));
+	}
+}
+
 void Renderer::render(Camera & camera, std::vector<Object*>& objectList, std::vector<Light*>& lightList)
 {
-	//Calculate the scale value by taking the tangent of the half angle of the cameras field of view
-	float scale = tan(MathFunctions::degreesToRadians(camera.getFieldOfView()) * 0.5f);
-	float aspectRatio = width / (float)height;
-	//Calculate matrix ahead of raytracing to reduce time redoing the calculation each pixel during rendering
-	camera.calculateCameraToWorldSpaceMatrix();
-	//Loop through all pixels to send a ray from to render the scene
-	int counter = 0;
-	float inverseWidth = 1 / (float)width;
-	float inverseHeight = 1 / (float)height;
+	prepareRender(camera, objectList);
+	renderTile(camera, 0, 0, width, height, objectList, lightList);
+}
+
+bool Renderer::updateScene(std::vector<Object*>& objectList)
+{
+	return this->sceneBVH.update(objectList);
+}
+
+const SceneBVH & Renderer::getSceneBVH() const
+{
+	return this->sceneBVH;
+}
+
+void Renderer::swapSceneBVH(SceneBVH & other)
+{
+	std::swap(this->sceneBVH, other);
+}
+
+void Renderer::renderProgressive(Camera & camera, std::vector<Object*>& objectList, std::vector<Light*>& lightList, const std::function<void()> & previewReady)
+{
+	auto startTime = std::chrono::high_resolution_clock::now();
+	prepareRender(camera, objectList);
+
+	std::deque<Tile> tileQueue;
+	for (uint32_t y = 0; y < height; y += TILE_SIZE)
+	{
+		for (uint32_t x = 0; x < width; x += TILE_SIZE)
+		{
+			Tile tile;
+			tile.x = x;
+			tile.y = y;
+			tileQueue.push_back(tile);
+		}
+	}
+	//Tiles that reached loading objects wait here until those objects have loaded
+	std::list<Tile> waitingTiles;
+	size_t firstPassTiles = tileQueue.size();
+	size_t firstPassWaitingTiles = 0;
+	size_t renderedTiles = 0;
+	while (!tileQueue.empty() || !waitingTiles.empty())
+	{
+		//Once every tile has been rendered the only ones left need objects that are still loading, so the render waits for them
+		if (finishLoading(objectList, tileQueue.empty()))
+		{
+			//Loaded objects are bounded by their models instead of their proxies
+			this->sceneBVH.build(objectList);
+			for (auto tile = waitingTiles.begin(); tile != waitingTiles.end();)
+			{
+				if (std::none_of(tile->loadingObjects.begin(), tile->loadingObjects.end(), [](Object * object) { return object->isLoading(); }))
+				{
+					tileQueue.push_back(*tile);
+					tile = waitingTiles.erase(tile);
+				}
+				else
+				{
+					tile++;
+				}
+			}
+		}
+
+		Tile tile = tileQueue.front();
+		tileQueue.pop_front();
+		reachedLoadingObjects.clear();
+		renderTile(camera, tile.x, tile.y, std::min(tile.x + TILE_SIZE, width), std::min(tile.y + TILE_SIZE, height), objectList, lightList);
+		if (!reachedLoadingObjects.empty())
+		{
+			tile.loadingObjects = reachedLoadingObjects;
+			waitingTiles.push_back(tile);
+			firstPassWaitingTiles += renderedTiles < firstPassTiles;
+		}
+
+		renderedTiles++;
+		if (renderedTiles == 1 || renderedTiles == firstPassTiles)
+		{
+			double elapsedTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+			if (renderedTiles == 1)
+			{
+				printf("First preview tile in: %.1f ms\n", elapsedTime);
+			}
+			if (renderedTiles == firstPassTiles)
+			{
+				printf("Preview finished in: %.1f ms, %zu of %zu tiles reached loading objects\n", elapsedTime, firstPassWaitingTiles, firstPassTiles);
+				previewReady();
+			}
+		}
+	}
+	printf("Rendered %zu tiles again once objects loaded\n", renderedTiles - firstPassTiles);
+}
+
+bool Renderer::finishLoading(std::vector<Object*>& objectList, bool wait)
+{
+	bool finished = false;
+	for (Object * object : objectList)
+	{
+		if (object->isLoading() && object->finishLoading(wait))
+		{
+			finished = true;
+		}
+	}
+	return finished;
+}
+
+float Renderer::renderTemporal(Camera & camera, std::vector<Object*>& objectList, std::vector<Light*>& lightList, float refreshFraction)
+{
+	prepareRender(camera, objectList);
+	uint32_t pixelCount = width * height;
+	if (this->temporalSamples.empty())
+	{
+		MemoryTracker::allocated(MemoryCategory::Framebuffer, 0, pixelCount * (sizeof(TemporalSample) + sizeof(glm::vec3)));
+		TemporalSample emptySample = { glm::vec3(0.0f), glm::vec3(0.0f), false };
+		this->temporalSamples.resize(pixelCount, emptySample);
+		this->temporalColors.resize(pixelCount);
+	}
+
+	//Scatter the hits of the last frame to the pixels they are seen through now, the one nearest to the camera is kept for each pixel
+	glm::vec3 origin = camera.getOrigin();
+	std::vector<float> reprojectedDepths(pixelCount, MathFunctions::T_INFINITY);
+	std::vector<uint32_t> reprojectedSamples(pixelCount, pixelCount);
+	for (uint32_t i = 0; i < pixelCount; i++)
+	{
+		const TemporalSample & sample = this->temporalSamples[i];
+		glm::vec2 pixelPosition;
+		if (!sample.reusable || !projectToPixel(camera, sample.position, pixelPosition) || pixelPosition.x < 0.0f || pixelPosition.y < 0.0f || pixelPosition.x >= width || pixelPosition.y >= height)
+		{
+			continue;
+		}
+		uint32_t pixel = (uint32_t)pixelPosition.x + width * (uint32_t)pixelPosition.y;
+		float depth = glm::length(sample.position - origin);
+		if (depth < reprojectedDepths[pixel])
+		{
+			reprojectedDepths[pixel] = depth;
+			reprojectedSamples[pixel] = i;
+		}
+	}
+
+	//A hit reprojected to where an animated entity is now, or was in the last frame, may have been covered or uncovered by it, so every pixel its bounds cover is traced again
+	std::vector<glm::vec3> animatedBounds;
+	for (Object * object : objectList)
+	{
+		Entity * entity = dynamic_cast<Entity*>(object);
+		glm::vec3 minPoint;
+		glm::vec3 maxPoint;
+		if (entity && entity->isAnimated() && entity->getBounds(minPoint, maxPoint))
+		{
+			animatedBounds.push_back(minPoint);
+			animatedBounds.push_back(maxPoint);
+		}
+	}
+	this->temporalAnimatedBounds.insert(this->temporalAnimatedBounds.end(), animatedBounds.begin(), animatedBounds.end());
+	for (uint32_t i = 0; i < this->temporalAnimatedBounds.size(); i += 2)
+	{
+		//The box is taken as covering the whole image if part of it is behind the camera
+		glm::vec2 minPixel(0.0f);
+		glm::vec2 maxPixel((float)width, (float)height);
+		glm::vec2 cornerMin(MathFunctions::T_INFINITY);
+		glm::vec2 cornerMax(-MathFunctions::T_INFINITY);
+		bool inFront = true;
+		for (uint32_t corner = 0; corner < 8 && inFront; corner++)
+		{
+			const glm::vec3 & boxMin = this->temporalAnimatedBounds[i];
+			const glm::vec3 & boxMax = this->temporalAnimatedBounds[i + 1];
+			glm::vec3 point((corner & 1) ? boxMax.x : boxMin.x, (corner & 2) ? boxMax.y : boxMin.y, (corner & 4) ? boxMax.z : boxMin.z);
+			glm::vec2 pixelPosition;
+			inFront = projectToPixel(camera, point, pixelPosition);
+			cornerMin = glm::min(cornerMin, pixelPosition);
+			cornerMax = glm::max(cornerMax, pixelPosition);
+		}
+		if (inFront)
+		{
+			minPixel = glm::max(minPixel, glm::floor(cornerMin));
+			maxPixel = glm::min(maxPixel, glm::ceil(cornerMax));
+		}
+		for (uint32_t y = (uint32_t)minPixel.y; y < (uint32_t)std::max(minPixel.y, maxPixel.y); y++)
+		{
+			for (uint32_t x = (uint32_t)minPixel.x; x < (uint32_t)std::max(minPixel.x, maxPixel.x); x++)
+			{
+				reprojectedSamples[x + width * y] = pixelCount;
+			}
+		}
+	}
+	this->temporalAnimatedBounds.swap(animatedBounds);
+
+	float minViewCosine = cos(MathFunctions::degreesToRadians(TEMPORAL_MAX_VIEW_ANGLE));
+	std::vector<TemporalSample> nextSamples(pixelCount);
+	uint32_t reusedPixels = 0;
+	for (uint32_t y = 0; y < height; y++)
+	{
+		for (uint32_t x = 0; x < width; x++)
+		{
+			uint32_t pixel = x + width * y;
+			uint32_t source = reprojectedSamples[pixel];
+			//Each pixel is refreshed once every 1 / refreshFraction frames, offset by a hash of the pixel so the refreshed pixels are spread over the image
+			float phase = ((pixel * 2654435761u) >> 8) / 16777216.0f + this->temporalFrames * refreshFraction;
+			bool reuse = source < pixelCount && phase - std::floor(phase) >= refreshFraction;
+
+			//Reprojecting leaves gaps where surfaces are stretched, a hit seen through such a gap in a nearer surface belongs to a surface that is now hidden
+			float depthLimit = reprojectedDepths[pixel] * (1.0f - TEMPORAL_DEPTH_TOLERANCE);
+			for (uint32_t neighbourY = (y > 0 ? y - 1 : y); reuse && neighbourY <= std::min(y + 1, height - 1); neighbourY++)
+			{
+				for (uint32_t neighbourX = (x > 0 ? x - 1 : x); neighbourX <= std::min(x + 1, width - 1); neighbourX++)
+				{
+					if (reprojectedDepths[neighbourX + width * neighbourY] < depthLimit)
+					{
+						reuse = false;
+						break;
+					}
+				}
+			}
+
+			if (reuse)
+			{
+				//The shading of the hit changes with the direction and the distance it is seen from
+				const TemporalSample & sample = this->temporalSamples[source];
+				glm::vec3 shadedView = sample.position - sample.viewOrigin;
+				glm::vec3 currentView = sample.position - origin;
+				float distanceRatio = glm::length(currentView) / glm::length(shadedView);
+				reuse = glm::dot(glm::normalize(shadedView), glm::normalize(currentView)) >= minViewCosine && std::abs(distanceRatio - 1.0f) <= TEMPORAL_DEPTH_TOLERANCE;
+			}
+
+			if (reuse)
+			{
+				framebuffer[pixel] = this->temporalColors[source];
+				nextSamples[pixel] = this->temporalSamples[source];
+				reusedPixels++;
+			}
+			else
+			{
+				nextSamples[pixel].reusable = false;
+				nextSamples[pixel].viewOrigin = origin;
+				framebuffer[pixel] = getColorFromRaycast(createCameraRay(camera, x, y), objectList, lightList, 0, &nextSamples[pixel]);
+			}
+		}
+	}
+
+	this->temporalSamples.swap(nextSamples);
+	this->temporalColors = framebuffer;
+	this->temporalFrames++;
+	return reusedPixels / (float)pixelCount;
+}
+
+void Renderer::cacheHits(Camera & camera, std::vector<Object*>& objectList)
+{
+	prepareRender(camera, objectList);
+	if (this->hitBuffer.empty())
+	{
+		MemoryTracker::allocated(MemoryCategory::Framebuffer, 0, width * height * sizeof(SurfaceHit));
+		this->hitBuffer.resize(width * height);
+	}
+	for (uint32_t y = 0; y < height; y++)
+	{
+		for (uint32_t x = 0; x < width; x++)
+		{
+			traceSurface(createCameraRay(camera, x, y), this->hitBuffer[x + width * y]);
+		}
+	}
+}
+
+void Renderer::reshade(Camera & camera, std::vector<Object*>& objectList, std::vector<Light*>& lightList)
+{
+	if (this->hitBuffer.empty())
+	{
+		cacheHits(camera, objectList);
+	}
+	else
+	{
+		prepareRender(camera, objectList);
+	}
 	for (uint32_t y = 0; y < height; y++)
 	{
 		for (uint32_t x = 0; x < width; x++)
 		{
-			//Calculate the pixel's position in camera space by calculating the location of the center of each pixel. Apply the aspect ratio to the x to get the correct scaling
-			float pX = (1.0f - 2.0f * (x + 0.5f) * inverseWidth) * scale * aspectRatio;
-			float pY = (1.0f - 2.0f * (y + 0.5f) * inverseHeight) * scale;
-			//Convert the pixel position to world space placing the plane 1 unit in front of the camera
-			glm::vec3 position = camera.convertCameraSpaceToWorldSpace(glm::vec3(pX, pY, 1));
-			//Create the ray by calculating the direction the ray will be cast in by subtracting the origin of the camera
- 			Ray ray = Ray(position, glm::normalize(position - camera.getOrigin()));
+			const SurfaceHit & surfaceHit = this->hitBuffer[x + width * y];
+			//The primary ray is only made again for its direction and differentials, which shading and secondary rays start from
+			framebuffer[x + width * y] = surfaceHit.object ? shadeSurface(createCameraRay(camera, x, y), surfaceHit, objectList, lightList, 0) : glm::vec3(0.0f, 0.0f, 0.0f);
+		}
+	}
+}
+
+size_t Renderer::getHitBufferMemoryUsage() const
+{
+	return this->hitBuffer.size() * sizeof(SurfaceHit);
+}
+
+void Renderer::prepareRender(Camera & camera, std::vector<Object*>& objectList)
+{
+	//Calculate matrix ahead of raytracing to reduce time redoing the calculation each pixel during rendering
+	camera.calculateCameraToWorldSpaceMatrix();
+	if (!this->sceneBVH.isBuiltFrom(objectList))
+	{
+		this->sceneBVH.build(objectList);
+	}
+	//Start decoding the textures of the scene in the background so they are ready, or close to it, when the first rays hit them
+	for (Object * object : objectList)
+	{
+		Material * material = object->getMaterial();
+		if (material != nullptr && material->getTextureID() >= 0)
+		{
+			imageLoader.prefetchTexture(material->getTextureID());
+		}
+	}
+}
+
+void Renderer::renderTile(Camera & camera, uint32_t startX, uint32_t startY, uint32_t endX, uint32_t endY, std::vector<Object*>& objectList, std::vector<Light*>& lightList)
+{
+	//Loop through all pixels of the tile to send a ray from to render the scene
+	for (uint32_t y = startY; y < endY; y++)
+	{
+		for (uint32_t x = startX; x < endX; x++)
+		{
 			//Populate the color of the framebuffer by casting the ray into the scene and checking for intersections
-			framebuffer[x + width * y] = getColorFromRaycast(ray, objectList, lightList);
+			framebuffer[x + width * y] = getColorFromRaycast(createCameraRay(camera, x, y), objectList, lightList);
 		}
 	}
 }
 
+bool Renderer::projectToPixel(Camera & camera, const glm::vec3 & point, glm::vec2 & pixelPosition)
+{
+	glm::vec3 cameraPoint = camera.convertWorldSpaceToCameraSpace(point);
+	if (cameraPoint.z <= MathFunctions::EPSILON)
+	{
+		return false;
+	}
+	//Inverse of the pixel position createCameraRay puts on the image plane
+	float scale = tan(MathFunctions::degreesToRadians(camera.getFieldOfView()) * 0.5f);
+	float aspectRatio = width / (float)height;
+	pixelPosition.x = (1.0f - cameraPoint.x / (cameraPoint.z * scale * aspectRatio)) * 0.5f * width;
+	pixelPosition.y = (1.0f - cameraPoint.y / (cameraPoint.z * scale)) * 0.5f * height;
+	return true;
+}
+
+Ray Renderer::createCameraRay(Camera & camera, uint32_t x, uint32_t y)
+{
+	//Calculate the scale value by taking the tangent of the half angle of the cameras field of view
+	float scale = tan(MathFunctions::degreesToRadians(camera.getFieldOfView()) * 0.5f);
+	float aspectRatio = width / (float)height;
+	float inverseWidth = 1 / (float)width;
+	float inverseHeight = 1 / (float)height;
+	//Distance on the image plane in camera space between neighbouring pixels, used for the ray differentials
+	float pixelStepX = -2.0f * inverseWidth * scale * aspectRatio;
+	float pixelStepY = -2.0f * inverseHeight * scale;
+	//Calculate the pixel's position in camera space by calculating the location of the center of each pixel. Apply the aspect ratio to the x to get the correct scaling
+	float pX = (1.0f - 2.0f * (x + 0.5f) * inverseWidth) * scale * aspectRatio;
+	float pY = (1.0f - 2.0f * (y + 0.5f) * inverseHeight) * scale;
+	//Convert the pixel position to world space placing the plane 1 unit in front of the camera
+	glm::vec3 position = camera.convertCameraSpaceToWorldSpace(glm::vec3(pX, pY, 1));
+	//Create the ray by calculating the direction the ray will be cast in by subtracting the origin of the camera
+	Ray ray = Ray(position, glm::normalize(position - camera.getOrigin()));
+	//Find the ray differentials from the rays through the next pixel over in x and y
+	glm::vec3 positionDx = camera.convertCameraSpaceToWorldSpace(glm::vec3(pX + pixelStepX, pY, 1)) - position;
+	glm::vec3 positionDy = camera.convertCameraSpaceToWorldSpace(glm::vec3(pX, pY + pixelStepY, 1)) - position;
+	glm::vec3 directionDx = glm::normalize(position + positionDx - camera.getOrigin()) - ray.getDirectionVector();
+	glm::vec3 directionDy = glm::normalize(position + positionDy - camera.getOrigin()) - ray.getDirectionVector();
+	ray.setDifferentials(positionDx, positionDy, directionDx, directionDy);
+	return ray;
+}
+
 ImageLoader & Renderer::getImageLoader()
 {
 	return this->imageLoader;
@@ -58,162 +412,194 @@ std::vector<glm::vec3>& Renderer::getFramebuffer()
 	return framebuffer;
 }
 
-glm::vec3 Renderer::getColorFromRaycast(const Ray & ray, std::vector<Object*>& objectList, std::vector<Light*>& lightList, const uint32_t & depth)
+void Renderer::swapFramebuffer(std::vector<glm::vec3> & other)
+{
+	framebuffer.swap(other);
+}
+
+glm::vec3 Renderer::getColorFromRaycast(const Ray & ray, std::vector<Object*>& objectList, std::vector<Light*>& lightList, const uint32_t & depth, TemporalSample * temporalSample)
 {
 	//Background color which will be returned if the ray hits no objects or the depth limit is reached
 	glm::vec3 backgroundColor = glm::vec3(0.0f, 0.0f, 0.0f);
 
-	//Background color is specified, if there is no hit in the trace, the background color will be provided
-	glm::vec3 hitColor = glm::vec3(0.0f, 0.0f, 0.0f);
-	
 	//Return the background color if the current ray has cast more reflection rays than the max depth allows
 	if (depth > MAX_RAY_DEPTH)
 	{
 		return backgroundColor;
 	}
 
+	SurfaceHit surfaceHit;
+	//Finds if an object is intersected and outputs the surface of the nearest object at the intersection
+	if (traceSurface(ray, surfaceHit))
+	{
+		//Only phong shading looks the same from nearby, reflections and refractions move with the view
+		if (temporalSample)
+		{
+			Entity * entity = dynamic_cast<Entity*>(surfaceHit.object);
+			temporalSample->position = surfaceHit.position;
+			temporalSample->reusable = surfaceHit.material->getMaterialType() == Material::Type::PHONG && !(entity && entity->isAnimated());
+		}
+		return shadeSurface(ray, surfaceHit, objectList, lightList, depth);
+	}
+	else
+	{
+		return backgroundColor;
+	}
+}
+
+bool Renderer::traceSurface(const Ray & ray, SurfaceHit & surfaceHit)
+{
 	//Value used in ray parameterization to calculate the intersection point
 	float nearestHitParameter = MathFunctions::T_INFINITY;
 	//The reference to the nearest intersected object when the ray is cast
-	Object* nearestHit = nullptr;
-	//Extra data passed back from the intersection object to be used in surface calculations
-	IntersectionData intersectionData;
-
-	//Finds if an object is intersected and outputs the nearest object, intersection data, and ray parameter value of the intersection
-	if (trace(ray, objectList, nearestHitParameter, nearestHit, MathFunctions::T_INFINITY, intersectionData))
+	surfaceHit.object = nullptr;
+	surfaceHit.material = nullptr;
+	if (!trace(ray, nearestHitParameter, surfaceHit.object, MathFunctions::T_INFINITY, surfaceHit.intersectionData))
 	{
-		//Calculate the intersection point based on the ray parameter value
-		glm::vec3 intersectionPoint = ray.getOrigin() + (ray.getDirectionVector() * nearestHitParameter);
-		glm::vec3 normal;
-		glm::vec2 textureCoords;
-		Material * material = nullptr;
+		return false;
+	}
 
-		//Outputs the normal and texture coordinates for the object that was intersected
-		nearestHit->getSurfaceData(intersectionPoint, intersectionData, normal, textureCoords, material);
+	//Calculate the intersection point based on the ray parameter value
+	surfaceHit.position = ray.getOrigin() + (ray.getDirectionVector() * nearestHitParameter);
+	//Outputs the normal and texture coordinates for the object that was intersected
+	surfaceHit.object->getSurfaceData(surfaceHit.position, surfaceHit.intersectionData, surfaceHit.normal, surfaceHit.textureCoords, surfaceHit.material);
+
+	//Find how the intersection point changes between neighbouring pixels so it can be carried on to texture lookups and secondary rays
+	surfaceHit.pointDx = glm::vec3(0.0f);
+	surfaceHit.pointDy = glm::vec3(0.0f);
+	if (ray.hasDifferentials())
+	{
+		transferDifferentials(ray, nearestHitParameter, surfaceHit.normal, surfaceHit.pointDx, surfaceHit.pointDy);
+	}
+	surfaceHit.textureCoordsDx = glm::vec2(0.0f);
+	surfaceHit.textureCoordsDy = glm::vec2(0.0f);
+	if (ray.hasDifferentials() && surfaceHit.material->getMaterialType() == Material::Type::PHONG && surfaceHit.material->getTextureID() >= 0)
+	{
+		calculateTextureCoordsDifferentials(surfaceHit.object, surfaceHit.intersectionData, surfaceHit.position, surfaceHit.textureCoords, surfaceHit.pointDx, surfaceHit.pointDy, surfaceHit.textureCoordsDx, surfaceHit.textureCoordsDy);
+	}
+	return true;
+}
 
-		switch (material->getMaterialType())
+glm::vec3 Renderer::shadeSurface(const Ray & ray, const SurfaceHit & surfaceHit, std::vector<Object*>& objectList, std::vector<Light*>& lightList, const uint32_t & depth)
+{
+	glm::vec3 hitColor = glm::vec3(0.0f, 0.0f, 0.0f);
+	Material * material = surfaceHit.material;
+	switch (material->getMaterialType())
+	{
+		case Material::Type::PHONG:
 		{
-			case Material::Type::PHONG:
+			glm::vec3 colorAtIntersection = getObjectHitColor(surfaceHit.textureCoords, surfaceHit.textureCoordsDx, surfaceHit.textureCoordsDy, material);
+			PhongMaterial * phongMaterial = (PhongMaterial*)(material);
+			//Loop through each light in the scene
+			for (Light* light : lightList)
 			{
-				glm::vec3 colorAtIntersection = getObjectHitColor(textureCoords, material);
-				PhongMaterial * phongMaterial = (PhongMaterial*)(material);
-				//Loop through each light in the scene
-				for (Light* light : lightList)
+				glm::vec3 lightDirection;
+				glm::vec3 attenuatedLight;
+				float tMaximum;
+				//Output the direction of the light and light data to be used in shading. The tMaximum value is used to determine which t-value to throw away when casting a shadow ray
+				light->getLightDirectionAndIntensity(surfaceHit.position, lightDirection, attenuatedLight, tMaximum);
+
+				float t;
+				Object* shadowHit = nullptr;
+				IntersectionData shadowData;
+				//Check if the intersection point is in shadow by casting a shadow ray to the light source
+				bool inShadow = trace(Ray(surfaceHit.position, -lightDirection, Ray::Type::SHADOW), t, shadowHit, tMaximum, shadowData);
+
+				if (!inShadow)
 				{
-					glm::vec3 lightDirection;
-					glm::vec3 attenuatedLight;
-					float tMaximum;
-					//Output the direction of the light and light data to be used in shading. The tMaximum value is used to determine which t-value to throw away when casting a shadow ray
-					light->getLightDirectionAndIntensity(intersectionPoint, lightDirection, attenuatedLight, tMaximum);
-
-					float t;
-					Object* shadowHit = nullptr;
-					IntersectionData shadowData;
-					//Check if the intersection point is in shadow by casting a shadow ray to the light source
-					bool inShadow = trace(Ray(intersectionPoint, -lightDirection, Ray::Type::SHADOW), objectList, t, shadowHit, tMaximum, shadowData);
-
-					if (!inShadow)
-					{
-						//Calculate the diffuse component
-						glm::vec3 diffuse = colorAtIntersection * attenuatedLight * std::max(0.0f, glm::dot(normal, -lightDirection));
-						//colorAtIntersection / (float)M_PI * attenuatedLight * std::max(0.0f, glm::dot(normal, -lightDirection));
+					//Calculate the diffuse component
+					glm::vec3 diffuse = colorAtIntersection * attenuatedLight * std::max(0.0f, glm::dot(surfaceHit.normal, -lightDirection));
+					//colorAtIntersection / (float)M_PI * attenuatedLight * std::max(0.0f, glm::dot(surfaceHit.normal, -lightDirection));
 
-						glm::vec3 reflectionVector = getReflectionVector(lightDirection, normal);
-						//Calculate the speclar component
-						glm::vec3 specular = attenuatedLight * std::pow(std::max(0.0f, glm::dot(reflectionVector, -ray.getDirectionVector())), phongMaterial->getPowerComponent());
+					glm::vec3 reflectionVector = getReflectionVector(lightDirection, surfaceHit.normal);
+					//Calculate the speclar component
+					glm::vec3 specular = attenuatedLight * std::pow(std::max(0.0f, glm::dot(reflectionVector, -ray.getDirectionVector())), phongMaterial->getPowerComponent());
 
-						hitColor += diffuse * phongMaterial->getDiffuseComponent() + specular * phongMaterial->getSpecularComponent();
-					}
+					hitColor += diffuse * phongMaterial->getDiffuseComponent() + specular * phongMaterial->getSpecularComponent();
 				}
 			}
+		}
+		break;
+		case Material::Type::REFLECT:
+		{
+			hitColor += 0.8f * getColorFromRaycast(createReflectionRay(ray, surfaceHit.position, surfaceHit.normal, surfaceHit.pointDx, surfaceHit.pointDy), objectList, lightList, depth + 1);
 			break;
-			case Material::Type::REFLECT:
+		}
+		case Material::Type::REFLECT_AND_REFRACT:
+		{
+			RefractiveMaterial * refractiveMaterial = (RefractiveMaterial*)(material);
+
+			glm::vec3 reflectionColor(0.0f);
+			glm::vec3 refractionColor(0.0f);
+			float reflectionMix = computeFresnel(ray.getDirectionVector(), surfaceHit.normal, refractiveMaterial->getIndexOfRefraction());
+			//there is no total interal reflection
+			if (reflectionMix < 1.0f)
 			{
-				glm::vec3 reflectionDir = getReflectionVector(ray.getDirectionVector(), normal);
-				hitColor += 0.8f * getColorFromRaycast(Ray(intersectionPoint, reflectionDir), objectList, lightList, depth + 1);
-				break;
+				refractionColor = getColorFromRaycast(createRefractionRay(ray, surfaceHit.position, surfaceHit.normal, refractiveMaterial->getIndexOfRefraction(), surfaceHit.pointDx, surfaceHit.pointDy), objectList, lightList, depth + 1);
 			}
-			case Material::Type::REFLECT_AND_REFRACT:
-			{
-				RefractiveMaterial * refractiveMaterial = (RefractiveMaterial*)(material);
 
-				glm::vec3 reflectionColor(0.0f);
-				glm::vec3 refractionColor(0.0f);
-				float reflectionMix = computeFresnel(ray.getDirectionVector(), normal, refractiveMaterial->getIndexOfRefraction());
-				//there is no total interal reflection
-				if (reflectionMix < 1.0f)
-				{
-					glm::vec3 refractionDirection = getRefractionVector(ray.getDirectionVector(), normal, refractiveMaterial->getIndexOfRefraction());
-					refractionColor = getColorFromRaycast(Ray(intersectionPoint, refractionDirection), objectList, lightList, depth + 1);
-				}
+			reflectionColor = getColorFromRaycast(createReflectionRay(ray, surfaceHit.position, surfaceHit.normal, surfaceHit.pointDx, surfaceHit.pointDy), objectList, lightList, depth + 1);
 
-				glm::vec3 reflectionDirection = getReflectionVector(ray.getDirectionVector(), normal);
-				reflectionColor = getColorFromRaycast(Ray(intersectionPoint, reflectionDirection), objectList, lightList, depth + 1);
-
-				//Find a mix of the reflection and refraction with a linear interpolation
-				hitColor += reflectionColor * reflectionMix + refractionColor * (1 - reflectionMix);
-				break;
-			}
+			//Find a mix of the reflection and refraction with a linear interpolation
+			hitColor += reflectionColor * reflectionMix + refractionColor * (1 - reflectionMix);
+			break;
 		}
-		return hitColor;
-	}
-	else
-	{
-		return backgroundColor;
 	}
+	return hitColor;
 }
 
-bool Renderer::trace(const Ray & ray, std::vector<Object*>& objectList, float & nearestHitParameter, Object *& objectHit, float upperBound, IntersectionData & intersectionData)
+bool Renderer::trace(const Ray & ray, float & nearestHitParameter, Object *& objectHit, float upperBound, IntersectionData & intersectionData)
 {
-	std::list<IntersectionPair> possibleIntersectionList;
-	//Loop through all objects to check for possible intersections with the ray
-	for (Object * object : objectList)
+	bool hit = false;
+	float nearestParameter = upperBound;
+	//The BVH hands over the objects whose bounds the ray passes through, skipping any that start past the nearest hit found so far
+	this->sceneBVH.traverse(ray, nearestParameter, [&](Object * object)
 	{
 		//TODO Change this line to work with per-face materials
 		//Allows shadow rays to disregard reflect and refract materials so shadows are not cast when the object should be transparent
 		if (ray.getRayType() == Ray::Type::SHADOW && object->getMaterial()->getMaterialType() == Material::Type::REFLECT_AND_REFRACT)
 		{
-			continue;
+			return false;
 		}
 
 		float t = MathFunctions::T_INFINITY;
-		if (object->possibleIntersection(ray, t) && t < upperBound)
+		if (!object->possibleIntersection(ray, t) || t >= nearestParameter)
 		{
-			//Add the intersection pair with its ray parameter to the list
-			IntersectionPair pair;
-			pair.objectHit = object;
-			pair.parameter = t;
-			possibleIntersectionList.push_back(pair);
+			return false;
+		}
+		//A ray that might hit a loading object could come out differently once it has loaded
+		if (object->isLoading() && std::find(reachedLoadingObjects.begin(), reachedLoadingObjects.end(), object) == reachedLoadingObjects.end())
+		{
+			reachedLoadingObjects.push_back(object);
 		}
-	}
-	//Sort the possible intersections by the closest ray parameter
-	possibleIntersectionList.sort();
 
-	while (!possibleIntersectionList.empty())
-	{
-		nearestHitParameter = MathFunctions::T_INFINITY;
+		float parameter = MathFunctions::T_INFINITY;
 		//Need to pass a temporary intersection data struct so that intersection data does not get overwritten when an intersection is not the closest intersection point
 		IntersectionData tempData;
-		if (possibleIntersectionList.front().objectHit->intersect(ray, nearestHitParameter, tempData) && !ARE_FLOATS_EQUAL(nearestHitParameter, 0.0f) && nearestHitParameter < upperBound)
+		if (object->intersect(ray, parameter, tempData) && !ARE_FLOATS_EQUAL(parameter, 0.0f) && parameter < nearestParameter)
 		{
-			objectHit = possibleIntersectionList.front().objectHit;
+			hit = true;
+			nearestParameter = parameter;
+			objectHit = object;
 			intersectionData = tempData;
-			return true;
+			//Shadow rays only need to know if anything is hit, so they stop at the first hit
+			return ray.getRayType() == Ray::Type::SHADOW;
 		}
-		possibleIntersectionList.pop_front();
-	}
+		return false;
+	});
 
-	return false;
+	nearestHitParameter = hit ? nearestParameter : MathFunctions::T_INFINITY;
+	return hit;
 }
 
-glm::vec3 Renderer::getObjectHitColor(const glm::vec2 & textureCoords, const Material * material)
+glm::vec3 Renderer::getObjectHitColor(const glm::vec2 & textureCoords, const glm::vec2 & textureCoordsDx, const glm::vec2 & textureCoordsDy, const Material * material)
 {
 	if (material->getTextureID() < 0)
 	{
 		return material->getAlbedo();
 	}
 
-	return imageLoader.getColorAtTextureUV(material->getTextureID(), textureCoords.x, textureCoords.y);
+	return imageLoader.getColorAtTextureUV(material->getTextureID(), textureCoords, textureCoordsDx, textureCoordsDy);
 }
 
 glm::vec3 Renderer::getReflectionVector(const glm::vec3 incidentDirection, const glm::vec3 normal)
@@ -288,3 +674,73 @@ float Renderer::computeFresnel(const glm::vec3 incidentDirection, const glm::vec
 	//returns the average of the two equations
 	return (parallelFresnel * parallelFresnel + perpendicularFresnel * perpendicularFresnel) * 0.5f;
 }
+
+void Renderer::transferDifferentials(const Ray & ray, const float parameter, const glm::vec3 & normal, glm::vec3 & pointDx, glm::vec3 & pointDy)
+{
+	//Move the differentials along the ray to the intersection point and then project them onto the plane of the surface hit
+	glm::vec3 direction = ray.getDirectionVector();
+	float directionNormalCosine = glm::dot(direction, normal);
+	if (fabsf(directionNormalCosine) < MathFunctions::EPSILON)
+	{
+		directionNormalCosine = directionNormalCosine < 0.0f ? -MathFunctions::EPSILON : MathFunctions::EPSILON;
+	}
+
+	pointDx = ray.getOriginDx() + parameter * ray.getDirectionDx();
+	pointDy = ray.getOriginDy() + parameter * ray.getDirectionDy();
+	pointDx -= (glm::dot(pointDx, normal) / directionNormalCosine) * direction;
+	pointDy -= (glm::dot(pointDy, normal) / directionNormalCosine) * direction;
+}
+
+void Renderer::calculateTextureCoordsDifferentials(Object * objectHit, const IntersectionData & intersectionData, const glm::vec3 & intersectionPoint, const glm::vec2 & textureCoords, const glm::vec3 & pointDx, const glm::vec3 & pointDy, glm::vec2 & textureCoordsDx, glm::vec2 & textureCoordsDy)
+{
+	//Find the texture coordinates where the neighbouring pixels hit the surface
+	textureCoordsDx = objectHit->getTextureCoordinates(intersectionPoint + pointDx, intersectionData) - textureCoords;
+	textureCoordsDy = objectHit->getTextureCoordinates(intersectionPoint + pointDy, intersectionData) - textureCoords;
+
+	//Texture coordinates repeat, so a difference across a seam in the mapping is wrapped back to the short way around
+	textureCoordsDx -= glm::vec2(roundf(textureCoordsDx.x), roundf(textureCoordsDx.y));
+	textureCoordsDy -= glm::vec2(roundf(textureCoordsDy.x), roundf(textureCoordsDy.y));
+}
+
+Ray Renderer::createReflectionRay(const Ray & ray, const glm::vec3 & intersectionPoint, const glm::vec3 & normal, const glm::vec3 & pointDx, const glm::vec3 & pointDy)
+{
+	Ray reflectionRay = Ray(intersectionPoint, getReflectionVector(ray.getDirectionVector(), normal), Ray::Type::SECONDARY);
+	if (ray.hasDifferentials())
+	{
+		//Reflect the direction differentials the same way as the direction, treating the surface as locally flat
+		glm::vec3 directionDx = ray.getDirectionDx() - 2.0f * glm::dot(ray.getDirectionDx(), normal) * normal;
+		glm::vec3 directionDy = ray.getDirectionDy() - 2.0f * glm::dot(ray.getDirectionDy(), normal) * normal;
+		reflectionRay.setDifferentials(pointDx, pointDy, directionDx, directionDy);
+	}
+	return reflectionRay;
+}
+
+Ray Renderer::createRefractionRay(const Ray & ray, const glm::vec3 & intersectionPoint, const glm::vec3 & normal, const float indexOfRefraction, const glm::vec3 & pointDx, const glm::vec3 & pointDy)
+{
+	glm::vec3 direction = ray.getDirectionVector();
+	Ray refractionRay = Ray(intersectionPoint, getRefractionVector(direction, normal, indexOfRefraction), Ray::Type::SECONDARY);
+	if (ray.hasDifferentials())
+	{
+		//Orient the normal and ratio of indices of refraction the same way getRefractionVector does
+		glm::vec3 refractionNormal = normal;
+		float indicesOfRefractionRatio = 1.0f / indexOfRefraction;
+		if (glm::dot(direction, normal) > 0.0f)
+		{
+			refractionNormal = -normal;
+			indicesOfRefractionRatio = indexOfRefraction;
+		}
+
+		//The refracted direction is ratio * D - gamma * N, so its differential is ratio * dD - dGamma * N when the surface is locally flat
+		float incidentCosine = glm::dot(direction, refractionNormal);
+		float refractedCosine = glm::dot(refractionRay.getDirectionVector(), refractionNormal);
+		if (fabsf(refractedCosine) < MathFunctions::EPSILON)
+		{
+			refractedCosine = -MathFunctions::EPSILON;
+		}
+		float gammaDerivative = indicesOfRefractionRatio - indicesOfRefractionRatio * indicesOfRefractionRatio * incidentCosine / refractedCosine;
+		glm::vec3 directionDx = indicesOfRefractionRatio * ray.getDirectionDx() - gammaDerivative * glm::dot(ray.getDirectionDx(), refractionNormal) * refractionNormal;
+		glm::vec3 directionDy = indicesOfRefractionRatio * ray.getDirectionDy() - gammaDerivative * glm::dot(ray.getDirectionDy(), refractionNormal) * refractionNormal;
+		refractionRay.setDifferentials(pointDx, pointDy, directionDx, directionDy);
+	}
+	return refractionRay;
+}
@@ -1,9 +1,11 @@
 #pragma once
 
 #include <vector>
+#include <functional>
 #include <glm/vec3.hpp>
 
 #include "../Objects/Object.h"
+#include "../DataStructures/SceneBVH.h"
 #include "Images/ImageLoader.h"
 
 
@@ -11,39 +13,123 @@ class Camera;
 class Light;
 class Ray;
 
-struct IntersectionPair
-{
-	float parameter;
-	Object * objectHit;
-
-	bool operator<(const IntersectionPair &pair)
-	{
-		return this->parameter < pair.parameter;
-	}
-};
-
 class Renderer
 {
 public:
 	static const int MAX_RAY_DEPTH;
+	//Width and height in pixels of the tiles the progressive render is split into
+	static const uint32_t TILE_SIZE;
+	//A reprojected pixel is traced again if a neighbouring pixel reprojects this much nearer to the camera, as it may be seeing through a gap in a nearer surface
+	static const float TEMPORAL_DEPTH_TOLERANCE;
+	//A reprojected pixel is traced again once the direction it is seen from has turned this many degrees from the one it was shaded from, since its highlights move with the view
+	static const float TEMPORAL_MAX_VIEW_ANGLE;
 
 	Renderer(uint32_t w, uint32_t h);
+	~Renderer();
+	//Builds the scene BVH the first time it is given an object list, after that objects that move have to be refit with updateScene before rendering
 	void render(Camera &camera, std::vector<Object*> &objectList, std::vector<Light*> &lightList);
+	//Refits the scene BVH to objects that have moved since the last frame, returns true if it had to be built again, see SceneBVH::update
+	bool updateScene(std::vector<Object*> &objectList);
+	const SceneBVH & getSceneBVH() const;
+	//Exchanges the scene BVH with one prepared for the next frame, which has to be done between renders
+	void swapSceneBVH(SceneBVH & other);
+	//Renders the scene tile by tile without waiting for objects that are still loading, which are drawn as their stand ins
+	//Tiles whose rays reached loading objects are queued again once those objects have loaded, so the final image matches a render with everything loaded
+	//The preview callback runs once every tile has been rendered at least once
+	void renderProgressive(Camera &camera, std::vector<Object*> &objectList, std::vector<Light*> &lightList, const std::function<void()> & previewReady);
+	//Renders the frame reusing the primary hits of the last frame rendered this way, moved to where they are seen from the camera now
+	//Pixels no hit reprojects to, that may be newly uncovered, or whose hit is reflective, refractive or on an animated entity are traced again along with the refresh fraction of the other pixels
+	//Every pixel covered by the bounds of an animated entity, where it is now or where it was in the last frame, is traced again so entities moving over still surfaces are drawn where they are
+	//Shadows, reflections and refractions of moving entities seen on other surfaces outside those bounds are not checked, they are only updated as pixels are refreshed
+	//Returns the fraction of pixels that were reused
+	float renderTemporal(Camera &camera, std::vector<Object*> &objectList, std::vector<Light*> &lightList, float refreshFraction);
+	//Traces the primary ray of every pixel and keeps the surface it hits, so the image can be shaded again by reshade without tracing them
+	void cacheHits(Camera &camera, std::vector<Object*> &objectList);
+	//Shades the cached hits into the framebuffer with the lights and materials as they are now, only shadow and secondary rays are traced
+	//The hits are cached first if they have not been, they have to be cached again once the camera or the objects move or an object is given another material
+	void reshade(Camera &camera, std::vector<Object*> &objectList, std::vector<Light*> &lightList);
+	//Bytes held by the cached hits, zero if none have been cached
+	size_t getHitBufferMemoryUsage() const;
 
 	ImageLoader& getImageLoader();
 
 	std::vector<glm::vec3> & getFramebuffer();
+	//Exchanges the framebuffer with another of the same size, so a finished frame can be written out while the next one renders
+	void swapFramebuffer(std::vector<glm::vec3> & other);
 
 private:
+	//Surface a ray hit, everything shading needs that depends on the geometry and not on the lights or material settings
+	struct SurfaceHit
+	{
+		//Null if the ray missed
+		Object * object;
+		IntersectionData intersectionData;
+		glm::vec3 position;
+		glm::vec3 normal;
+		glm::vec2 textureCoords;
+		glm::vec2 textureCoordsDx;
+		glm::vec2 textureCoordsDy;
+		//How the position changes towards the neighbouring pixels, for the differentials of secondary rays
+		glm::vec3 pointDx;
+		glm::vec3 pointDy;
+		Material * material;
+	};
+
+	//Primary hit of a pixel kept for the next temporal render
+	struct TemporalSample
+	{
+		glm::vec3 position;
+		//Origin of the camera the hit was shaded from
+		glm::vec3 viewOrigin;
+		bool reusable;
+	};
+
+	struct Tile
+	{
+		uint32_t x;
+		uint32_t y;
+		//Loading objects the rays of the tile reached the last time it was rendered
+		std::vector<Object*> loadingObjects;
+	};
+
 	std::vector<glm::vec3> framebuffer;
 	uint32_t width;
 	uint32_t height;
 	ImageLoader imageLoader;
+	SceneBVH sceneBVH;
+	//Objects that are still loading which a ray of the current tile might have hit
+	std::vector<Object*> reachedLoadingObjects;
+	//Primary hits and colors of the last temporal render
+	std::vector<TemporalSample> temporalSamples;
+	std::vector<glm::vec3> temporalColors;
+	uint32_t temporalFrames;
+	//World space bounds of the animated entities in the last temporal render, as pairs of minimum and maximum corners
+	std::vector<glm::vec3> temporalAnimatedBounds;
+	//Surface hit by the primary ray of each pixel, see cacheHits
+	std::vector<SurfaceHit> hitBuffer;
+
+	void prepareRender(Camera & camera, std::vector<Object*> & objectList);
+	//Renders the pixels from the corner up to but not including the end in both directions
+	void renderTile(Camera & camera, uint32_t startX, uint32_t startY, uint32_t endX, uint32_t endY, std::vector<Object*> & objectList, std::vector<Light*> & lightList);
+	Ray createCameraRay(Camera & camera, uint32_t x, uint32_t y);
+	//Gives the position on the image, in pixels, that the point is seen at, returns false if the point is not in front of the camera
+	bool projectToPixel(Camera & camera, const glm::vec3 & point, glm::vec2 & pixelPosition);
+	//Returns true if any object finished loading
+	bool finishLoading(std::vector<Object*> & objectList, bool wait);
 
-	glm::vec3 getColorFromRaycast(const Ray & ray, std::vector<Object*> & objectList, std::vector<Light*> & lightList, const uint32_t & depth = 0);
-	bool trace(const Ray & ray, std::vector<Object*> & objectList, float &nearestHitParameter, Object *& objectHit, float upperBound, IntersectionData & intersectionData);
-	glm::vec3 getObjectHitColor(const glm::vec2 & textureCoords, const Material * material);
+	//The temporal sample is filled in with the hit of a primary ray, if one is given
+	glm::vec3 getColorFromRaycast(const Ray & ray, std::vector<Object*> & objectList, std::vector<Light*> & lightList, const uint32_t & depth = 0, TemporalSample * temporalSample = nullptr);
+	bool trace(const Ray & ray, float &nearestHitParameter, Object *& objectHit, float upperBound, IntersectionData & intersectionData);
+	//Finds the nearest surface the ray hits and the data to shade it with
+	bool traceSurface(const Ray & ray, SurfaceHit & surfaceHit);
+	glm::vec3 shadeSurface(const Ray & ray, const SurfaceHit & surfaceHit, std::vector<Object*> & objectList, std::vector<Light*> & lightList, const uint32_t & depth);
+	glm::vec3 getObjectHitColor(const glm::vec2 & textureCoords, const glm::vec2 & textureCoordsDx, const glm::vec2 & textureCoordsDy, const Material * material);
 	glm::vec3 getReflectionVector(const glm::vec3 incidentDirection, const glm::vec3 normal);
 	glm::vec3 getRefractionVector(const glm::vec3 incidentDirection, const glm::vec3 normal, const float indicesOfRefraction);
 	float computeFresnel(const glm::vec3 incidentDirection, const glm::vec3 normal, const float indiceOfRefraction);
+
+	void transferDifferentials(const Ray & ray, const float parameter, const glm::vec3 & normal, glm::vec3 & pointDx, glm::vec3 & pointDy);
+	void calculateTextureCoordsDifferentials(Object * objectHit, const IntersectionData & intersectionData, const glm::vec3 & intersectionPoint, const glm::vec2 & textureCoords, const glm::vec3 & pointDx, const glm::vec3 & pointDy, glm::vec2 & textureCoordsDx, glm::vec2 & textureCoordsDy);
+	Ray createReflectionRay(const Ray & ray, const glm::vec3 & intersectionPoint, const glm::vec3 & normal, const glm::vec3 & pointDx, const glm::vec3 & pointDy);
+	Ray createRefractionRay(const Ray & ray, const glm::vec3 & intersectionPoint, const glm::vec3 & normal, const float indexOfRefraction, const glm::vec3 & pointDx, const glm::vec3 & pointDy);
 };
\ No newline at end of file
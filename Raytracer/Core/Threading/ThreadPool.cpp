@@ -0,0 +1,55 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(uint32_t threadCount) : stopping(false)
+{
+	if (threadCount == 0)
+	{
+		threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+	}
+
+	for (uint32_t i = 0; i < threadCount; i++)
+	{
+		workers.push_back(std::thread(&ThreadPool::runWorker, this));
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+		stopping = true;
+	}
+	taskAvailable.notify_all();
+
+	for (std::thread & worker : workers)
+	{
+		worker.join();
+	}
+}
+
+uint32_t ThreadPool::getThreadCount() const
+{
+	return workers.size();
+}
+
+void ThreadPool::runWorker()
+{
+	while (true)
+	{
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(queueMutex);
+			taskAvailable.wait(lock, [this]() { return stopping || !tasks.empty(); });
+			//Only stop once the queue is drained so no submitted future is left without a result
+			if (tasks.empty())
+			{
+				return;
+			}
+			task = std::move(tasks.front());
+			tasks.pop();
+		}
+		task();
+	}
+}
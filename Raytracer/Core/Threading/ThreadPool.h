@@ -0,0 +1,46 @@
+#pragma once
+
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+
+//Fixed set of worker threads that run submitted tasks in the order they were submitted
+class ThreadPool
+{
+public:
+	//A thread count of 0 uses one thread per hardware thread
+	ThreadPool(uint32_t threadCount = 0);
+	//Finishes the tasks that are already queued before joining the worker threads
+	~ThreadPool();
+
+	//Queues the function to run on a worker thread, the future holds its result once it has run
+	template <typename Function>
+	auto submit(Function function) -> std::future<decltype(function())>
+	{
+		//The packaged task is shared since std::function needs a copyable target
+		auto task = std::make_shared<std::packaged_task<decltype(function())()>>(function);
+		std::future<decltype(function())> result = task->get_future();
+		{
+			std::lock_guard<std::mutex> lock(queueMutex);
+			tasks.push([task]() { (*task)(); });
+		}
+		taskAvailable.notify_one();
+		return result;
+	}
+
+	uint32_t getThreadCount() const;
+
+private:
+	std::vector<std::thread> workers;
+	std::queue<std::function<void()>> tasks;
+	std::mutex queueMutex;
+	std::condition_variable taskAvailable;
+	bool stopping;
+
+	void runWorker();
+};
\ No newline at end of file